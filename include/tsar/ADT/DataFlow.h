@@ -34,6 +34,8 @@
 //  * RegionDFTraits - It must be specialized to determine data-flow framework
 //                     for a hierarchy of regions.
 //  * solveDataFlow...() - It should be used to solve data-flow problem.
+//                         Iterative problems are solved with a worklist
+//                         algorithm by default (solveDataFlowWorklist()).
 //  * SmallDFNode - It can be inherited to represent nodes of a data-flow graph.
 //
 //===----------------------------------------------------------------------===//
@@ -41,9 +43,12 @@
 #ifndef TSAR_DATA_FLOW_H
 #define TSAR_DATA_FLOW_H
 
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/GraphTraits.h>
 #include <llvm/ADT/iterator_range.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/ADT/PostOrderIterator.h>
 #include <algorithm>
 #include <iterator>
@@ -52,6 +57,23 @@
 #include <bcl/utility.h>
 
 namespace tsar {
+namespace detail {
+/// Number of transfer function evaluations performed by the worklist solver.
+inline llvm::Statistic NumDFWorklistEval = {"data-flow",
+  "NumDFWorklistEval", "Number of transfer functions evaluated by worklist"};
+
+/// Estimated number of transfer function evaluations which have been saved in
+/// comparison with round-robin sweeps over the same data-flow graphs.
+///
+/// Round-robin solver is not run, so the number of its evaluations is
+/// estimated as (S + 1) * (N - 1), where S is the number of worklist sweeps
+/// and N is the number of nodes. The real number may differ because
+/// round-robin solver may converge in a different number of sweeps.
+inline llvm::Statistic NumDFWorklistSavedEstimate = {"data-flow",
+  "NumDFWorklistSavedEstimate",
+  "Estimated number of transfer functions saved by worklist"};
+}
+
 /// \brief Data-flow framework.
 ///
 /// This class should be specialized by different framework types
@@ -170,6 +192,101 @@ template<class DFFwk> void solveDataFlowIteratively(DFFwk DFF,
   } while (isChanged);
 }
 
+/// \brief Solves data-flow problem using a worklist algorithm.
+///
+/// This computes IN and OUT for each node in the specified data-flow graph
+/// by successive approximation. In contrast to solveDataFlowIteratively()
+/// transfer function is reevaluated only for nodes which have at least one
+/// adjacent node (in the direction of data-flow) with a changed value.
+/// Nodes are visited in reverse post-order, so if a value of some node
+/// changes, all affected nodes which follow it in the topological order are
+/// processed before the traversal restarts from the beginning.
+///
+/// The last computed value for each node can be obtained by calling
+/// the DataFlowTraits::getValue() function.
+/// The type of computed value (IN or OUT) depends on a data-flow direction
+/// (see DataFlowTratis). In case of a forward direction it is OUT,
+/// otherwise IN.
+/// \param [in, out] DFF Data-flow framework, it can not be null.
+/// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
+/// Subgraph of this graph also can be used.
+/// \attention The DataFlowTraits class should be specialized by DFFwk.
+/// Note that DFFwk is generally a pointer type.
+/// The GraphTraits class should be specialized by
+/// DataFlowTraits<DFFwk>::GraphType and llvm::Inverse of this type.
+/// \pre The graph must not contain unreachable nodes.
+template<class DFFwk> void solveDataFlowWorklist(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  typedef DataFlowTraits<DFFwk> DFT;
+  typedef typename DFT::ValueType ValueType;
+  typedef typename DFT::GraphType GraphType;
+  typedef llvm::GraphTraits<GraphType> GT;
+  typedef llvm::GraphTraits<llvm::Inverse<GraphType>> InvGT;
+  typedef typename GT::nodes_iterator nodes_iterator;
+  typedef typename GT::ChildIteratorType ChildIteratorType;
+  typedef typename InvGT::ChildIteratorType InvChildIteratorType;
+  typedef typename GT::NodeRef NodeRef;
+  typedef llvm::po_iterator<
+    GraphType, llvm::SmallPtrSet<NodeRef, 8>, false, InvGT> po_iterator;
+  // Priority of a node is its number in reverse post-order. Nodes which are
+  // not reachable from the entry node in the direction of data-flow
+  // (for example, nodes in infinite loops for backward problems) are
+  // processed after all other nodes.
+  std::vector<NodeRef> RPOT(po_iterator::begin(DFG), po_iterator::end(DFG));
+  std::reverse(RPOT.begin(), RPOT.end());
+  assert(!RPOT.empty() && RPOT.front() == GT::getEntryNode(DFG) &&
+    "The first node in the topological order differs from the entry node in the data-flow framework!");
+  llvm::DenseMap<NodeRef, unsigned> Priority;
+  for (unsigned I = 0, E = RPOT.size(); I < E; ++I)
+    Priority.try_emplace(RPOT[I], I);
+  for (nodes_iterator I = GT::nodes_begin(DFG), E = GT::nodes_end(DFG);
+       I != E; ++I) {
+    DFT::initialize(*I, DFF, DFG);
+    DFT::setValue(DFT::topElement(DFF, DFG), *I, DFF);
+    if (Priority.try_emplace(*I, RPOT.size()).second)
+      RPOT.push_back(*I);
+  }
+  DFT::initialize(GT::getEntryNode(DFG), DFF, DFG);
+  DFT::setValue(DFT::boundaryCondition(DFF, DFG), GT::getEntryNode(DFG), DFF);
+  llvm::BitVector Worklist(RPOT.size(), true);
+  Worklist.reset(0);
+  unsigned NumberOfSweeps = 1;
+  unsigned NumberOfEvals = 0;
+  for (int Idx = Worklist.find_first(); Idx >= 0;) {
+    Worklist.reset(Idx);
+    NodeRef N = RPOT[Idx];
+    assert((N == GT::getEntryNode(DFG) ||
+      GT::child_begin(N) != GT::child_end(N)) &&
+      "Data-flow graph must not contain unreachable nodes!");
+    ValueType Value(DFT::topElement(DFF, DFG));
+    for (ChildIteratorType CI = GT::child_begin(N), CE = GT::child_end(N);
+         CI != CE; ++CI)
+      DFT::meetOperator(DFT::getValue(*CI, DFF), Value, DFF, DFG);
+    ++NumberOfEvals;
+    if (DFT::transferFunction(std::move(Value), N, DFF, DFG))
+      for (InvChildIteratorType CI = InvGT::child_begin(N),
+           CE = InvGT::child_end(N); CI != CE; ++CI) {
+        auto PriorityItr = Priority.find(*CI);
+        // Value of the entry node is fixed by the boundary condition.
+        if (PriorityItr != Priority.end() && PriorityItr->second != 0)
+          Worklist.set(PriorityItr->second);
+      }
+    Idx = Worklist.find_next(Idx);
+    if (Idx < 0 && (Idx = Worklist.find_first()) >= 0)
+      ++NumberOfSweeps;
+  }
+  // Estimate the number of round-robin evaluations: round-robin solver
+  // evaluates all nodes except the entry one on each sweep and it needs an
+  // additional sweep to ensure that nothing has been changed. Note, that
+  // the number of round-robin sweeps is assumed to be equal to the number
+  // of worklist sweeps.
+  unsigned EstimatedRoundRobinEvals = (NumberOfSweeps + 1) * (RPOT.size() - 1);
+  detail::NumDFWorklistEval += NumberOfEvals;
+  if (EstimatedRoundRobinEvals > NumberOfEvals)
+    detail::NumDFWorklistSavedEstimate +=
+      EstimatedRoundRobinEvals - NumberOfEvals;
+}
+
 /// \brief Solves data-flow problem in topological order during one iteration.
 ///
 /// This computes IN and OUT for each node in the specified data-flow graph
@@ -278,7 +395,8 @@ template<class DFFwk > struct RegionDFTraits {
 /// one node which is associated with the whole specified graph. When traversing
 /// from the specified graph to innermost graphs, regions will be consistently
 /// expanded to a data-flow graph. If it is possible the problem will be solved
-/// in topological order in a single pass, otherwise iteratively.
+/// in topological order in a single pass, otherwise iteratively with
+/// a worklist algorithm.
 /// \param [in, out] DFF Data-flow framework, it can not be null.
 /// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
 /// Subgraph of this graph also can be used.
@@ -299,7 +417,7 @@ template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
   if (isDAG(DFG))
     solveDataFlowTopologicaly(DFF, DFG);
   else
-    solveDataFlowIteratively(DFF, DFG);
+    solveDataFlowWorklist(DFF, DFG);
   RT::collapse(DFF, DFG);
 }
 
@@ -315,7 +433,7 @@ template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
 /// a one node in a data-flow graph associated with this region.
 /// The specified graph will be also collapsed
 /// If it is possible the problem will be solved in topological order
-/// in a single pass, otherwise iteratively.
+/// in a single pass, otherwise iteratively with a worklist algorithm.
 /// \param [in, out] DFF Data-flow framework, it can not be null.
 /// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
 /// Subgraph of this graph also can be used.
@@ -333,7 +451,7 @@ template<class DFFwk> void solveDataFlowDownward(DFFwk DFF,
   if (isDAG(DFG))
     solveDataFlowTopologicaly(DFF, DFG);
   else
-    solveDataFlowIteratively(DFF, DFG);
+    solveDataFlowWorklist(DFF, DFG);
   for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
        I != E; ++I)
     solveDataFlowDownward(DFF, *I);
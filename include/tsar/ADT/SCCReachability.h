@@ -0,0 +1,116 @@
+//===- SCCReachability.h - Reachability in a Condensed Graph ----*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a compact representation of transitive closure of
+// a condensed graph (a graph of strongly connected components). Each row of
+// the closure is a bit vector, so rows are joined word by word.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_SCC_REACHABILITY_H
+#define TSAR_SCC_REACHABILITY_H
+
+#include <llvm/ADT/BitVector.h>
+#include <cassert>
+#include <vector>
+
+namespace tsar {
+/// \brief Transitive closure of a condensed graph.
+///
+/// Strongly connected components must be numbered in postorder, so edges
+/// go from larger numbers to smaller ones (llvm::scc_iterator visits
+/// components in this order). Edges to the same component are allowed, in
+/// this case the component is reachable from itself.
+///
+/// In addition, this class maintains a set of sources and allows to check
+/// in constant time whether a component is reachable from any of them.
+class SCCReachability {
+public:
+  SCCReachability() = default;
+
+  /// Create graph with a specified number of components and without edges.
+  explicit SCCReachability(std::size_t NumberOfSCCs)
+      : mReachable(NumberOfSCCs, llvm::BitVector(NumberOfSCCs)),
+        mFromSources(NumberOfSCCs) {}
+
+  /// Return number of components.
+  std::size_t size() const noexcept { return mReachable.size(); }
+
+  /// Add an edge, edges must be added before closure is computed.
+  void addEdge(std::size_t From, std::size_t To) {
+    assert(From < size() && To <= From &&
+           "Components must be numbered in postorder!");
+    mReachable[From].set(To);
+  }
+
+  /// Compute transitive closure in a single pass over components.
+  ///
+  /// Components are visited in increasing order of numbers, so closure is
+  /// already known for all successors of a visited component.
+  void compute() {
+    llvm::BitVector Adjacent;
+    for (std::size_t From = 0, EF = size(); From < EF; ++From) {
+      Adjacent = mReachable[From];
+      for (auto To : Adjacent.set_bits())
+        if (To != From)
+          mReachable[From] |= mReachable[To];
+    }
+  }
+
+  /// Return true if `To` is reachable from `From` via a non-empty path.
+  bool isReachable(std::size_t From, std::size_t To) const {
+    assert(From < size() && To < size() && "Unknown component!");
+    return mReachable[From].test(To);
+  }
+
+  /// Return components which are reachable from a specified one.
+  const llvm::BitVector &reachable(std::size_t From) const {
+    assert(From < size() && "Unknown component!");
+    return mReachable[From];
+  }
+
+  /// Add a source, closure must be already computed.
+  ///
+  /// The source is also marked as reachable from sources.
+  void addSource(std::size_t Id) {
+    assert(Id < size() && "Unknown component!");
+    mFromSources |= mReachable[Id];
+    mFromSources.set(Id);
+  }
+
+  /// Return true if a specified component is a source or it is reachable
+  /// from some of sources.
+  bool isReachableFromSources(std::size_t Id) const {
+    assert(Id < size() && "Unknown component!");
+    return mFromSources.test(Id);
+  }
+
+  /// Remove all components.
+  void clear() {
+    mReachable.clear();
+    mFromSources.clear();
+  }
+
+private:
+  std::vector<llvm::BitVector> mReachable;
+  llvm::BitVector mFromSources;
+};
+}
+#endif//TSAR_SCC_REACHABILITY_H
@@ -28,6 +28,7 @@
 #define TSAR_ANALYSIS_SOCKET_H
 
 #include "tsar/Support/AnalysisWrapperPass.h"
+#include "tsar/Support/TraceProfiler.h"
 #include <bcl/cell.h>
 #include <bcl/IntrusiveConnection.h>
 #include <bcl/Json.h>
@@ -35,6 +36,7 @@
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringExtras.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Function.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <llvm/ADT/Optional.h>
@@ -168,6 +170,7 @@ public:
     bcl::TypeList<AnalysisType...>::for_each_type(PushBackAnalysisID{R});
     auto Request =
         json::Parser<AnalysisRequest>::unparseAsObject(R) + Delimiter;
+    TraceScope Scope("AnalysisRequest");
     for (auto &Callback : mReceiveCallbacks)
       Callback(Request);
     // Note, that callback run send() in client, so mAnalysisPass is already
@@ -195,6 +198,7 @@ public:
     bcl::TypeList<AnalysisType...>::for_each_type(PushBackAnalysisID{R});
     auto Request =
         json::Parser<AnalysisRequest>::unparseAsObject(R) + Delimiter;
+    TraceScope Scope("AnalysisRequest", F.getName());
     for (auto &Callback : mReceiveCallbacks)
       Callback(Request);
     // Note, that callback run send() in client, so mAnalysisPass is already
@@ -212,6 +216,7 @@ public:
 
   /// Wait notification from a server.
   void wait() {
+    TraceScope Scope("AnalysisWait");
     do {
       for (auto &Callback : mReceiveCallbacks)
         Callback({ Wait });
@@ -223,6 +228,7 @@ public:
   /// Notify server that all requests have been processed and it may execute
   /// further passes.
   void release() {
+    TraceScope Scope("AnalysisRelease");
     do {
       for (auto &Callback : mReceiveCallbacks)
         Callback({ Release });
@@ -0,0 +1,168 @@
+//===--- ASTIndex.h ------- Index Of Function AST ---------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a flat index of statements in a function which is built
+// in a single traversal of AST. AST-level analysis passes use this index
+// instead of their own traversals of the same function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_CLANG_AST_INDEX_H
+#define TSAR_CLANG_AST_INDEX_H
+
+#include "tsar/Analysis/Clang/Passes.h"
+#include <bcl/utility.h>
+#include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Pass.h>
+#include <vector>
+
+namespace clang {
+class FunctionDecl;
+class SourceManager;
+class Stmt;
+class VarDecl;
+}
+
+namespace tsar {
+/// Flat representation of statements in a function.
+///
+/// Statements are stored in the order of traversal of AST (a statement
+/// precedes its children), so all statements nested in a statement with
+/// an index `I` have indices in `[I + 1, End)`.
+class ClangASTIndex {
+  class Builder;
+
+public:
+  /// This is an index of statements which are not in the index, for example
+  /// it is a parent index of top-level statements.
+  static constexpr unsigned NoIndex = ~0u;
+
+  /// Description of a statement.
+  struct StmtInfo {
+    clang::Stmt *S;
+    /// Index of the innermost statement which contains this one.
+    unsigned Parent;
+    /// Index which follows the last statement nested in this one.
+    unsigned End;
+    /// Expansion location of the statement beginning.
+    clang::SourceLocation ExpansionLoc;
+  };
+
+  /// Description of a variable declaration.
+  struct VarInfo {
+    clang::VarDecl *D;
+    /// Index of the innermost statement which contains the declaration,
+    /// it is NoIndex for parameters.
+    unsigned Parent;
+  };
+
+  using StmtList = std::vector<StmtInfo>;
+  using iterator = StmtList::const_iterator;
+  using IndexList = llvm::SmallVector<unsigned, 8>;
+
+  /// Build index for a specified function.
+  void build(clang::FunctionDecl &FD, const clang::SourceManager &SrcMgr);
+
+  /// Remove all statements from the index.
+  void clear();
+
+  /// Return an indexed function or nullptr if index is empty.
+  clang::FunctionDecl * getFunction() const noexcept { return mFunc; }
+
+  iterator begin() const { return mStmts.begin(); }
+  iterator end() const { return mStmts.end(); }
+
+  unsigned size() const { return mStmts.size(); }
+  bool empty() const { return mStmts.empty(); }
+
+  const StmtInfo & operator[](unsigned Idx) const { return mStmts[Idx]; }
+
+  /// Return index of a specified statement or NoIndex if the statement
+  /// has not been indexed.
+  unsigned getIndex(const clang::Stmt *S) const {
+    auto Itr = mStmtToIdx.find(S);
+    return Itr == mStmtToIdx.end() ? NoIndex : Itr->second;
+  }
+
+  /// Return indices of for, while and do-while loops.
+  llvm::ArrayRef<unsigned> loops() const noexcept { return mLoops; }
+
+  /// Return indices of references to declarations.
+  llvm::ArrayRef<unsigned> declRefs() const noexcept { return mDeclRefs; }
+
+  /// Return indices of calls.
+  llvm::ArrayRef<unsigned> calls() const noexcept { return mCalls; }
+
+  /// Return variables (including parameters) declared in the function in
+  /// the order of AST traversal.
+  llvm::ArrayRef<VarInfo> vars() const noexcept { return mVars; }
+
+  /// Return indices of statements which start at a specified expansion
+  /// location.
+  llvm::ArrayRef<unsigned>
+  findByExpansionLoc(clang::SourceLocation Loc) const {
+    auto Itr = mLocToStmts.find(Loc.getRawEncoding());
+    return Itr == mLocToStmts.end() ? llvm::ArrayRef<unsigned>()
+                                    : llvm::makeArrayRef(Itr->second);
+  }
+
+private:
+  clang::FunctionDecl *mFunc = nullptr;
+  StmtList mStmts;
+  llvm::DenseMap<const clang::Stmt *, unsigned> mStmtToIdx;
+  IndexList mLoops;
+  IndexList mDeclRefs;
+  IndexList mCalls;
+  std::vector<VarInfo> mVars;
+  llvm::DenseMap<unsigned, llvm::SmallVector<unsigned, 1>> mLocToStmts;
+};
+}
+
+namespace llvm {
+/// This per-function pass builds index of statements in a function.
+class ClangASTIndexPass : public FunctionPass, private bcl::Uncopyable {
+public:
+  /// Pass identification, replacement for typeid.
+  static char ID;
+
+  /// Default constructor.
+  ClangASTIndexPass() : FunctionPass(ID) {
+    initializeClangASTIndexPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  /// Returns index of statements in an analyzed function.
+  const tsar::ClangASTIndex & getIndex() const noexcept { return mIndex; }
+
+  /// Builds index for a specified function.
+  bool runOnFunction(Function &F) override;
+
+  void releaseMemory() override { mIndex.clear(); }
+
+  /// Specifies a list of analyzes that are necessary for this pass.
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+private:
+  tsar::ClangASTIndex mIndex;
+};
+}
+#endif//TSAR_CLANG_AST_INDEX_H
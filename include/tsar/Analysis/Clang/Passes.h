@@ -84,6 +84,12 @@ void initializeClangExprMatcherPassPass(PassRegistry &Registry);
 /// Create a pass to match high-level and low-level expressions.
 FunctionPass * createClangExprMatcherPass();
 
+/// Initialize a pass to build index of statements in a function.
+void initializeClangASTIndexPassPass(PassRegistry &Registry);
+
+/// Create a pass to build index of statements in a function.
+FunctionPass * createClangASTIndexPass();
+
 /// Initialize a pass to match high-level and low-level loops.
 void initializeLoopMatcherPassPass(PassRegistry &Registry);
 
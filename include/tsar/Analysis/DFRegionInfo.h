@@ -34,12 +34,17 @@
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/Allocator.h>
 
 namespace tsar {
 /// \brief Builds hierarchy of regions for the specified region level.
 ///
 /// To obtain the whole constructed hierarchy it is necessary to use
 /// DFRegionInfoPass.
+///
+/// All nodes of the hierarchy are allocated in a bump-pointer arena which is
+/// owned by this class, so nodes of a graph are placed in memory close to each
+/// other and the whole hierarchy is freed at once.
 class DFRegionInfo : private bcl::Uncopyable {
   typedef llvm::DenseMap<const llvm::BasicBlock *, tsar::DFNode *> BBToNodeMap;
 public:
@@ -55,14 +60,10 @@ public:
   /// Returns the smallest region that surrounds a specified loop.
   tsar::DFNode * getRegionFor(llvm::Loop *L) const;
 
+  ~DFRegionInfo() { releaseMemory(); }
+
   /// Releases memory.
-  void releaseMemory() {
-    if (mTopLevelRegion) {
-      delete mTopLevelRegion;
-      mTopLevelRegion = nullptr;
-    }
-    mBBToNode.clear();
-  }
+  void releaseMemory();
 
   /// \brief Treats all loops in a function as regions and build the region
   /// hierarchy.
@@ -94,8 +95,18 @@ private:
   template<class LoopReptn>
   void buildLoopRegion(LoopReptn L, tsar::DFRegion *R);
 
+  /// Creates a new node in the arena.
+  template<class NodeT, class... ArgT> NodeT * createNode(ArgT &&... Args) {
+    return new (mAllocator.Allocate<NodeT>())
+      NodeT(std::forward<ArgT>(Args)...);
+  }
+
+  /// Destroys a specified node and all nodes inside it, memory is not freed.
+  void destroyNode(tsar::DFNode *N);
+
   tsar::DFNode *mTopLevelRegion = nullptr;
   BBToNodeMap mBBToNode;
+  llvm::BumpPtrAllocator mAllocator;
 };
 }
 
@@ -0,0 +1,125 @@
+//===--- IRChangeTracker.h ---- IR Change Tracker ---------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines fingerprints of functions which allow us to determine
+// functions which have been changed by transformation passes. Analysis passes
+// use fingerprints to recompute results for changed functions only and to
+// reuse results of the previous run for other functions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_IR_CHANGE_TRACKER_H
+#define TSAR_IR_CHANGE_TRACKER_H
+
+#include "tsar/Analysis/Passes.h"
+#include "tsar/Support/AnalysisWrapperPass.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/Module.h>
+
+namespace llvm {
+class CallGraph;
+class Function;
+}
+
+namespace tsar {
+/// Fingerprints of functions which have been computed at the last snapshot.
+///
+/// A fingerprint depends on addresses of basic blocks and instructions, so
+/// results of analysis which refer to values in a function remain valid
+/// if the fingerprint of this function is not changed. Metadata attached to
+/// instructions (debug locations and loop identifiers) and initializers of
+/// accessed global variables are also taken into account, because
+/// metadata-level results depend on them.
+class IRChangeInfo {
+public:
+  /// Compute fingerprint of a specified function.
+  static llvm::hash_code fingerprint(const llvm::Function &F);
+
+  /// Remember fingerprints of all functions with body in a specified module.
+  void snapshot(const llvm::Module &M);
+
+  /// Return true if a snapshot has been already made.
+  bool hasSnapshot() const noexcept { return mHasSnapshot; }
+
+  /// Return true if a specified function has been changed (or created) since
+  /// the last snapshot.
+  ///
+  /// If there is no snapshot all functions are considered as changed.
+  bool isChanged(const llvm::Function &F) const;
+
+  /// Forget all fingerprints, so all functions are considered as changed.
+  ///
+  /// Interprocedural analysis passes call this method if their results have
+  /// been built from scratch (or have been discarded), so results of
+  /// analysis which depend on them should be also recomputed.
+  void clear() {
+    mFingerprints.clear();
+    mHasSnapshot = false;
+  }
+
+private:
+  llvm::DenseMap<const llvm::Function *, llvm::hash_code> mFingerprints;
+  bool mHasSnapshot = false;
+};
+
+/// Functions which results of analysis should be recomputed.
+using OutdatedFunctionSet = llvm::DenseSet<const llvm::Function *>;
+
+/// Collect functions which results of interprocedural analysis may be
+/// changed since the last snapshot.
+///
+/// A function is outdated if it has been changed, changes are propagated
+/// to callers of an outdated function. If `IsBidirectional` is set changes
+/// are also propagated to callees, so connected components of a call graph are
+/// processed as a whole (this is useful for analysis which results for
+/// callees depend on callers).
+///
+/// Edges from the external calling node are ignored, so it is expected that
+/// a fingerprint covers properties of a function which are reflected by these
+/// edges.
+OutdatedFunctionSet findOutdatedFunctions(const IRChangeInfo &Info,
+                                          llvm::CallGraph &CG,
+                                          bool IsBidirectional);
+
+/// Remove results of analysis for outdated functions and for functions which
+/// have been removed from a specified module.
+template <class FunctionMapT>
+void eraseOutdatedResults(const llvm::Module &M,
+                          const OutdatedFunctionSet &Outdated,
+                          FunctionMapT &Results) {
+  llvm::SmallPtrSet<const llvm::Function *, 32> Functions;
+  for (auto &F : M)
+    Functions.insert(&F);
+  for (auto I = Results.begin(), EI = Results.end(); I != EI;) {
+    auto Cur = I++;
+    if (Outdated.count(Cur->getFirst()) || !Functions.count(Cur->getFirst()))
+      Results.erase(Cur);
+  }
+}
+}
+
+namespace llvm {
+/// Wrapper to access fingerprints of functions.
+using IRChangeTrackerWrapper = AnalysisWrapperPass<tsar::IRChangeInfo>;
+}
+#endif//TSAR_IR_CHANGE_TRACKER_H
@@ -0,0 +1,78 @@
+//===- AffineDependence.h - Exact Test For Affine Subscripts ----*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an exact integer dependence test for array accesses with
+// affine subscripts (see DIAffineSubscript). The test is based on the Omega
+// test: equalities are eliminated exactly and inequalities are eliminated with
+// Fourier-Motzkin elimination with integer tightening (real and dark shadows).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_AFFINE_DEPENDENCE_H
+#define TSAR_AFFINE_DEPENDENCE_H
+
+#include "tsar/Analysis/Memory/DIArrayAccess.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+namespace tsar {
+/// Result of the exact dependence test.
+struct AffineDependence {
+  /// Direction of a dependence at a level of a loop nest.
+  enum Direction : uint8_t {
+    None = 0,
+    LT = 1u << 0,
+    EQ = 1u << 1,
+    GT = 1u << 2,
+    All = LT | EQ | GT
+  };
+
+  /// Possible directions for each common loop (from the outermost one) under
+  /// condition that source and destination are executed on the same iteration
+  /// of all outer loops.
+  llvm::SmallVector<uint8_t, 4> Directions;
+
+  /// This is `false` if the test has been interrupted for some levels. In this
+  /// case directions at these levels are conservatively assumed.
+  bool IsExact = true;
+};
+
+/// Return maximum iteration number of a loop if it is known.
+using MaxIterationFn =
+    llvm::function_ref<llvm::Optional<int64_t>(DIArrayAccess::Scope)>;
+
+/// Check dependence between two accesses to the same array.
+///
+/// Each loop in a subscript is represented with an iteration number
+/// `0 <= I <= MaxIteration`. Accesses are dependent if there are iterations
+/// of the source and the destination which access the same element.
+///
+/// \param [in] CommonLoops Loops which contain both accesses (from the
+/// outermost one).
+/// \param [in] Budget Maximum number of constraints which can be produced.
+/// \return `None` if some subscripts are not affine.
+llvm::Optional<AffineDependence>
+testAffineDependence(const DIArrayAccess &Src, const DIArrayAccess &Dst,
+                     llvm::ArrayRef<DIArrayAccess::Scope> CommonLoops,
+                     MaxIterationFn MaxIteration, unsigned Budget);
+}
+#endif//TSAR_AFFINE_DEPENDENCE_H
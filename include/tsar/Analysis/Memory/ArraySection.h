@@ -0,0 +1,132 @@
+//===--- ArraySection.h --- Summary Of Array Sections -----------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines interprocedural summaries of memory accessed in functions.
+// A summary is a list of regular sections, each section is a range of bytes
+// accessed through a formal pointer parameter. Bounds of ranges are linear
+// functions of integer formal parameters, so a summary can be instantiated
+// at each call site of a function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_ARRAY_SECTION_H
+#define TSAR_ARRAY_SECTION_H
+
+#include "tsar/Analysis/Memory/Passes.h"
+#include "tsar/Support/AnalysisWrapperPass.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <cstdint>
+
+namespace llvm {
+class CallBase;
+class Function;
+class Loop;
+class SCEV;
+class ScalarEvolution;
+class Type;
+}
+
+namespace tsar {
+/// Linear function of integer formal parameters of a function,
+/// `Constant + Coef_1 * Param_1 + ... + Coef_n * Param_n`.
+///
+/// Each parameter may be extended to the type of a bound.
+class ArraySectionBound {
+public:
+  enum CastKind : uint8_t { NoCast, SExt, ZExt };
+
+  struct Term {
+    unsigned ArgNo;
+    int64_t Coef;
+    CastKind Cast;
+  };
+
+  using TermList = llvm::SmallVector<Term, 2>;
+
+  explicit ArraySectionBound(int64_t C = 0) : mConstant(C) {}
+
+  int64_t getConstant() const noexcept { return mConstant; }
+  llvm::ArrayRef<Term> terms() const noexcept { return mTerms; }
+
+  /// Return true if the bound is a constant.
+  bool isConstant() const noexcept { return mTerms.empty(); }
+
+  /// Add a specified constant, return `false` on overflow.
+  bool addConstant(int64_t C);
+
+  /// Add `Coef * Param`, return `false` on overflow.
+  bool addTerm(unsigned ArgNo, int64_t Coef, CastKind Cast);
+
+  /// Return true if both bounds differ in a constant only.
+  bool hasSameTerms(const ArraySectionBound &RHS) const;
+
+private:
+  int64_t mConstant;
+  TermList mTerms;
+};
+
+/// Range of bytes `[Lower, Upper)` accessed through a formal pointer parameter,
+/// offsets are calculated from the address which is stored in the parameter.
+struct ArraySection {
+  unsigned ArgNo;
+  ArraySectionBound Lower;
+  ArraySectionBound Upper;
+  bool IsRead;
+  bool IsWrite;
+};
+
+/// Summary of memory which is accessed in a function.
+///
+/// Functions which access memory which is not available through formal
+/// parameters (for example, global memory) do not have summaries.
+/// Memory allocated in a function is not mentioned in a summary.
+using ArraySectionSummary = llvm::SmallVector<ArraySection, 4>;
+
+/// Summaries for functions in a module.
+using InterprocArraySectionInfo =
+    llvm::DenseMap<const llvm::Function *, ArraySectionSummary>;
+
+/// Return expression which is equal to a specified bound at a specified call,
+/// expression has type `Ty` or nullptr if it can not be built.
+const llvm::SCEV *instantiateBound(const ArraySectionBound &Bound,
+                                   const llvm::CallBase &Call, llvm::Type *Ty,
+                                   llvm::ScalarEvolution &SE);
+
+/// Compute lower (upper if `IsMax` is set) bound of a specified expression
+/// over all iterations of loops for which `IsEliminated` returns `true`.
+///
+/// Wrapping of expressions is not checked. If `IsSafeTypeCast` is set then
+/// casts do not change order of values.
+/// \return nullptr if a bound can not be computed.
+const llvm::SCEV *
+getLoopBound(const llvm::SCEV *Expr, bool IsMax,
+             llvm::function_ref<bool(const llvm::Loop *)> IsEliminated,
+             llvm::ScalarEvolution &SE, bool IsSafeTypeCast);
+}
+
+namespace llvm {
+/// Wrapper to access summaries of array sections accessed in functions.
+using GlobalArraySectionWrapper =
+  AnalysisWrapperPass<tsar::InterprocArraySectionInfo>;
+}
+#endif//TSAR_ARRAY_SECTION_H
@@ -40,6 +40,11 @@
 #include <llvm/InitializePasses.h>
 #include <vector>
 
+namespace llvm {
+class SCEV;
+class ScalarEvolution;
+}
+
 namespace tsar {
 class DIArraySubscript;
 class DIArrayAccessInfo;
@@ -563,6 +568,18 @@ private:
   ScopeToAccessMap mScopeToAccesses;
   ArrayToAccessMap mArrayToAccesses;
 };
+
+/// Build affine subscript `DimIdx` of a specified access from a specified
+/// expression.
+///
+/// Each loop in the expression is represented with its identifier, so
+/// all loops must have identifiers.
+/// \return `nullptr` if the expression is not an affine function of
+/// iteration numbers with constant coefficients.
+DIAffineSubscript *buildAffineSubscript(DIArrayAccess &Access, unsigned DimIdx,
+                                        const llvm::SCEV *Expr,
+                                        llvm::ScalarEvolution &SE,
+                                        bool IsSafeTypeCast);
 } // namespace tsar
 
 namespace llvm {
@@ -44,6 +44,7 @@
 #include <bcl/utility.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/Analysis/AliasSetTracker.h>
 #ifdef LLVM_DEBUG
 # include <llvm/IR/Instruction.h>
@@ -307,6 +308,22 @@ public:
     return mAddressUnknowns.insert(I).second;
   }
 
+  /// Return true if both sets contain the same locations and instructions.
+  bool operator==(const DefUseSet &RHS) const {
+    auto isSame = [](const auto &LHS, const auto &RHS) {
+      return LHS.size() == RHS.size() &&
+             llvm::all_of(LHS, [&RHS](auto *V) { return RHS.count(V) != 0; });
+    };
+    return mDefs == RHS.mDefs && mMayDefs == RHS.mMayDefs &&
+           mUses == RHS.mUses && mExplicitAccesses == RHS.mExplicitAccesses &&
+           isSame(mAddressAccesses, RHS.mAddressAccesses) &&
+           isSame(mUnknownInsts, RHS.mUnknownInsts) &&
+           isSame(mExplicitUnknowns, RHS.mExplicitUnknowns) &&
+           isSame(mAddressUnknowns, RHS.mAddressUnknowns);
+  }
+
+  bool operator!=(const DefUseSet &RHS) const { return !operator==(RHS); }
+
 private:
   LocationSet mDefs;
   LocationSet mMayDefs;
@@ -62,6 +62,7 @@
 #include <bcl/trait.h>
 #include <bcl/utility.h>
 #include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/DenseMapInfo.h>
 #include <llvm/ADT/GraphTraits.h>
 #include <llvm/ADT/iterator.h>
@@ -749,15 +750,15 @@ protected:
   ///
   /// This method is potentially slow because in the worst cast it uses
   /// AAResults::alias() method to compare all possible pairs of ambiguous
-  /// pointers.
+  /// pointers (results of queries are cached in the alias tree `G`).
   /// \return True in case of alias relation, if a known location is found it
   /// is returned as a second part of a pair.
   std::pair<bool, EstimateMemory *> slowMayAlias(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// This is a stub for nodes which does not support slowMayAlias().
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-      const EstimateMemory &/*EM*/, llvm::AAResults &/*AA*/) {
+      const EstimateMemory &/*EM*/, const AliasTree &/*G*/) {
     llvm_unreachable("slowMayAlias() is not implemented for this node!");
     return std::make_pair(false, nullptr);
   }
@@ -853,7 +854,7 @@ private:
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, llvm::Instruction *> slowMayAliasUnknownImp(
@@ -924,7 +925,7 @@ private:
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, llvm::Instruction *> slowMayAliasUnknownImp(
@@ -1028,6 +1029,16 @@ public:
   /// Returns the underlying alias analysis object used by this tree.
   llvm::AAResults & getAliasAnalysis() const noexcept { return *mAA; }
 
+  /// \brief Checks whether two locations may alias.
+  ///
+  /// This uses the underlying alias analysis and caches results of queries,
+  /// so IR must not be changed until the cache is released.
+  llvm::AliasResult alias(const llvm::MemoryLocation &LHS,
+    const llvm::MemoryLocation &RHS) const;
+
+  /// Releases cached results of alias queries.
+  void releaseAliasCache() { mAliasCache.clear(); }
+
   /// Returns a dominator tree used by this alias tree.
   const llvm::DominatorTree & getDomTree() const noexcept { return *mDT; }
 
@@ -1174,6 +1185,19 @@ private:
   AliasEstimateNode * addEmptyNode(
     const EstimateMemory &NewEM, AliasNode &Start);
 
+  /// Updates index of underlying objects for all locations with the same
+  /// ambiguous pointers as a specified location `EM`.
+  void indexMemory(EstimateMemory &EM);
+
+  /// \brief Collects locations which may alias a specified location `EM`.
+  ///
+  /// If each ambiguous pointer of `EM` refers to an identified object, a
+  /// location may alias `EM` only if it refers to one of these objects or
+  /// if it refers to not identified object.
+  /// \return `false` if locations which may alias `EM` are not known.
+  bool collectMayAlias(const EstimateMemory &EM,
+    llvm::SmallVectorImpl<EstimateMemory *> &MayAlias) const;
+
   /// Checks whether pointers to specified locations may refer the same address.
   llvm::AliasResult isSamePointer(
     const EstimateMemory &EM, const llvm::MemoryLocation &Loc) const;
@@ -1206,6 +1230,14 @@ private:
   tsar::AmbiguousRef::AmbiguousPool mAmbiguousPool;
   StrippedMap mBases;
   mutable llvm::DenseMap<llvm::MemoryLocation, EstimateMemory *> mSearchCache;
+  mutable llvm::DenseMap<
+    std::pair<llvm::MemoryLocation, llvm::MemoryLocation>, llvm::AliasResult>
+      mAliasCache;
+  /// Locations which refer to identified objects (see isIdentifiedObject()).
+  llvm::DenseMap<const llvm::Value *, llvm::SmallPtrSet<EstimateMemory *, 4>>
+    mObjectIndex;
+  /// Locations which may refer to not identified objects.
+  llvm::SmallPtrSet<EstimateMemory *, 16> mUnidentifiedMemory;
 };
 
 inline void EstimateMemory::setAliasNode(
@@ -1235,17 +1267,17 @@ inline void AliasNode::mergeNodeIn(AliasNode &AN, const AliasTree &G) {
 }
 
 inline std::pair<bool, EstimateMemory *> AliasNode::slowMayAlias(
-    const EstimateMemory &EM, llvm::AAResults &AA) {
+    const EstimateMemory &EM, const AliasTree &G) {
   switch (getKind()) {
   default:
     llvm_unreachable("Unknown kind of an alias node!");
     break;
   case KIND_TOP:
-    return llvm::cast<AliasTopNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasTopNode>(this)->slowMayAliasImp(EM, G);
   case KIND_ESTIMATE:
-    return llvm::cast<AliasEstimateNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasEstimateNode>(this)->slowMayAliasImp(EM, G);
   case KIND_UNKNOWN:
-    return llvm::cast<AliasUnknownNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasUnknownNode>(this)->slowMayAliasImp(EM, G);
   }
 }
 
@@ -407,14 +407,24 @@ public:
   }
 
   /// Realize intersection between two sets.
+  ///
+  /// Locations are grouped by a base pointer and groups do not interact with
+  /// each other. So, the intersection is computed in place: groups which are
+  /// not presented in `With` are dropped entirely and only the remaining
+  /// groups are rebuilt.
   template<class Ty> bool intersect(const MemorySet<Ty> &With) {
     if (this == &With)
       return false;
-    MapTy PrevLocations;
-    mLocations.swap(PrevLocations);
     bool IsChanged = false;
-    for (auto &Pair : PrevLocations) {
-      for (auto &Loc : Pair.second) {
+    LocationList PrevList;
+    for (auto I = mLocations.begin(), EI = mLocations.end(); I != EI; ++I) {
+      if (!With.mLocations.count(I->first)) {
+        mLocations.erase(I);
+        continue;
+      }
+      PrevList.clear();
+      PrevList.swap(I->second);
+      for (auto &Loc : PrevList) {
         if (With.contain(Loc)) {
           insert(Loc);
           continue;
@@ -424,6 +434,8 @@ public:
         if (!CoveredBy.empty())
           IsChanged |= insert(CoveredBy.begin(), CoveredBy.end());
       }
+      if (I->second.empty())
+        mLocations.erase(I);
     }
     return IsChanged;
   }
@@ -433,9 +445,14 @@ public:
     if (this == &With)
       return false;
     bool IsChanged = false;
-    for (auto &Pair : With.mLocations)
+    for (auto &Pair : With.mLocations) {
+      auto I = mLocations.find(Pair.first);
+      if (I != mLocations.end() && isSameList(I->second, Pair.second) &&
+          isSeparated(I->second))
+        continue;
       for (auto &Loc : Pair.second)
         IsChanged |= insert(Loc).second;
+    }
     return IsChanged;
   }
 
@@ -477,6 +494,8 @@ public:
       auto I = RHS.mLocations.find(Pair.first);
       if (I == RHS.mLocations.end())
         return false;
+      if (isSameList(Pair.second, I->second))
+        continue;
       LocationList LHSSet, RHSSet;
       sanitize(Pair.second.begin(), Pair.second.end(), LHSSet);
       sanitize(I->second.begin(), I->second.end(), RHSSet);
@@ -486,6 +505,37 @@ public:
     return true;
   }
 private:
+  /// Return true if lists contain the same locations in the same order.
+  ///
+  /// Bounds and AATags of locations are compared.
+  template<class ListT>
+  static bool isSameList(const LocationList &LHS, const ListT &RHS) {
+    if (LHS.size() != RHS.size())
+      return false;
+    for (std::size_t Idx = 0, EIdx = LHS.size(); Idx < EIdx; ++Idx)
+      if (MemoryInfo::sizecmp(MemoryInfo::getLowerBound(LHS[Idx]),
+                              MemoryInfo::getLowerBound(RHS[Idx])) != 0 ||
+          MemoryInfo::sizecmp(MemoryInfo::getUpperBound(LHS[Idx]),
+                              MemoryInfo::getUpperBound(RHS[Idx])) != 0 ||
+          MemoryInfo::getAATags(LHS[Idx]) != MemoryInfo::getAATags(RHS[Idx]))
+        return false;
+    return true;
+  }
+
+  /// Return true if locations in a list are sorted and neither overlap nor
+  /// adjoin each other.
+  ///
+  /// Insertion of a location from such list into the list itself does not
+  /// change the list. Note, that `insert()` may extend a location, so it
+  /// is not guaranteed that each list is separated.
+  static bool isSeparated(const LocationList &Locs) {
+    for (std::size_t Idx = 1, EIdx = Locs.size(); Idx < EIdx; ++Idx)
+      if (MemoryInfo::sizecmp(MemoryInfo::getUpperBound(Locs[Idx - 1]),
+                              MemoryInfo::getLowerBound(Locs[Idx])) >= 0)
+        return false;
+    return true;
+  }
+
   template<class SizeT>
   static const SizeT & max(const SizeT &L, const SizeT &R) {
     if (MemoryInfo::sizecmp(L, R) < 0)
@@ -191,6 +191,22 @@ ImmutablePass *createGlobalDefinedMemoryStorage();
 /// analysis.
 void initializeGlobalDefinedMemoryWrapperPass(PassRegistry &Registry);
 
+/// Initialize a pass to compute summaries of array sections accessed in
+/// functions.
+void initializeGlobalArraySectionPass(PassRegistry &Registry);
+
+/// Create a pass to compute summaries of array sections accessed in functions.
+ModulePass *createGlobalArraySectionPass();
+
+/// Initialize a pass to store summaries of array sections.
+void initializeGlobalArraySectionStoragePass(PassRegistry &Registry);
+
+/// Create a pass to store summaries of array sections.
+ImmutablePass *createGlobalArraySectionStorage();
+
+/// Initialize a pass to access summaries of array sections.
+void initializeGlobalArraySectionWrapperPass(PassRegistry &Registry);
+
 /// Create analysis server.
 ModulePass *createDIMemoryAnalysisServer();
 
@@ -33,12 +33,14 @@
 #include "tsar/Analysis/DataFlowGraph.h"
 #include "tsar/ADT/DenseMapTraits.h"
 #include "tsar/ADT/GraphNumbering.h"
+#include "tsar/Analysis/Memory/ArraySection.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
 #include "tsar/Analysis/Memory/DFMemoryLocation.h"
 #include "tsar/Analysis/Memory/IRMemoryTrait.h"
 #include "tsar/Analysis/Memory/LiveMemory.h"
 #include "tsar/Analysis/Memory/Passes.h"
 #include <bcl/utility.h>
+#include <llvm/ADT/Optional.h>
 #include <llvm/Analysis/MemoryLocation.h>
 #include <llvm/Pass.h>
 #include <forward_list>
@@ -51,6 +53,9 @@ class DefUseSet;
 class DFLoop;
 class EstimateMemory;
 class BitMemoryTrait;
+class DelinearizeInfo;
+struct AffineDependence;
+struct GlobalOptions;
 template<class GraphType> class SpanningTreeRelation;
 
 /// This determine relation between two nodes in an alias tree.
@@ -79,6 +84,7 @@ class DependenceInfo;
 }
 
 class Loop;
+class LoopInfo;
 class TargetLibraryInfo;
 class ScalarEvolution;
 
@@ -178,6 +184,10 @@ public:
     mDL = nullptr;
     mTLI = nullptr;
     mSE = nullptr;
+    mLI = nullptr;
+    mDelinInfo = nullptr;
+    mGlobalOpts = nullptr;
+    mArraySections = nullptr;
   }
 
   /// Specifies a list of analyzes  that are necessary for this pass.
@@ -188,9 +198,56 @@ public:
   void print(raw_ostream &OS, const Module *M) const override;
 
 private:
-  /// Uses dependence analysis pass to collect loop-carried dependencies in
-  /// a specified loop.
-  void collectDependencies(Loop *L, DependenceMap &Deps,
+  /// \brief Uses dependence analysis pass to collect loop-carried
+  /// dependencies in a specified loop.
+  ///
+  /// Loads and stores are grouped by top-level subtrees of the alias tree.
+  /// Dependence analysis is invoked only for pairs of accesses from the same
+  /// subtree if alias nodes of these accesses are not unreachable from each
+  /// other (accesses from unreachable nodes never alias).
+  void collectDependencies(Loop *L, const tsar::AliasTreeRelation &AliasSTR,
+    DependenceMap &Deps, tsar::detail::DependenceCache &Cache);
+
+  /// Conservatively assumes dependence between a specified instruction `Src`
+  /// which accesses unknown memory and an arbitrary instruction `Dst`.
+  void collectUnknownDependence(Instruction &Src, Instruction &Dst,
+    DependenceMap &Deps);
+
+  /// Conservatively assumes dependence between a specified load or store
+  /// instruction `Src` and an instruction `Dst` which accesses unknown memory.
+  void collectUnknownDependence(Instruction &Src, const MemoryLocation &SrcLoc,
+    Instruction &Dst, DependenceMap &Deps);
+
+  /// Uses summaries of array sections accessed in called functions to update
+  /// collection `Deps` of loop-carried dependencies between `Src` and `Dst`.
+  ///
+  /// Each of `Src` and `Dst` is a load, a store or a call of a function which
+  /// has a summary.
+  /// \return `false` if summaries are not applicable.
+  bool collectSectionDependence(Loop &L, Instruction &Src, Instruction &Dst,
+    DependenceMap &Deps);
+
+  /// Uses dependence analysis to check dependence between two loads or stores.
+  void collectLoadStoreDependence(Loop &L, Instruction &Src,
+    const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, DependenceMap &Deps,
+    tsar::detail::DependenceCache &Cache);
+
+  /// Uses exact test for affine subscripts to check dependence between two
+  /// accesses to the same array.
+  ///
+  /// \return `None` if the test is not applicable.
+  Optional<tsar::AffineDependence> checkAffineDependence(Instruction &Src,
+    const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, tsar::detail::DependenceCache &Cache);
+
+  /// Uses exact test for affine subscripts to update collection `Deps` of
+  /// loop-carried dependencies if dependence analysis is confused.
+  ///
+  /// \return `false` if the test is not applicable.
+  bool collectAffineDependence(Loop &L, Instruction &Src,
+    const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, DependenceMap &Deps,
     tsar::detail::DependenceCache &Cache);
 
   /// Update collection `Deps` of loop-carried dependencies in a specified loop.
@@ -357,6 +414,10 @@ private:
   const DataLayout *mDL = nullptr;
   TargetLibraryInfo *mTLI = nullptr;
   ScalarEvolution *mSE = nullptr;
+  LoopInfo *mLI = nullptr;
+  const tsar::DelinearizeInfo *mDelinInfo = nullptr;
+  const tsar::GlobalOptions *mGlobalOpts = nullptr;
+  const tsar::InterprocArraySectionInfo *mArraySections = nullptr;
 };
 }
 #endif//TSAR_PRIVATE_ANALYSIS_H
@@ -117,5 +117,22 @@ ModulePass *createAnalysisCloseConnectionPass(bool ActiveOnly = false);
 /// Close connection with server (it should be run on client). Client will
 /// be blocked until server confirms that connection can be closed.
 ModulePass *createAnalysisCloseConnectionPass(const void * ServerID);
+
+/// Initialize a pass to access fingerprints of functions.
+void initializeIRChangeTrackerWrapperPass(PassRegistry &Registry);
+
+/// Initialize a pass to store fingerprints of functions.
+void initializeIRChangeTrackerStoragePass(PassRegistry &Registry);
+
+/// Create a pass to store fingerprints of functions.
+ImmutablePass *createIRChangeTrackerStorage();
+
+/// Initialize a pass to remember fingerprints of functions.
+void initializeIRChangeSnapshotPassPass(PassRegistry &Registry);
+
+/// Create a pass to remember fingerprints of functions. Analysis passes
+/// which are executed after the next transformations recompute results for
+/// changed functions only.
+ModulePass *createIRChangeSnapshotPass();
 }
 #endif//TSAR_ANALYSIS_PASSES_H
@@ -0,0 +1,55 @@
+//===- AnalysisBinary.h -- Analysis Results In Binary Form -------*- C++ -*===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines compact binary representation of external analysis results
+// (see AnalysisJSON.h). In contrast to JSON, binary form does not require
+// parsing and it can be read directly from a memory mapped file.
+//
+// Layout of a binary file (all integers are little-endian):
+// - magic string "TSARINFO" followed by a 32-bit version number,
+// - table of strings (file and variable names), each name is stored once,
+// - list of functions, list of variables and list of loops, each element
+//   refers to the table of strings.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ANALYSIS_BINARY_H
+#define ANALYSIS_BINARY_H
+
+#include "tsar/Analysis/Reader/AnalysisJSON.h"
+#include <llvm/ADT/StringRef.h>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace tsar {
+/// Return true if a specified buffer contains analysis results in binary form.
+bool isAnalysisBinary(llvm::StringRef Buffer);
+
+/// Write analysis results to a specified stream in binary form.
+void writeAnalysisBinary(const trait::Info &Info, llvm::raw_ostream &OS);
+
+/// Read analysis results in binary form from a specified buffer.
+///
+/// \return `false` if the buffer does not contain valid analysis results.
+bool readAnalysisBinary(llvm::StringRef Buffer, trait::Info &Info);
+}
+#endif//ANALYSIS_BINARY_H
@@ -0,0 +1,110 @@
+//===- AnalysisCache.h - Persistent Cache of Analysis Results ---*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a content-addressed on-disk cache of analysis results.
+// Each entry contains printed results of analysis of a single module and
+// diagnostics reported during the analysis. The key of an entry is a hash of
+// everything the results depend on: IR of the module including metadata,
+// source files referenced from debug information or included into
+// compilation units, analysis-related options, the list of printed passes and
+// the version of the analyzer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_ANALYSIS_CACHE_H
+#define TSAR_ANALYSIS_CACHE_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+class DiagnosticsEngine;
+class LangOptions;
+}
+
+namespace llvm {
+class Module;
+class PassInfo;
+class raw_ostream;
+}
+
+namespace tsar {
+struct GlobalOptions;
+class TransformationInfo;
+
+/// Content-addressed cache of printed analysis results.
+class AnalysisCache {
+public:
+  /// Computes a key for a specified module and its analysis configuration.
+  ///
+  /// \param [in] Dir Directory to store cached results.
+  /// \param [in] PrintPasses Passes the results of which are printed.
+  /// \param [in] PrintSteps Bit list of steps the results of which are printed.
+  AnalysisCache(llvm::StringRef Dir, const llvm::Module &M,
+                const GlobalOptions &Options,
+                llvm::ArrayRef<const llvm::PassInfo *> PrintPasses,
+                unsigned PrintSteps, TransformationInfo *TfmInfo);
+
+  ~AnalysisCache();
+
+  AnalysisCache(const AnalysisCache &) = delete;
+  AnalysisCache &operator=(const AnalysisCache &) = delete;
+
+  /// Record diagnostics which are reported to a specified engine, so they can
+  /// be stored with results and replayed on a hit.
+  ///
+  /// Diagnostics are still passed to the original client of the engine.
+  /// The client is restored when the cache is destroyed.
+  void recordDiagnostics(clang::DiagnosticsEngine &Diags,
+                         const clang::LangOptions &LangOpts);
+
+  /// Return name of a file which contains cached results.
+  llvm::StringRef getFilename() const { return mFilename; }
+
+  /// Print cached diagnostics and results to a specified stream and restore
+  /// a binary form of external analysis results if it has been requested.
+  ///
+  /// \return `false` if results are not available.
+  bool replay(llvm::raw_ostream &OS) const;
+
+  /// Store results, an existing entry is atomically overwritten.
+  ///
+  /// Recorded diagnostics and a binary form of external analysis results
+  /// (if requested) are stored before the printed results, so the printed
+  /// results are never available without them.
+  void store(llvm::StringRef Results) const;
+
+private:
+  class DiagnosticRecorder;
+
+  std::string mDir;
+  std::string mEmitBinary;
+  llvm::SmallString<128> mFilename;
+  llvm::SmallString<128> mBinaryFilename;
+  llvm::SmallString<128> mDiagFilename;
+  std::string mDiagnostics;
+  std::vector<std::unique_ptr<DiagnosticRecorder>> mRecorders;
+};
+}
+#endif//TSAR_ANALYSIS_CACHE_H
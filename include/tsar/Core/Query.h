@@ -81,6 +81,11 @@ void addBeforeTfmAnalysis(llvm::legacy::PassManager &Passes,
 /// Perform SROA and repeat variable privatization. After that reduction and
 /// induction recognition will be performed. Flow/anti/output dependencies
 /// also analyses.
+///
+/// Interprocedural analysis is repeated only for functions which have been
+/// changed since the previous analysis (and for functions which depend on
+/// them). Results for other functions are reused if a storage of IR
+/// fingerprints (see createIRChangeTrackerStorage()) is available.
 void addAfterSROAAnalysis(const GlobalOptions &GO, const llvm::DataLayout &DL,
                           llvm::legacy::PassManager &Passes);
 
@@ -270,15 +275,18 @@ protected:
 class InstrLLVMQueryManager : public EmitLLVMQueryManager {
 public:
   explicit InstrLLVMQueryManager(llvm::StringRef InstrEntry = "",
-      llvm::ArrayRef<std::string> InstrStart = {}) :
+      llvm::ArrayRef<std::string> InstrStart = {},
+      bool InstrLoopRanges = false) :
     mInstrEntry(InstrEntry),
-    mInstrStart(InstrStart.begin(), InstrStart.end()) {}
+    mInstrStart(InstrStart.begin(), InstrStart.end()),
+    mInstrLoopRanges(InstrLoopRanges) {}
 
   void run(llvm::Module *M, tsar::TransformationInfo *) override;
 
 private:
   std::string mInstrEntry;
   std::vector<std::string> mInstrStart;
+  bool mInstrLoopRanges = false;
 };
 
 /// This performs a specified source-level transformation.
@@ -111,6 +111,7 @@ private:
   bool mDumpAST = false;
   bool mEmitLLVM = false;
   bool mInstrLLVM = false;
+  bool mInstrLoopRanges = false;
   bool mCheck = false;
   bool mPrint = false;
   bool mServer = false;
@@ -119,6 +120,8 @@ private:
   std::string mLanguage;
   std::string mInstrEntry;
   std::vector<std::string> mInstrStart;
+  std::string mTimeTraceFile;
+  unsigned mTimeTraceGranularity = 500;
 };
 }
 #endif//TSAR_TOOL_H
@@ -51,8 +51,11 @@ class ASTMergeAction : public PublicWrapperFrontendAction {
 public:
   /// Creates adapter for a specified action, this adapter merge all
   /// files from a specified set.
+  ///
+  /// Up to `NumThreads` files are loaded in parallel with import of already
+  /// loaded files (0 means the number of hardware threads).
   ASTMergeAction(std::unique_ptr<clang::FrontendAction> WrappedAction,
-    clang::ArrayRef<std::string> ASTFiles);
+    clang::ArrayRef<std::string> ASTFiles, unsigned NumThreads = 1);
 
   /// This action can not evaluate LLVM IR.
   bool hasIRSupport() const override { return false; }
@@ -89,6 +92,7 @@ protected:
     clang::DiagnosticsEngine &Diags) const;
 
   std::vector<std::string> mASTFiles;
+  unsigned mNumThreads;
 };
 
 struct ASTImportInfo;
@@ -101,8 +105,10 @@ public:
   /// files from a specified set and store some information about the import
   /// process in a specified external storage.
   ASTMergeActionWithInfo(std::unique_ptr<clang::FrontendAction> WrappedAction,
-      clang::ArrayRef<std::string> ASTFiles, ASTImportInfo *Out) :
-    ASTMergeAction(std::move(WrappedAction), ASTFiles), mImportInfo(Out) {
+      clang::ArrayRef<std::string> ASTFiles, ASTImportInfo *Out,
+      unsigned NumThreads = 1) :
+    ASTMergeAction(std::move(WrappedAction), ASTFiles, NumThreads),
+    mImportInfo(Out) {
     assert(mImportInfo && "External storage must not be null!");
   }
 
@@ -73,12 +73,29 @@ struct GlobalOptions {
   unsigned MemoryAccessInlineThreshold = 0;
   /// Pass to external analysis results which is used to clarify analysis/
   std::string AnalysisUse = "";
+  /// Store external analysis results (AnalysisUse) in a compact binary form
+  /// to a specified file.
+  std::string AnalysisEmitBinary = "";
+  /// Directory to cache printed analysis results between runs. Cache is
+  /// disabled if this string is empty.
+  std::string AnalysisCacheDir = "";
+  /// Command line arguments (response files are expanded) which are used to
+  /// identify cached analysis results. Options which do not affect analysis
+  /// (for example, the number of threads) are omitted.
+  std::vector<std::string> CommandLine;
   /// List of regions which should be optimized.
   std::vector<std::string> OptRegions;
   /// This suffix should be add to transformed sources before extension.
   std::string OutputSuffix = "";
   /// Disable formatting of a source code after transformation.
   bool NoFormat = false;
+  /// Time limit (in seconds) to solve each independent component of
+  /// a MILP model. Value 0 means that there is no limit.
+  unsigned MILPTimeout = 0;
+  /// Maximum number of threads which can be used to perform independent
+  /// stages of processing. Value 0 means that the number of threads is
+  /// determined by the hardware concurrency.
+  unsigned NumThreads = 1;
 };
 }
 
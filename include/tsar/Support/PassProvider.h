@@ -36,11 +36,17 @@
 // initialize a such passes.
 //
 // To avoid this problems a provider pass could be used.
+//
+// A module pass may also request results for the same function several times
+// (for example, to answer different requests in the analysis server). In this
+// case FunctionPassProviderCache could be used to avoid re-execution of
+// the whole function pass sequence if the function has been processed last.
 //===----------------------------------------------------------------------===//
 
 #ifndef TSAR_PASS_PROVIDER_H
 #define TSAR_PASS_PROVIDER_H
 
+#include <llvm/ADT/Hashing.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/LegacyPassManagers.h>
 #include <llvm/Pass.h>
@@ -205,9 +211,20 @@ public:
   bool runOnFunction(llvm::Function &F) override {
     GetRequiredFunctor GetRequired(this);
     mPasses.for_each(GetRequired);
+    mLastFunction = &F;
     return false;
   }
 
+  /// Forget the last processed function, results of analysis are not
+  /// available after that.
+  void releaseMemory() override { mLastFunction = nullptr; }
+
+  /// Return a function which has been processed last or nullptr if available
+  /// results have been already released.
+  const llvm::Function *getLastFunction() const noexcept {
+    return mLastFunction;
+  }
+
   /// Specifies that all analyzes declared as template parameters of this pass
   /// are required to be performed before execution of the pass.
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
@@ -242,6 +259,7 @@ public:
 private:
   static ProviderListT ProviderList;
   AnalysisMap mPasses;
+  const llvm::Function *mLastFunction = nullptr;
 };
 
 template<class... Analysis>
@@ -292,6 +310,74 @@ struct is_pass_provider<T, enable_if_pass_provider<T>> : std::true_type {};
 template<class T>
 using pass_provider_analysis =
     decltype(detail::check_pass_provider(std::declval<T>()));
+
+/// \brief This accesses results of a provider from a module pass and
+/// avoids re-execution of function passes if results for a requested function
+/// are still available.
+///
+/// Function passes are executed on the fly, so only results for a function
+/// which has been processed last are available. If a provider of type
+/// ProviderT (or any other on the fly pass required by the same module pass)
+/// has been executed for another function, the requested function will be
+/// processed again. A fingerprint of a function (for example,
+/// IRChangeInfo::fingerprint()) is checked to detect modifications of IR.
+/// Computation of a fingerprint visits all instructions of a function, however
+/// it is still much cheaper than execution of function passes.
+///
+/// \code
+/// class P : public ModulePass {
+///   ...
+///   FunctionPassProviderCache<SimpleProviderPass> mProviders{
+///     *this, IRChangeInfo::fingerprint};
+/// };
+/// ...
+/// auto &Provider = mProviders.get(F);
+/// \endcode
+template<class ProviderT, class = enable_if_pass_provider<ProviderT>>
+class FunctionPassProviderCache : private bcl::Uncopyable {
+public:
+  /// Function which computes a fingerprint of IR of a function.
+  using FingerprintFn = llvm::hash_code (*)(const llvm::Function &);
+
+  /// Create cache for a specified pass which requires ProviderT.
+  FunctionPassProviderCache(llvm::Pass &Requester, FingerprintFn Fingerprint)
+      : mRequester(&Requester), mFingerprint(Fingerprint) {
+    assert(mFingerprint && "Fingerprint function must not be null!");
+  }
+
+  /// Return a provider which contains results of analysis for
+  /// a specified function.
+  ProviderT &get(llvm::Function &F) {
+    auto Fingerprint = mFingerprint(F);
+    if (mProvider && mProvider->getLastFunction() == &F &&
+        mLastFingerprint == Fingerprint) {
+      ++mNumHits;
+      return *mProvider;
+    }
+    ++mNumMisses;
+    mProvider = &mRequester->getAnalysis<ProviderT>(F);
+    // Passes from a provider may update metadata attached to a function.
+    mLastFingerprint = mFingerprint(F);
+    return *mProvider;
+  }
+
+  /// Ensure that a provider will be executed on the next request.
+  void invalidate() noexcept { mProvider = nullptr; }
+
+  /// Return number of requests which have not required execution of passes.
+  unsigned getNumHits() const noexcept { return mNumHits; }
+
+  /// Return number of requests which have led to execution of passes.
+  unsigned getNumMisses() const noexcept { return mNumMisses; }
+
+private:
+  llvm::Pass *mRequester;
+  FingerprintFn mFingerprint;
+  ProviderT *mProvider = nullptr;
+  llvm::hash_code mLastFingerprint = 0;
+  unsigned mNumHits = 0;
+  unsigned mNumMisses = 0;
+};
 }
 
 #endif//TSAR_PASS_PROVIDER_H
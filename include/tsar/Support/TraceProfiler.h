@@ -0,0 +1,103 @@
+//===--- TraceProfiler.h ------ Trace Event Profiler ------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a profiler which records wall time and memory usage
+// of analysis steps and writes them in Chrome trace-event format
+// (chrome://tracing, https://ui.perfetto.dev).
+//
+// LLVM time trace profiler is enabled together with this profiler, so time of
+// each pass for each function is recorded by the legacy pass manager. Memory
+// usage of the whole process is sampled periodically, so it can be matched
+// with passes on a timeline. Scopes explicitly marked with TraceScope
+// (loops, functions in interprocedural passes, requests to an analysis
+// server) additionally record how heap usage of the process has been changed
+// during the scope and peak resident set size of the process at the scope
+// end. These values are process-wide, so allocations made by other threads
+// at the same time are also taken into account.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_TRACE_PROFILER_H
+#define TSAR_TRACE_PROFILER_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace llvm {
+class Loop;
+}
+
+namespace tsar {
+/// Enable profiler, events which are shorter than `Granularity` microseconds
+/// are ignored.
+void traceProfilerInitialize(unsigned Granularity, llvm::StringRef ProcName);
+
+/// Return true if profiler is enabled.
+bool isTraceProfilerEnabled();
+
+/// Write all collected events to a specified file and disable profiler.
+llvm::Error traceProfilerWrite(llvm::StringRef Filename);
+
+/// Return description of a loop to be used in trace events.
+std::string getTraceDetail(const llvm::Loop &L);
+
+/// This records an event which lasts while this object is alive.
+///
+/// Description of an event (`Detail`) may be a callable object which is
+/// invoked only if profiler is enabled.
+class TraceScope {
+public:
+  explicit TraceScope(llvm::StringRef Name, llvm::StringRef Detail = "") {
+    if (isTraceProfilerEnabled())
+      begin(Name, Detail.str());
+  }
+
+  template <class DetailT, class = std::enable_if_t<
+                               std::is_invocable_r_v<std::string, DetailT>>>
+  TraceScope(llvm::StringRef Name, DetailT &&Detail) {
+    if (isTraceProfilerEnabled())
+      begin(Name, Detail());
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  ~TraceScope() {
+    if (mIsActive)
+      end();
+  }
+
+private:
+  void begin(llvm::StringRef Name, std::string Detail);
+  void end();
+
+  bool mIsActive = false;
+  std::string mName;
+  std::string mDetail;
+  std::chrono::steady_clock::time_point mStart;
+  /// Heap usage of the whole process at the scope beginning.
+  uint64_t mProcessHeap = 0;
+};
+}
+#endif//TSAR_TRACE_PROFILER_H
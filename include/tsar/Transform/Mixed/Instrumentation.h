@@ -60,9 +60,14 @@ public:
   /// If `StartFrom` is not empty all mentioned functions and transitive
   /// callees from these functions should be processed only.
   /// Other functions will be marked with sapfor.da.ignore metadata.
-  InstrumentationPass(StringRef InstrEntry, ArrayRef<std::string> StartFrom) :
+  ///
+  /// If `LoopRanges` is set accesses to affine ranges of memory inside loops
+  /// are registered once before a loop instead of each iteration.
+  InstrumentationPass(StringRef InstrEntry, ArrayRef<std::string> StartFrom,
+      bool LoopRanges = false) :
       ModulePass(ID), mInstrEntry(InstrEntry),
-      mStartFrom(StartFrom.begin(), StartFrom.end()) {
+      mStartFrom(StartFrom.begin(), StartFrom.end()),
+      mLoopRanges(LoopRanges) {
     initializeInstrumentationPassPass(*PassRegistry::getPassRegistry());
   }
 
@@ -78,9 +83,13 @@ public:
   /// Return names of functions where instrumentation is started.
   ArrayRef<std::string> getStartFrom() const { return mStartFrom; }
 
+  /// Return true if affine accesses inside loops are registered as ranges.
+  bool isLoopRangesEnabled() const noexcept { return mLoopRanges; }
+
 private:
   std::string mInstrEntry;
   std::vector<std::string> mStartFrom;
+  bool mLoopRanges = false;
 };
 }
 
@@ -166,7 +175,7 @@ public:
   void visitAtomicRMWInst(llvm::AtomicRMWInst &I);
   void visitReturnInst(llvm::ReturnInst &I);
   void visitFunction(llvm::Function &F);
-  void visitCallBase(llvm::CallBase &Call);
+  void visitCallBase(llvm::CallBase &Call);
 
 private:
   /// Mark functions which should be ignored with sapfor.da.ignore metadata.
@@ -181,6 +190,35 @@ private:
   void regReadMemory(llvm::Instruction &I, llvm::Value &Ptr);
   void regWriteMemory(llvm::Instruction &I, llvm::Value &Ptr);
 
+  /// \brief Registers all accesses performed by `I` inside the innermost loop
+  /// as a single range if possible.
+  ///
+  /// The access must be executed once on each iteration of the loop and its
+  /// address must be an affine recurrence with a positive constant step
+  /// which is not less than the size of accessed element, and the loop must
+  /// have a computable trip count. Call of `sapforReadRange` or
+  /// `sapforWriteRange` is inserted into the loop preheader, so for nested
+  /// loops the range is registered on each iteration of an outer loop.
+  ///
+  /// A range does not preserve the order of accesses between iterations, so
+  /// the dynamic analyzer can not discover loop-carried dependencies which
+  /// involve this access. Hence, an access is registered as a range only if
+  /// it can not produce such dependencies (see mayCarryDependence()).
+  /// \return `false` if the access can not be registered as a range.
+  bool regLoopRange(llvm::Instruction &I, llvm::Value &Ptr, bool IsWrite);
+
+  /// \brief Returns true if accesses performed by `I` in different iterations
+  /// of a loop `L` may depend on other accesses in this loop.
+  ///
+  /// The accessed object must be identified (for example, a global variable or
+  /// an alloca). Other accesses to this object must have the same address
+  /// in each iteration, so dependencies are not carried by the loop.
+  /// Accesses to other memory are allowed if they can not alias the object
+  /// or if `I` and these accesses only read memory. Calls which may access
+  /// memory are not allowed.
+  bool mayCarryDependence(llvm::Loop &L, llvm::Instruction &I,
+    const llvm::SCEV &PtrSCEV, const llvm::Value &Object, bool IsWrite);
+
   /// Reserves some metadata string for object which have not enough
   /// information.
   void reserveIncompleteDIStrings(llvm::Module &M);
@@ -208,9 +246,11 @@ private:
   /// - address of accessed memory,
   /// - metadata string for accessed memory,
   /// - address of array base (in case of array access) or nullptr.
+  ///
+  /// If `BasePtr` is `nullptr` base of accessed memory is computed from `Ptr`.
   std::tuple<llvm::Value *, llvm::Value *, llvm::Value *, llvm::Value *>
     regMemoryAccessArgs(llvm::Value *Ptr, const llvm::DebugLoc &DbgLoc,
-      llvm::Instruction &InsertBefore);
+      llvm::Instruction &InsertBefore, llvm::Value *BasePtr = nullptr);
 
   /// \brief Registers a metadata string and a variable.
   ///
@@ -353,6 +393,15 @@ private:
   llvm::Function *mInitDIAll = nullptr;
   /// Dominator tree of a currently processed function.
   llvm::DominatorTree *mDT = nullptr;
+  /// Dominator tree of a currently processed function which is recomputed
+  /// after instrumentation of loops (it is used to register ranges only).
+  llvm::DominatorTree *mRangeDT = nullptr;
+  /// Loop tree of a currently processed function which is recomputed after
+  /// instrumentation of loops (it is used to register ranges only).
+  llvm::LoopInfo *mLI = nullptr;
+  /// Scalar evolution of a currently processed function which is recomputed
+  /// after instrumentation of loops (it is used to register ranges only).
+  llvm::ScalarEvolution *mSE = nullptr;
 };
 }
 
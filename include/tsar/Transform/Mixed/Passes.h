@@ -44,8 +44,11 @@ void initializeMixedTransform(PassRegistry &Registry);
 void initializeInstrumentationPassPass(PassRegistry &Registry);
 
 /// Create a pass to perform low-level (LLVM IR) instrumentation of program.
+///
+/// If `LoopRanges` is set affine memory accesses inside loops are registered
+/// once per loop execution instead of registration on each iteration.
 ModulePass * createInstrumentationPass(llvm::StringRef InstrEntry = "",
-  llvm::ArrayRef<std::string> StartFrom = {});
+  llvm::ArrayRef<std::string> StartFrom = {}, bool LoopRanges = false);
 
 /// Initialize a pass which retrieves some debug information for a loop if
 /// it is not presented in LLVM IR.
@@ -0,0 +1,144 @@
+//===--- ASTIndex.cpp ----- Index Of Function AST ---------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass which builds a flat index of statements in
+// a function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Clang/ASTIndex.h"
+#include "tsar/Frontend/Clang/TransformationContext.h"
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/AST/Stmt.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/Function.h>
+
+using namespace clang;
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "clang-ast-index"
+
+STATISTIC(NumIndexedStmt, "Number of indexed statements");
+
+char ClangASTIndexPass::ID = 0;
+INITIALIZE_PASS_BEGIN(ClangASTIndexPass, "clang-ast-index",
+  "Index Of Statements (Clang)", true, true)
+INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+INITIALIZE_PASS_END(ClangASTIndexPass, "clang-ast-index",
+  "Index Of Statements (Clang)", true, true)
+
+/// This traverses AST and fills the index.
+///
+/// TraverseStmt() is overridden, so data recursion is disabled and each
+/// statement is completely traversed before the next sibling.
+class ClangASTIndex::Builder : public RecursiveASTVisitor<Builder> {
+public:
+  Builder(const SourceManager &SrcMgr, ClangASTIndex &Index)
+      : mSrcMgr(&SrcMgr), mIndex(&Index) {}
+
+  bool TraverseStmt(Stmt *S) {
+    if (!S)
+      return true;
+    auto Idx = mIndex->mStmts.size();
+    auto Loc = S->getBeginLoc();
+    if (Loc.isMacroID())
+      Loc = mSrcMgr->getExpansionLoc(Loc);
+    mIndex->mStmts.push_back(
+        {S, mParents.empty() ? NoIndex : mParents.back(), 0, Loc});
+    mIndex->mStmtToIdx.try_emplace(S, Idx);
+    if (Loc.isValid())
+      mIndex->mLocToStmts[Loc.getRawEncoding()].push_back(Idx);
+    if (isa<ForStmt>(S) || isa<WhileStmt>(S) || isa<DoStmt>(S))
+      mIndex->mLoops.push_back(Idx);
+    else if (isa<DeclRefExpr>(S))
+      mIndex->mDeclRefs.push_back(Idx);
+    else if (isa<CallExpr>(S))
+      mIndex->mCalls.push_back(Idx);
+    mParents.push_back(Idx);
+    auto Res = RecursiveASTVisitor::TraverseStmt(S);
+    mParents.pop_back();
+    mIndex->mStmts[Idx].End = mIndex->mStmts.size();
+    return Res;
+  }
+
+  bool VisitVarDecl(VarDecl *D) {
+    mIndex->mVars.push_back({D, mParents.empty() ? NoIndex : mParents.back()});
+    return true;
+  }
+
+private:
+  const SourceManager *mSrcMgr;
+  ClangASTIndex *mIndex;
+  SmallVector<unsigned, 16> mParents;
+};
+
+void ClangASTIndex::build(FunctionDecl &FD, const SourceManager &SrcMgr) {
+  clear();
+  mFunc = &FD;
+  Builder(SrcMgr, *this).TraverseDecl(&FD);
+  NumIndexedStmt += mStmts.size();
+}
+
+void ClangASTIndex::clear() {
+  mFunc = nullptr;
+  mStmts.clear();
+  mStmtToIdx.clear();
+  mLoops.clear();
+  mDeclRefs.clear();
+  mCalls.clear();
+  mVars.clear();
+  mLocToStmts.clear();
+}
+
+bool ClangASTIndexPass::runOnFunction(Function &F) {
+  releaseMemory();
+  auto *DISub = F.getSubprogram();
+  if (!DISub)
+    return false;
+  auto *CU = DISub->getUnit();
+  if (!CU)
+    return false;
+  auto &TfmInfo = getAnalysis<TransformationEnginePass>();
+  auto *TfmCtx = TfmInfo ? dyn_cast_or_null<ClangTransformationContext>(
+                               TfmInfo->getContext(*CU))
+                         : nullptr;
+  if (!TfmCtx || !TfmCtx->hasInstance())
+    return false;
+  auto *FuncDecl = dyn_cast_or_null<FunctionDecl>(
+      TfmCtx->getDeclForMangledName(F.getName()));
+  if (!FuncDecl)
+    return false;
+  mIndex.build(*FuncDecl, TfmCtx->getRewriter().getSourceMgr());
+  return false;
+}
+
+void ClangASTIndexPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<TransformationEnginePass>();
+  AU.setPreservesAll();
+}
+
+FunctionPass *llvm::createClangASTIndexPass() {
+  return new ClangASTIndexPass();
+}
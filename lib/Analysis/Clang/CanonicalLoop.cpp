@@ -25,6 +25,7 @@
 #include "tsar/Analysis/Clang/CanonicalLoop.h"
 #include "tsar/ADT/SpanningTreeRelation.h"
 #include "tsar/Analysis/DFRegionInfo.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Analysis/Clang/LoopMatcher.h"
 #include "tsar/Analysis/Clang/MemoryMatcher.h"
 #include "tsar/Analysis/PrintUtils.h"
@@ -40,7 +41,6 @@
 #include "tsar/Support/Tags.h"
 #include "tsar/Unparse/Utils.h"
 #include <clang/AST/Decl.h>
-#include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/Stmt.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -71,6 +71,7 @@ INITIALIZE_PASS_IN_GROUP_BEGIN(CanonicalLoopPass, "canonical-loop",
 INITIALIZE_PASS_DEPENDENCY(DIEstimateMemoryPass)
 INITIALIZE_PASS_DEPENDENCY(DIDependencyAnalysisPass)
 INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
 INITIALIZE_PASS_DEPENDENCY(DFRegionInfoPass)
 INITIALIZE_PASS_DEPENDENCY(LoopMatcherPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryMatcherImmutableWrapper)
@@ -581,9 +582,8 @@ private:
 };
 
 /// Returns LoopMatcher that matches loops that can be canonical.
-DeclarationMatcher makeLoopMatcher() {
-  return functionDecl(forEachDescendant(
-      forStmt(
+StatementMatcher makeLoopMatcher() {
+  return forStmt(
         hasLoopInit(eachOf(
           declStmt(hasSingleDecl(
             varDecl(hasType(isInteger()))
@@ -683,7 +683,7 @@ DeclarationMatcher makeLoopMatcher() {
               hasSourceExpression(declRefExpr(to(
                 varDecl(hasType(isInteger()))
                 .bind("SecondConditionVarName")))))))).bind("LoopCondition")))
-      .bind("forLoop")));
+      .bind("forLoop");
 }
 }
 
@@ -696,17 +696,24 @@ bool CanonicalLoopPass::runOnFunction(Function &F) {
   auto TfmCtx = TfmInfo->getContext(*M);
   if (!TfmCtx || !TfmCtx->hasInstance())
     return false;
-  auto FuncDecl = TfmCtx->getDeclForMangledName(F.getName());
-  if (!FuncDecl)
+  auto &Index = getAnalysis<ClangASTIndexPass>().getIndex();
+  if (!Index.getFunction())
     return false;
-  DeclarationMatcher LoopMatcher = makeLoopMatcher();
+  StatementMatcher LoopMatcher = makeLoopMatcher();
   CanonicalLoopLabeler Labeler(*this, F, mCanonicalLoopInfo);
-  auto &Context = FuncDecl->getASTContext();
-  auto Nodes = match<DeclarationMatcher, Decl>(LoopMatcher, *FuncDecl, Context);
-  while (!Nodes.empty()) {
-    MatchFinder::MatchResult Result(Nodes.back(), &Context);
-    Labeler.run(Result);
-    Nodes.pop_back();
+  auto &Context = Index.getFunction()->getASTContext();
+  // Match each loop separately instead of a search for descendants of
+  // a function. Loops are evaluated in reverse order of AST traversal.
+  for (auto Idx : llvm::reverse(Index.loops())) {
+    auto *For = dyn_cast<ForStmt>(Index[Idx].S);
+    if (!For)
+      continue;
+    auto Nodes = match<StatementMatcher, Stmt>(LoopMatcher, *For, Context);
+    while (!Nodes.empty()) {
+      MatchFinder::MatchResult Result(Nodes.back(), &Context);
+      Labeler.run(Result);
+      Nodes.pop_back();
+    }
   }
   return false;
 }
@@ -739,6 +746,7 @@ void CanonicalLoopPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<DIEstimateMemoryPass>();
   AU.addRequired<DominatorTreeWrapperPass>();
   AU.addRequired<TransformationEnginePass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.addRequired<DFRegionInfoPass>();
   AU.addRequired<LoopMatcherPass>();
   AU.addRequired<MemoryMatcherImmutableWrapper>();
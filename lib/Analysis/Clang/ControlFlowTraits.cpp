@@ -23,9 +23,9 @@
 //===----------------------------------------------------------------------===//
 #include "tsar/Analysis/Clang/ControlFlowTraits.h"
 #include "tsar/Analysis/Attributes.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Frontend/Clang/TransformationContext.h"
 #include <clang/AST/Expr.h>
-#include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/Stmt.h>
 #include <clang/Basic/SourceLocation.h>
 #include <llvm/IR/InstIterator.h>
@@ -37,45 +37,42 @@ using namespace llvm;
 using namespace tsar;
 
 namespace {
-/// This visitor collects all labels and `goto` statements which branch to these
-/// labels.
-struct LabelVisitor : public RecursiveASTVisitor<LabelVisitor> {
-  using LabelMap = DenseMap<LabelDecl *, SmallVector<Stmt *, 8>>;
-
-  bool VisitGotoStmt(GotoStmt *S) {
-    auto I = Labels.try_emplace(S->getLabel());
-    I.first->second.push_back(S);
-    return true;
-  }
-
-  LabelMap Labels;
-};
-
 /// Collects traits for function and loops control-flow.
-class Visitor : public RecursiveASTVisitor<Visitor> {
+class Visitor {
 public:
   /// This map from declaration to a LLVM IR function allows to access function
   /// attributes which are available in LLVM IR.
   using CalleeMap = llvm::DenseMap<clang::Decl *, llvm::Function *>;
-  using LabelMap = LabelVisitor::LabelMap;
+
+  /// Map from labels to `goto` statements which branch to these labels.
+  using LabelMap = DenseMap<LabelDecl *, SmallVector<Stmt *, 8>>;
 
   Visitor(const CalleeMap &Callees, const LabelMap &Labels,
     ClangCFTraitsPass::RegionCFInfo &FI, ClangCFTraitsPass::LoopCFInfo &LI) :
     mCallees(&Callees), mLabels(&Labels), mFuncInfo(&FI), mLoopInfo(&LI) {}
 
-  bool TraverseStmt(clang::Stmt *S) {
-    if (!S)
-      return RecursiveASTVisitor::TraverseStmt(S);
-    bool Res = false;
-    if (isa<ForStmt>(S) || isa<DoStmt>(S) || isa<WhileStmt>(S) ||
-        isa<SwitchStmt>(S)) {
-      mScopes.push_back(S);
-      Res = RecursiveASTVisitor::TraverseStmt(S);
-      mScopes.pop_back();
-    } else {
-      Res = RecursiveASTVisitor::TraverseStmt(S);
+  /// Visits all statements in the order of AST traversal.
+  void visit(const ClangASTIndex &Index) {
+    for (unsigned I = 0, EI = Index.size(); I < EI; ++I) {
+      while (!mScopeEnds.empty() && mScopeEnds.back() <= I) {
+        mScopes.pop_back();
+        mScopeEnds.pop_back();
+      }
+      auto *S = Index[I].S;
+      if (isa<ForStmt>(S) || isa<DoStmt>(S) || isa<WhileStmt>(S) ||
+          isa<SwitchStmt>(S)) {
+        mScopes.push_back(S);
+        mScopeEnds.push_back(Index[I].End);
+      }
+      if (auto *Break = dyn_cast<BreakStmt>(S))
+        VisitBreakStmt(Break);
+      else if (auto *Return = dyn_cast<ReturnStmt>(S))
+        VisitReturnStmt(Return);
+      else if (auto *Goto = dyn_cast<GotoStmt>(S))
+        VisitGotoStmt(Goto);
+      else if (auto *Call = dyn_cast<CallExpr>(S))
+        VisitCallExpr(Call);
     }
-    return Res;
   }
 
   bool VisitBreakStmt(BreakStmt *S) {
@@ -169,6 +166,7 @@ private:
   ClangCFTraitsPass::LoopCFInfo *mLoopInfo;
   ClangCFTraitsPass::RegionCFInfo *mFuncInfo;
   SmallVector<Stmt *, 8> mScopes;
+  SmallVector<unsigned, 8> mScopeEnds;
 };
 }
 
@@ -203,21 +201,26 @@ bool ClangCFTraitsPass::runOnFunction(Function &F) {
       continue;
     Callees.try_emplace(FD, Callee);
   }
-  LabelVisitor LV;
-  LV.TraverseDecl(CurrD);
-  Visitor V(Callees, LV.Labels, mFuncInfo, mLoopInfo);
-  V.TraverseDecl(CurrD);
+  auto &Index = getAnalysis<ClangASTIndexPass>().getIndex();
+  Visitor::LabelMap Labels;
+  for (auto &Info : Index)
+    if (auto *Goto = dyn_cast<GotoStmt>(Info.S))
+      Labels[Goto->getLabel()].push_back(Goto);
+  Visitor V(Callees, Labels, mFuncInfo, mLoopInfo);
+  V.visit(Index);
   return false;
 }
 
 void ClangCFTraitsPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TransformationEnginePass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.setPreservesAll();
 }
 
 INITIALIZE_PASS_BEGIN(ClangCFTraitsPass, "clang-control-info",
   "Control Statement Information Pass (Clang)", false, true)
 INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
 INITIALIZE_PASS_END(ClangCFTraitsPass, "clang-control-info",
   "Control Statement Information Pass (Clang)", false, true)
 
@@ -24,12 +24,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Clang/DIMemoryMatcher.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Analysis/Clang/Matcher.h"
 #include "tsar/Analysis/Clang/MemoryMatcher.h"
 #include "tsar/Analysis/Memory/Utils.h"
 #include "tsar/Frontend/Clang/TransformationContext.h"
 #include <clang/AST/Decl.h>
-#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/AST/Stmt.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/Dominators.h>
 #include <llvm/IR/InstIterator.h>
@@ -54,6 +55,7 @@ char ClangDIMemoryMatcherPass::ID = 0;
 INITIALIZE_PASS_BEGIN(ClangDIMemoryMatcherPass, "di-memory-matcher",
   "High and Metadata Memory Matcher (Clang)", true, true)
   INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+  INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
   INITIALIZE_PASS_DEPENDENCY(MemoryMatcherImmutableWrapper)
   INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_END(ClangDIMemoryMatcherPass, "di-memory-matcher",
@@ -65,6 +67,7 @@ FunctionPass *llvm::createDIMemoryMatcherPass() {
 
 void ClangDIMemoryMatcherPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TransformationEnginePass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.addRequired<DominatorTreeWrapperPass>();
   AU.addRequired<MemoryMatcherImmutableWrapper>();
   AU.setPreservesAll();
@@ -134,97 +137,106 @@ using MatchDIVisitorBase = MatchASTBase<DIVariable *, VarDecl *,
   ClangDIMemoryMatcherPass::DIMemoryMatcher,
   ClangDIMemoryMatcherPass::MemoryASTSet>;
 
-class MatchDIVisitor :
-    public MatchDIVisitorBase,
-    public RecursiveASTVisitor<MatchDIVisitor> {
+/// This matches variables (AST) and metadata-level variables.
+///
+/// Variables are grouped by scopes (compound statements, for, while and if
+/// statements) they are declared in.
+class MatchDIVisitor : public MatchDIVisitorBase {
 public:
   MatchDIVisitor(SourceManager &SrcMgr, Matcher &MM,
       UnmatchedASTSet &Unmatched, LocToIRMap &LocMap, LocToASTMap &MacroMap) :
     MatchASTBase(SrcMgr, MM, Unmatched, LocMap, MacroMap) {}
 
-  bool VisitVarDecl(VarDecl *D) {
-    mVisitedVars.push_back(D->getCanonicalDecl());
-    return true;
-  }
-
-  bool TraverseFunctionDecl(FunctionDecl *FD) {
-    if (FD->doesThisDeclarationHaveABody()) {
-      mIsEntry = true;
-      mFuncDecl = FD;
-      mVisitedVars.clear();
+  /// Match variables declared in a function which is described by
+  /// a specified index.
+  void visit(const ClangASTIndex &Index) {
+    auto isScope = [](const Stmt *S) {
+      return isa<CompoundStmt>(S) || isa<ForStmt>(S) || isa<WhileStmt>(S) ||
+             isa<IfStmt>(S);
+    };
+    // The first scope is a function body, parameters are also attached to it.
+    auto EntryItr = find_if(Index, [&isScope](auto &Info) {
+      return isScope(Info.S);
+    });
+    if (EntryItr == Index.end())
+      return;
+    unsigned Entry = std::distance(Index.begin(), EntryItr);
+    DenseMap<unsigned, std::vector<VarDecl *>> ScopeToVars;
+    for (auto &Var : Index.vars()) {
+      auto Scope = Var.Parent;
+      while (Scope != ClangASTIndex::NoIndex && !isScope(Index[Scope].S))
+        Scope = Index[Scope].Parent;
+      if (Scope == ClangASTIndex::NoIndex)
+        Scope = Entry;
+      ScopeToVars[Scope].push_back(Var.D->getCanonicalDecl());
+    }
+    // Evaluate nested scopes before the outer ones (in postorder).
+    std::vector<unsigned> Scopes;
+    Scopes.reserve(ScopeToVars.size());
+    for (auto &Pair : ScopeToVars)
+      Scopes.push_back(Pair.first);
+    llvm::sort(Scopes, [&Index](unsigned LHS, unsigned RHS) {
+      return Index[LHS].End < Index[RHS].End ||
+             (Index[LHS].End == Index[RHS].End && LHS > RHS);
+    });
+    for (auto Scope : Scopes) {
+      // Location of function declaration is used instead of location of body
+      // to map top-level local variables.
+      auto ScopeLoc = Scope == Entry ? Index.getFunction()->getLocation()
+                                     : Index[Scope].S->getBeginLoc();
+      auto ExpansionLoc = Scope == Entry ? mSrcMgr->getExpansionLoc(ScopeLoc)
+                                         : Index[Scope].ExpansionLoc;
+      matchScope(ScopeLoc, ExpansionLoc, ScopeToVars[Scope]);
     }
-    return RecursiveASTVisitor::TraverseFunctionDecl(FD);
   }
 
-  bool TraverseStmt(Stmt *S) {
-    if (!S || !isa<CompoundStmt>(S) && !isa<ForStmt>(S) && !isa<WhileStmt>(S) &&
-                  !isa<IfStmt>(S))
-      return RecursiveASTVisitor::TraverseStmt(S);
-    // Parameters were visited before the body.
-    auto StashSize = mIsEntry ? 0 : mVisitedVars.size();
-    // Location of function declaration is used instead of location of body
-    // to map top-level local variables.
-    auto ScopeLoc = mIsEntry ? mFuncDecl->getLocation() : S->getBeginLoc();
-    mIsEntry = false;
-    auto Res = RecursiveASTVisitor::TraverseStmt(S);
-    if (Res && mVisitedVars.size() > StashSize) {
-      llvm::sort(mVisitedVars.begin() + StashSize, mVisitedVars.end(),
-                 [](const VarDecl *LHS, const VarDecl *RHS) {
-                   return LHS->getName() < RHS->getName();
-                 });
-      LLVM_DEBUG(dbgs() << "[DI MEMORY MATCHER]: visited "
-                        << mVisitedVars.size() - StashSize
-                        << " variables in scope at ";
-                 ScopeLoc.print(dbgs(), *mSrcMgr); dbgs() << "\n");
-      if (ScopeLoc.isInvalid()) {
-        mUnmatchedAST->insert(mVisitedVars.begin() + StashSize,
-                              mVisitedVars.end());
-        NumNonMatchASTMemory += mVisitedVars.size() - StashSize;
-        mVisitedVars.resize(StashSize);
-        return true;
-      }
-      if (ScopeLoc.isMacroID()) {
-        ScopeLoc = mSrcMgr->getExpansionLoc(ScopeLoc);
-        auto Pair = mLocToMacro->try_emplace(ScopeLoc.getRawEncoding());
-        assert(Pair.second && "Unable to insert list of variables!");
-        Pair.first->second.insert(Pair.first->second.end(),
-          mVisitedVars.begin() + StashSize, mVisitedVars.end());
-      } else {
-        auto I = findItrForLocation(ScopeLoc);
-        if (I != mLocToIR->end()) {
-          auto SearchFromItr = mVisitedVars.begin() + StashSize;
-          for (unsigned Idx = 0, IdxE = I->second.size(); Idx < IdxE; ++Idx) {
-            auto DIV = I->second[Idx];
-            // We search variables for promoted locations only. Other variables
-            // are processing further.
-            auto Itr = std::find_if(SearchFromItr, mVisitedVars.end(),
-                                    [DIV](const VarDecl *D) {
-                                      return DIV->getName() == D->getName();
-                                    });
-            if (Itr == mVisitedVars.end())
-              continue;
-            mMatcher->emplace(*Itr, DIV);
-            ++NumMatchMemory;
-            --NumNonMatchDIMemory;
-            NumNonMatchASTMemory += std::distance(SearchFromItr, Itr);
-            SearchFromItr = Itr + 1;
-          }
-          I->second.clear();
-        } else {
-          mUnmatchedAST->insert(mVisitedVars.begin() + StashSize,
-                                mVisitedVars.end());
-          NumNonMatchASTMemory += mVisitedVars.size() - StashSize;
-        }
-      }
-      mVisitedVars.resize(StashSize);
+private:
+  void matchScope(SourceLocation ScopeLoc, SourceLocation ExpansionLoc,
+                  std::vector<VarDecl *> &Vars) {
+    llvm::sort(Vars.begin(), Vars.end(),
+               [](const VarDecl *LHS, const VarDecl *RHS) {
+                 return LHS->getName() < RHS->getName();
+               });
+    LLVM_DEBUG(dbgs() << "[DI MEMORY MATCHER]: visited " << Vars.size()
+                      << " variables in scope at ";
+               ScopeLoc.print(dbgs(), *mSrcMgr); dbgs() << "\n");
+    if (ScopeLoc.isInvalid()) {
+      mUnmatchedAST->insert(Vars.begin(), Vars.end());
+      NumNonMatchASTMemory += Vars.size();
+      return;
+    }
+    if (ScopeLoc.isMacroID()) {
+      auto Pair = mLocToMacro->try_emplace(ExpansionLoc.getRawEncoding());
+      assert(Pair.second && "Unable to insert list of variables!");
+      Pair.first->second.insert(Pair.first->second.end(), Vars.begin(),
+                                Vars.end());
+      return;
+    }
+    auto I = findItrForLocation(ScopeLoc);
+    if (I == mLocToIR->end()) {
+      mUnmatchedAST->insert(Vars.begin(), Vars.end());
+      NumNonMatchASTMemory += Vars.size();
+      return;
     }
-    return Res;
+    auto SearchFromItr = Vars.begin();
+    for (unsigned Idx = 0, IdxE = I->second.size(); Idx < IdxE; ++Idx) {
+      auto DIV = I->second[Idx];
+      // We search variables for promoted locations only. Other variables
+      // are processing further.
+      auto Itr = std::find_if(SearchFromItr, Vars.end(),
+                              [DIV](const VarDecl *D) {
+                                return DIV->getName() == D->getName();
+                              });
+      if (Itr == Vars.end())
+        continue;
+      mMatcher->emplace(*Itr, DIV);
+      ++NumMatchMemory;
+      --NumNonMatchDIMemory;
+      NumNonMatchASTMemory += std::distance(SearchFromItr, Itr);
+      SearchFromItr = Itr + 1;
+    }
+    I->second.clear();
   }
-private:
-  std::vector<VarDecl *> mVisitedVars;
-  SmallVector<SourceLocation, 8> mScopes;
-  FunctionDecl *mFuncDecl = nullptr;
-  bool mIsEntry = false;
 };
 }
 
@@ -277,7 +289,7 @@ bool ClangDIMemoryMatcherPass::runOnFunction(Function &F) {
                [](const DIVariable *LHS, const DIVariable *RHS) {
                  return LHS->getName() < RHS->getName();
                });
-  MatchDIVar.TraverseDecl(FuncDecl);
+  MatchDIVar.visit(getAnalysis<ClangASTIndexPass>().getIndex());
   for (auto &Pair : LocToMacro) {
     llvm::sort(Pair.second.begin(), Pair.second.end(),
                [](const VarDecl *LHS, const VarDecl *RHS) {
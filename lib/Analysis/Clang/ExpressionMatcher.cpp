@@ -25,9 +25,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Clang/ExpressionMatcher.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Analysis/Clang/Matcher.h"
 #include "tsar/Frontend/Clang/TransformationContext.h"
-#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/AST/Expr.h>
 #include <llvm/ADT/Statistic.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
@@ -44,34 +45,33 @@ STATISTIC(NumNonMatchIRExpr, "Number of non-matched IR expressions");
 STATISTIC(NumNonMatchASTExpr, "Number of non-matched AST expressions");
 
 namespace {
-class MatchExprVisitor :
-  public MatchASTBase<Value *, Stmt *>,
-  public RecursiveASTVisitor<MatchExprVisitor> {
+/// This matches calls (AST) and call instructions (IR).
+///
+/// Calls have to be visited in the order of AST traversal.
+class MatchExprVisitor : public MatchASTBase<Value *, Stmt *> {
 public:
   MatchExprVisitor(SourceManager &SrcMgr, Matcher &MM,
     UnmatchedASTSet &Unmatched, LocToIRMap &LocMap, LocToASTMap &MacroMap) :
       MatchASTBase(SrcMgr, MM, Unmatched, LocMap, MacroMap) {}
 
-  /// Evaluates declarations expanded from a macro and stores such
-  /// declaration into location to macro map.
-  void VisitFromMacro(Stmt *S) {
+  /// Evaluates expressions expanded from a macro and stores such
+  /// expressions into location to macro map.
+  ///
+  /// \param [in] ExpansionLoc Expansion location of the expression beginning.
+  void VisitFromMacro(Stmt *S, SourceLocation ExpansionLoc) {
     assert(S->getBeginLoc().isMacroID() &&
       "Expression must be expanded from macro!");
-    auto Loc = S->getBeginLoc();
-    if (Loc.isInvalid())
+    if (ExpansionLoc.isInvalid())
       return;
-    Loc = mSrcMgr->getExpansionLoc(Loc);
-    if (Loc.isInvalid())
-      return;
-    auto Pair = mLocToMacro->insert(
-      std::make_pair(Loc.getRawEncoding(), TinyPtrVector<Stmt *>(S)));
+    auto Pair = mLocToMacro->insert(std::make_pair(
+      ExpansionLoc.getRawEncoding(), TinyPtrVector<Stmt *>(S)));
     if (!Pair.second)
       Pair.first->second.push_back(S);
   }
 
-   bool VisitCallExpr(Expr *E) {
+  bool VisitCallExpr(Expr *E, SourceLocation ExpansionLoc) {
     if (E->getBeginLoc().isMacroID()) {
-      VisitFromMacro(E);
+      VisitFromMacro(E, ExpansionLoc);
       return true;
     }
     auto ExprLoc = E->getBeginLoc();
@@ -115,18 +115,20 @@ bool ClangExprMatcherPass::runOnFunction(Function &F) {
   }
   for (auto &Pair : LocToExpr)
     std::reverse(Pair.second.begin(), Pair.second.end());
-  // It is necessary to build LocToExpr map also if FuncDecl is null,
+  // It is necessary to build LocToExpr map also if the index is empty,
   // because a number of unmatched expressions should be calculated.
-  auto FuncDecl = TfmCtx->getDeclForMangledName(F.getName());
-  if (!FuncDecl)
+  auto &Index = getAnalysis<ClangASTIndexPass>().getIndex();
+  if (!Index.getFunction())
     return false;
-  MatchExpr.TraverseDecl(FuncDecl);
+  for (auto Idx : Index.calls())
+    MatchExpr.VisitCallExpr(cast<Expr>(Index[Idx].S), Index[Idx].ExpansionLoc);
   MatchExpr.matchInMacro(NumMatchExpr, NumNonMatchASTExpr, NumNonMatchIRExpr);
   return false;
 }
 
 void ClangExprMatcherPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TransformationEnginePass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.setPreservesAll();
 }
 
@@ -135,6 +137,7 @@ char ClangExprMatcherPass::ID = 0;
 INITIALIZE_PASS_BEGIN(ClangExprMatcherPass, "clang-expr-matcher",
   "High and Low Expression Matcher", false , true)
   INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+  INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
 INITIALIZE_PASS_END(ClangExprMatcherPass, "clang-expr-matcher",
   "High and Low Level Expression Matcher", false, true)
 
@@ -23,12 +23,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Clang/LoopMatcher.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Analysis/Clang/Matcher.h"
 #include "tsar/Frontend/Clang/TransformationContext.h"
 #include "tsar/Support/IRUtils.h"
 #include <bcl/transparent_queue.h>
 #include <clang/AST/Decl.h>
-#include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/Stmt.h>
 #include <llvm/ADT/Statistic.h>
 #include <llvm/ADT/DenseMap.h>
@@ -58,14 +58,15 @@ INITIALIZE_PASS_BEGIN(LoopMatcherPass, "loop-matcher",
   "High and Low Loop Matcher", true, false)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
+INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
 INITIALIZE_PASS_END(LoopMatcherPass, "loop-matcher",
   "High and Low Level Loop Matcher", true, false)
 
 namespace {
 /// This matches explicit for, while and do-while loops.
-class MatchExplicitVisitor :
-  public MatchASTBase<Loop *, Stmt *>,
-  public RecursiveASTVisitor<MatchExplicitVisitor> {
+///
+/// Statements have to be visited in the order of AST traversal.
+class MatchExplicitVisitor : public MatchASTBase<Loop *, Stmt *> {
 public:
 
   /// Constructor.
@@ -94,26 +95,24 @@ public:
   /// evaluated, because in LLVM IR these loops have locations equal to
   /// expansion location. So it is not possible to determine token in macro
   /// body where these loops starts without additional analysis of AST.
-  void VisitFromMacro(Stmt *S) {
+  ///
+  /// \param [in] ExpansionLoc Expansion location of the statement beginning.
+  void VisitFromMacro(Stmt *S, SourceLocation ExpansionLoc) {
     assert(S->getBeginLoc().isMacroID() &&
       "Statement must be expanded from macro!");
     if (!isa<WhileStmt>(S) && !isa<DoStmt>(S) && !isa<ForStmt>(S))
       return;
-    auto Loc = S->getBeginLoc();
-    if (Loc.isInvalid())
-      return;
-    Loc = mSrcMgr->getExpansionLoc(Loc);
-    if (Loc.isInvalid())
+    if (ExpansionLoc.isInvalid())
       return;
-    auto Pair = mLocToMacro->insert(
-      std::make_pair(Loc.getRawEncoding(), TinyPtrVector<Stmt *>(S)));
+    auto Pair = mLocToMacro->insert(std::make_pair(
+      ExpansionLoc.getRawEncoding(), TinyPtrVector<Stmt *>(S)));
     if (!Pair.second)
       Pair.first->second.push_back(S);
   }
 
-  bool VisitStmt(Stmt *S) {
+  bool VisitStmt(Stmt *S, SourceLocation ExpansionLoc) {
     if (S->getBeginLoc().isMacroID()) {
-      VisitFromMacro(S);
+      VisitFromMacro(S, ExpansionLoc);
       return true;
     }
     if (auto *For = dyn_cast<ForStmt>(S)) {
@@ -189,9 +188,9 @@ private:
 };
 
 /// This matches implicit loops.
-class MatchImplicitVisitor :
-  public MatchASTBase<Loop *, Stmt *>,
-  public RecursiveASTVisitor<MatchImplicitVisitor> {
+///
+/// Statements have to be visited in the order of AST traversal.
+class MatchImplicitVisitor : public MatchASTBase<Loop *, Stmt *> {
 public:
   MatchImplicitVisitor(SourceManager &SrcMgr, Matcher &LM,
     UnmatchedASTSet &Unmatched, LocToIRMap &LocMap, LocToASTMap &MacroMap) :
@@ -302,12 +301,15 @@ bool LoopMatcherPass::runOnFunction(Function &F) {
   MatchExplicitVisitor::LocToASTMap LocToMacro;
   MatchExplicitVisitor MatchExplicit(SrcMgr, mMatcher, mUnmatchedAST,
     LocToLoop, LocToImplicit, LocToMacro);
-  MatchExplicit.TraverseDecl(mFuncDecl);
+  auto &Index = getAnalysis<ClangASTIndexPass>().getIndex();
+  for (auto &Info : Index)
+    MatchExplicit.VisitStmt(Info.S, Info.ExpansionLoc);
   MatchImplicitVisitor MatchImplicit(SrcMgr, mMatcher, mUnmatchedAST,
     LocToImplicit, LocToMacro);
   for (auto &Pair: LocToImplicit)
     std::reverse(Pair.second.begin(), Pair.second.end());
-  MatchImplicit.TraverseDecl(mFuncDecl);
+  for (auto &Info : Index)
+    MatchImplicit.VisitStmt(Info.S);
   for (auto &Pair : LocToMacro)
     std::reverse(Pair.second.begin(), Pair.second.end());
   MatchExplicit.matchInMacro(
@@ -318,6 +320,7 @@ bool LoopMatcherPass::runOnFunction(Function &F) {
 void LoopMatcherPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<LoopInfoWrapperPass>();
   AU.addRequired<TransformationEnginePass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.setPreservesAll();
 }
 
@@ -32,6 +32,7 @@ void llvm::initializeClangAnalysis(PassRegistry &Registry) {
   initializeClangDIMemoryMatcherPassPass(Registry);
   initializeClangDIGlobalMemoryMatcherPassPass(Registry);
   initializeClangExprMatcherPassPass(Registry);
+  initializeClangASTIndexPassPass(Registry);
   initializeLoopMatcherPassPass(Registry);
   initializeClangPerfectLoopPassPass(Registry);
   initializeCanonicalLoopPassPass(Registry);
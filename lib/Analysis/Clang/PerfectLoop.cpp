@@ -24,11 +24,11 @@
 
 #include "tsar/Analysis/Clang/PerfectLoop.h"
 #include "tsar/Analysis/DFRegionInfo.h"
+#include "tsar/Analysis/Clang/ASTIndex.h"
 #include "tsar/Analysis/Clang/LoopMatcher.h"
 #include "tsar/Frontend/Clang/TransformationContext.h"
 #include "tsar/Support/Tags.h"
 #include <clang/AST/Decl.h>
-#include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/Stmt.h>
 #include <llvm/ADT/Statistic.h>
 #include <llvm/IR/Function.h>
@@ -53,71 +53,10 @@ INITIALIZE_PASS_BEGIN(ClangPerfectLoopPass, "perfect-loop",
 INITIALIZE_PASS_DEPENDENCY(TransformationEnginePass)
 INITIALIZE_PASS_DEPENDENCY(DFRegionInfoPass)
 INITIALIZE_PASS_DEPENDENCY(LoopMatcherPass)
+INITIALIZE_PASS_DEPENDENCY(ClangASTIndexPass)
 INITIALIZE_PASS_END(ClangPerfectLoopPass, "perfect-loop",
   "Perfectly Nested Loop Analysis", true, true)
 
-namespace {
-/// This visits and analyzes all for-loops in a source code.
-class LoopVisitor : public RecursiveASTVisitor<LoopVisitor> {
-public:
-  /// Creates visitor.
-  explicit LoopVisitor(DFRegionInfo &DFRI,
-      const LoopMatcherPass::LoopMatcher &LM, tsar::PerfectLoopInfo &PLI) :
-    mRgnInfo(&DFRI), mLoopInfo(&LM), mPerfectLoopInfo(&PLI) {}
-
-  /// \brief Overridden traversing of for-loops.
-  ///
-  /// For a specified loop a number of inner loops are calculated. This function
-  /// also checks whether some statements are placed between heads or tails of
-  /// loops are calculated.
-  /// \attention Only statements comprises body of a loop is going
-  /// to be visited.
-  bool TraverseForStmt(ForStmt *For) {
-    // Keep values of external loop if it exists.
-    int PrevNumberOfLoops = ++mNumberOfLoops;
-    bool PrevIsThereOperators = mIsThereStmt;
-    mNumberOfLoops = 0;
-    mIsThereStmt = false;
-    auto Res = RecursiveASTVisitor::TraverseStmt(For->getBody());
-    if (mNumberOfLoops == 1 && !mIsThereStmt || mNumberOfLoops == 0) {
-      ++NumPerfect;
-      auto Match = mLoopInfo->find<AST>(For);
-      if (Match != mLoopInfo->end()) {
-        auto Region = mRgnInfo->getRegionFor(Match->get<IR>());
-        auto PLInfo = mPerfectLoopInfo->insert(Region);
-      }
-    } else {
-      ++NumImPerfect;
-    }
-    // Return values of external loop.
-    mNumberOfLoops = PrevNumberOfLoops;
-    mIsThereStmt = PrevIsThereOperators;
-    return true;
-  }
-
-  /// Checks that a specified statement makes a currently evaluated loop
-  /// imperfect.
-  bool VisitStmt(Stmt *S) {
-    if (!isa<CompoundStmt>(S))
-      mIsThereStmt = true;
-    return true;
-  }
-
-private:
-  /// This is number of loops,existence of none-cycle operators
-  /// inside the analyzed one's body
-  /// Number of inner loops for a current loop.
-  int mNumberOfLoops;
-
-  /// Existence of none-loop statement inside the analyzed one's body.
-  bool mIsThereStmt;
-
-  DFRegionInfo *mRgnInfo;
-  const LoopMatcherPass::LoopMatcher *mLoopInfo;
-  tsar::PerfectLoopInfo *mPerfectLoopInfo;
-};
-}
-
 bool ClangPerfectLoopPass::runOnFunction(Function &F) {
   releaseMemory();
   auto M = F.getParent();
@@ -132,8 +71,38 @@ bool ClangPerfectLoopPass::runOnFunction(Function &F) {
     return false;
   auto &RgnInfo = getAnalysis<DFRegionInfoPass>().getRegionInfo();
   auto &LoopInfo = getAnalysis<LoopMatcherPass>().getMatcher();
-  LoopVisitor Visitor(RgnInfo, LoopInfo, mPerfectLoopInfo);
-  Visitor.TraverseDecl(FuncDecl);
+  auto &Index = getAnalysis<ClangASTIndexPass>().getIndex();
+  for (auto LoopIdx : Index.loops()) {
+    auto *For = dyn_cast<ForStmt>(Index[LoopIdx].S);
+    if (!For)
+      continue;
+    // Count inner loops and other statements which comprise body of a loop.
+    // Statements nested in inner loops are not taken into account.
+    unsigned NumberOfLoops = 0;
+    bool IsThereStmt = false;
+    auto BodyIdx = Index.getIndex(For->getBody());
+    if (BodyIdx != ClangASTIndex::NoIndex)
+      for (unsigned I = BodyIdx, EI = Index[BodyIdx].End; I < EI;) {
+        if (isa<ForStmt>(Index[I].S)) {
+          ++NumberOfLoops;
+          I = Index[I].End;
+          continue;
+        }
+        if (!isa<CompoundStmt>(Index[I].S))
+          IsThereStmt = true;
+        ++I;
+      }
+    if ((NumberOfLoops == 1 && !IsThereStmt) || NumberOfLoops == 0) {
+      ++NumPerfect;
+      auto Match = LoopInfo.find<AST>(For);
+      if (Match != LoopInfo.end()) {
+        auto Region = RgnInfo.getRegionFor(Match->get<IR>());
+        mPerfectLoopInfo.insert(Region);
+      }
+    } else {
+      ++NumImPerfect;
+    }
+  }
   return false;
 }
 
@@ -141,6 +110,7 @@ void ClangPerfectLoopPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TransformationEnginePass>();
   AU.addRequired<DFRegionInfoPass>();
   AU.addRequired<LoopMatcherPass>();
+  AU.addRequired<ClangASTIndexPass>();
   AU.setPreservesAll();
 }
 
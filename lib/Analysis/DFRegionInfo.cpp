@@ -54,9 +54,26 @@ tsar::DFNode * DFRegionInfo::getRegionFor(llvm::Loop *L) const {
   return DFN;
 }
 
+void DFRegionInfo::releaseMemory() {
+  if (mTopLevelRegion) {
+    destroyNode(mTopLevelRegion);
+    mTopLevelRegion = nullptr;
+  }
+  mBBToNode.clear();
+  mAllocator.Reset();
+}
+
+void DFRegionInfo::destroyNode(DFNode *N) {
+  if (auto *R = dyn_cast<DFRegion>(N))
+    for (auto *Child : R->getNodes())
+      destroyNode(Child);
+  N->~DFNode();
+}
+
 void DFRegionInfo::recalculate(llvm::Function &F, llvm::LoopInfo &LpInfo) {
   releaseMemory();
-  mTopLevelRegion = new tsar::DFFunction(&F);
+  mBBToNode.reserve(F.size());
+  mTopLevelRegion = createNode<tsar::DFFunction>(&F);
   buildLoopRegion(std::make_pair(&F, &LpInfo),
     llvm::cast<tsar::DFRegion>(mTopLevelRegion));
   NumRegion = ++NumFunctionRegion + NumLoopRegion + NumBlockRegion;
@@ -64,7 +81,8 @@ void DFRegionInfo::recalculate(llvm::Function &F, llvm::LoopInfo &LpInfo) {
 
 void DFRegionInfo::recalculate(llvm::Loop &L) {
   releaseMemory();
-  mTopLevelRegion = new tsar::DFLoop(&L);
+  mBBToNode.reserve(L.getNumBlocks());
+  mTopLevelRegion = createNode<tsar::DFLoop>(&L);
   buildLoopRegion(&L, llvm::cast<tsar::DFRegion>(mTopLevelRegion));
   NumRegion = ++NumLoopRegion + NumBlockRegion;
 }
@@ -74,13 +92,13 @@ void DFRegionInfo::buildLoopRegion(LoopReptn L, DFRegion *R) {
   assert(R && "Region must not be null!");
   // To improve efficiency of construction the first added node
   // is entry and the last is exit (for loops the last added node is latch).
-  auto *EntryNode = new DFEntry;
-  auto *ExitNode = new DFExit;
+  auto *EntryNode = createNode<DFEntry>();
+  auto *ExitNode = createNode<DFExit>();
   R->addNode(EntryNode);
   typedef LoopTraits<LoopReptn> LT;
   llvm::DenseMap<llvm::BasicBlock *, DFNode *> Blocks;
   for (auto I = LT::loop_begin(L), E = LT::loop_end(L); I != E; ++I) {
-    auto *DFL = new DFLoop(*I);
+    auto *DFL = createNode<DFLoop>(*I);
     ++NumLoopRegion;
     buildLoopRegion(*I, DFL);
     R->addNode(DFL);
@@ -90,7 +108,7 @@ void DFRegionInfo::buildLoopRegion(LoopReptn L, DFRegion *R) {
   for (auto I = LT::block_begin(L), E = LT::block_end(L); I != E; ++I) {
     if (Blocks.count(*I))
       continue;
-    auto *N = new DFBlock(*I);
+    auto *N = createNode<DFBlock>(*I);
     ++NumBlockRegion;
     R->addNode(N);
     Blocks.insert(std::make_pair(*I, N));
@@ -126,7 +144,7 @@ void DFRegionInfo::buildLoopRegion(LoopReptn L, DFRegion *R) {
           ExitNode->addPredecessor(BBToN.second);
         } else if (*SI == LT::getHeader(L)) {
           if (!LatchNode) {
-            LatchNode = new DFLatch;
+            LatchNode = createNode<DFLatch>();
             R->addNode(LatchNode);
           }
           BBToN.second->addSuccessor(LatchNode);
@@ -0,0 +1,227 @@
+//===--- IRChangeTracker.cpp --- IR Change Tracker --------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements passes which compute and store fingerprints of
+// functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/IRChangeTracker.h"
+#include <bcl/utility.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/Debug.h>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "ir-change"
+
+STATISTIC(NumChangedFunc, "Number of functions changed between snapshots");
+
+hash_code IRChangeInfo::fingerprint(const Function &F) {
+  // Properties of a function which are reflected by edges from the external
+  // calling node of a call graph are also taken into account.
+  auto Hash = hash_combine(&F, F.getName(), F.getLinkage(),
+                           F.getAttributes().getRawPointer(),
+                           F.hasAddressTaken());
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  F.getAllMetadata(MDs);
+  for (auto &MD : MDs)
+    Hash = hash_combine(Hash, MD.first, MD.second);
+  for (auto &BB : F) {
+    Hash = hash_combine(Hash, &BB);
+    for (auto &I : BB) {
+      Hash = hash_combine(Hash, &I, I.getOpcode(), I.getType(),
+                          I.getRawSubclassOptionalData());
+      for (auto &Op : I.operands()) {
+        Hash = hash_combine(Hash, Op.get());
+        // Constants are uniqued, so the address of an initializer identifies
+        // its value.
+        if (auto *GV = dyn_cast<GlobalVariable>(Op.get()))
+          Hash = hash_combine(Hash, GV->isConstant(),
+                              GV->hasInitializer() ? GV->getInitializer()
+                                                   : nullptr);
+      }
+      // Metadata-level traits are bound to loop identifiers (!llvm.loop) and
+      // debug locations (!dbg), so all attached metadata is hashed.
+      MDs.clear();
+      I.getAllMetadata(MDs);
+      for (auto &MD : MDs)
+        Hash = hash_combine(Hash, MD.first, MD.second);
+      if (auto *Call = dyn_cast<CallBase>(&I))
+        Hash = hash_combine(Hash, Call->getAttributes().getRawPointer(),
+                            Call->getCallingConv());
+      else if (auto *Cmp = dyn_cast<CmpInst>(&I))
+        Hash = hash_combine(Hash, Cmp->getPredicate());
+      else if (auto *LI = dyn_cast<LoadInst>(&I))
+        Hash = hash_combine(Hash, LI->isVolatile(), LI->getAlign().value(),
+                            LI->getOrdering());
+      else if (auto *SI = dyn_cast<StoreInst>(&I))
+        Hash = hash_combine(Hash, SI->isVolatile(), SI->getAlign().value(),
+                            SI->getOrdering());
+      else if (auto *AI = dyn_cast<AllocaInst>(&I))
+        Hash = hash_combine(Hash, AI->getAlign().value(),
+                            AI->getAllocatedType());
+      else if (auto *RMW = dyn_cast<AtomicRMWInst>(&I))
+        Hash = hash_combine(Hash, RMW->isVolatile(), RMW->getOperation(),
+                            RMW->getOrdering());
+      else if (auto *CmpXchg = dyn_cast<AtomicCmpXchgInst>(&I))
+        Hash = hash_combine(Hash, CmpXchg->isVolatile(), CmpXchg->isWeak(),
+                            CmpXchg->getSuccessOrdering(),
+                            CmpXchg->getFailureOrdering());
+      else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I))
+        Hash = hash_combine(Hash, GEP->getSourceElementType());
+    }
+  }
+  return Hash;
+}
+
+void IRChangeInfo::snapshot(const Module &M) {
+  if (mHasSnapshot)
+    for (auto &F : M)
+      if (!F.isDeclaration() && isChanged(F))
+        ++NumChangedFunc;
+  mFingerprints.clear();
+  for (auto &F : M)
+    if (!F.isDeclaration())
+      mFingerprints.try_emplace(&F, fingerprint(F));
+  mHasSnapshot = true;
+}
+
+bool IRChangeInfo::isChanged(const Function &F) const {
+  if (!mHasSnapshot)
+    return true;
+  auto Itr = mFingerprints.find(&F);
+  return Itr == mFingerprints.end() || Itr->second != fingerprint(F);
+}
+
+OutdatedFunctionSet tsar::findOutdatedFunctions(const IRChangeInfo &Info,
+                                                CallGraph &CG,
+                                                bool IsBidirectional) {
+  OutdatedFunctionSet Outdated;
+  DenseMap<const Function *, SmallVector<const Function *, 4>> Neighbors;
+  std::vector<const Function *> Worklist;
+  for (auto &Node : CG) {
+    auto *Caller = Node.first;
+    if (!Caller)
+      continue;
+    for (auto &CallRecord : *Node.second)
+      if (auto *Callee = CallRecord.second->getFunction()) {
+        Neighbors[Callee].push_back(Caller);
+        if (IsBidirectional)
+          Neighbors[Caller].push_back(Callee);
+      }
+    if (!Caller->isDeclaration() && Info.isChanged(*Caller) &&
+        Outdated.insert(Caller).second)
+      Worklist.push_back(Caller);
+  }
+  while (!Worklist.empty()) {
+    auto *F = Worklist.back();
+    Worklist.pop_back();
+    auto Itr = Neighbors.find(F);
+    if (Itr == Neighbors.end())
+      continue;
+    for (auto *N : Itr->second)
+      if (Outdated.insert(N).second)
+        Worklist.push_back(N);
+  }
+  LLVM_DEBUG(dbgs() << "[IR CHANGE]: number of outdated functions "
+                    << Outdated.size() << "\n");
+  return Outdated;
+}
+
+namespace {
+class IRChangeTrackerStorage : public ImmutablePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  IRChangeTrackerStorage() : ImmutablePass(ID) {
+    initializeIRChangeTrackerStoragePass(*PassRegistry::getPassRegistry());
+  }
+
+  void initializePass() override {
+    getAnalysis<IRChangeTrackerWrapper>().set(mInfo);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<IRChangeTrackerWrapper>();
+  }
+
+private:
+  IRChangeInfo mInfo;
+};
+
+class IRChangeSnapshotPass : public ModulePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  IRChangeSnapshotPass() : ModulePass(ID) {
+    initializeIRChangeSnapshotPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override {
+    auto &Wrapper = getAnalysis<IRChangeTrackerWrapper>();
+    if (Wrapper)
+      Wrapper->snapshot(M);
+    return false;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<IRChangeTrackerWrapper>();
+    AU.setPreservesAll();
+  }
+};
+}
+
+template<> char IRChangeTrackerWrapper::ID = 0;
+INITIALIZE_PASS(IRChangeTrackerWrapper, "ir-change-iw",
+  "IR Change Tracker (Immutable Wrapper)", true, true)
+
+char IRChangeTrackerStorage::ID = 0;
+INITIALIZE_PASS_BEGIN(IRChangeTrackerStorage, "ir-change-is",
+  "IR Change Tracker (Immutable Storage)", true, true)
+INITIALIZE_PASS_DEPENDENCY(IRChangeTrackerWrapper)
+INITIALIZE_PASS_END(IRChangeTrackerStorage, "ir-change-is",
+  "IR Change Tracker (Immutable Storage)", true, true)
+
+char IRChangeSnapshotPass::ID = 0;
+INITIALIZE_PASS_BEGIN(IRChangeSnapshotPass, "ir-change-snapshot",
+  "IR Change Tracker (Snapshot)", true, true)
+INITIALIZE_PASS_DEPENDENCY(IRChangeTrackerWrapper)
+INITIALIZE_PASS_END(IRChangeSnapshotPass, "ir-change-snapshot",
+  "IR Change Tracker (Snapshot)", true, true)
+
+ImmutablePass *llvm::createIRChangeTrackerStorage() {
+  return new IRChangeTrackerStorage;
+}
+
+ModulePass *llvm::createIRChangeSnapshotPass() {
+  return new IRChangeSnapshotPass;
+}
@@ -0,0 +1,481 @@
+//===- AffineDependence.cpp - Exact Test For Affine Subscripts --*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an exact integer dependence test for array accesses
+// with affine subscripts.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Memory/AffineDependence.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/MathExtras.h>
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "affine-dependence"
+
+namespace {
+enum class Feasibility : uint8_t { Infeasible, Feasible, Unknown };
+
+/// Linear constraint `Coefs * Vars + Const` which is compared with zero.
+struct Constraint {
+  SmallVector<int64_t, 8> Coefs;
+  int64_t Const = 0;
+};
+
+int64_t floorDiv(int64_t X, int64_t Y) {
+  assert(Y > 0 && "Divisor must be positive!");
+  return X >= 0 ? X / Y : -((-X + Y - 1) / Y);
+}
+
+/// System of linear equalities (`== 0`) and inequalities (`>= 0`) over
+/// integer variables.
+///
+/// All arithmetic is checked, the system becomes unknown on overflow or if
+/// the number of produced constraints exceeds a budget.
+class ConstraintSystem {
+public:
+  ConstraintSystem(unsigned NumVars, unsigned &Budget)
+      : mNumVars(NumVars), mBudget(&Budget) {}
+
+  Constraint &addEQ() {
+    mEQs.emplace_back();
+    mEQs.back().Coefs.resize(mNumVars);
+    return mEQs.back();
+  }
+
+  Constraint &addGEQ() {
+    mGEQs.emplace_back();
+    mGEQs.back().Coefs.resize(mNumVars);
+    return mGEQs.back();
+  }
+
+  /// Check whether the system has an integer solution.
+  Feasibility solve() {
+    for (;;) {
+      bool IsValid = normalize();
+      // Do not trust the result if some calculations overflow.
+      if (mIsUnknown)
+        return Feasibility::Unknown;
+      if (!IsValid)
+        return Feasibility::Infeasible;
+      if (!mEQs.empty()) {
+        if (!eliminateEquality())
+          return Feasibility::Infeasible;
+        continue;
+      }
+      if (mGEQs.empty())
+        return Feasibility::Feasible;
+      auto Result = eliminateInequalities();
+      if (Result)
+        return *Result;
+    }
+  }
+
+private:
+  int64_t add(int64_t X, int64_t Y) {
+    int64_t Res;
+    mIsUnknown |= AddOverflow(X, Y, Res) != 0;
+    return Res;
+  }
+
+  int64_t mul(int64_t X, int64_t Y) {
+    int64_t Res;
+    mIsUnknown |= MulOverflow(X, Y, Res) != 0;
+    return Res;
+  }
+
+  /// Return `X mod^ M` as defined in the Omega test,
+  /// `X mod^ M = X - M * floor(X / M + 1/2)`.
+  int64_t modHat(int64_t X, int64_t M) {
+    return add(X, -mul(M, floorDiv(add(mul(2, X), M), mul(2, M))));
+  }
+
+  void consume() {
+    if (*mBudget == 0)
+      mIsUnknown = true;
+    else
+      --*mBudget;
+  }
+
+  unsigned addVariable() {
+    for (auto &C : mEQs)
+      C.Coefs.push_back(0);
+    for (auto &C : mGEQs)
+      C.Coefs.push_back(0);
+    return mNumVars++;
+  }
+
+  /// Divide coefficients by their GCD.
+  ///
+  /// \return `false` if constraint has no integer solutions.
+  /// \post Coefficients of a trivial constraint are zero.
+  bool normalize(Constraint &C, bool IsEQ) {
+    uint64_t G = 0;
+    for (auto Coef : C.Coefs)
+      if (Coef != 0)
+        G = G == 0 ? std::abs(Coef) : GreatestCommonDivisor64(G, std::abs(Coef));
+    if (G == 0)
+      return IsEQ ? C.Const == 0 : C.Const >= 0;
+    if (G == 1)
+      return true;
+    if (IsEQ && C.Const % (int64_t)G != 0)
+      return false;
+    for (auto &Coef : C.Coefs)
+      Coef /= (int64_t)G;
+    // Integer tightening for inequalities.
+    C.Const = IsEQ ? C.Const / (int64_t)G : floorDiv(C.Const, (int64_t)G);
+    return true;
+  }
+
+  /// Normalize all constraints, remove trivial and redundant ones and convert
+  /// pairs of opposite inequalities into equalities.
+  ///
+  /// \return `false` if the system has no integer solutions.
+  bool normalize() {
+    auto isTrivial = [](const Constraint &C) {
+      return all_of(C.Coefs, [](int64_t Coef) { return Coef == 0; });
+    };
+    for (auto &C : mEQs)
+      if (!normalize(C, true))
+        return false;
+    erase_if(mEQs, isTrivial);
+    std::map<std::vector<int64_t>, int64_t> Tightest;
+    for (auto &C : mGEQs) {
+      if (!normalize(C, false))
+        return false;
+      if (isTrivial(C))
+        continue;
+      auto Info = Tightest.emplace(
+          std::vector<int64_t>(C.Coefs.begin(), C.Coefs.end()), C.Const);
+      if (!Info.second)
+        Info.first->second = std::min(Info.first->second, C.Const);
+    }
+    mGEQs.clear();
+    std::vector<int64_t> Negative;
+    for (auto I = Tightest.begin(), EI = Tightest.end(); I != EI;) {
+      Negative.resize(I->first.size());
+      transform(I->first, Negative.begin(), [](int64_t C) { return -C; });
+      auto NegItr = Tightest.find(Negative);
+      if (NegItr != EI) {
+        auto Sum = add(I->second, NegItr->second);
+        if (Sum < 0)
+          return false;
+        if (Sum == 0) {
+          auto &EQ = addEQ();
+          EQ.Coefs.assign(I->first.begin(), I->first.end());
+          EQ.Const = I->second;
+          Tightest.erase(NegItr);
+          I = Tightest.erase(I);
+          continue;
+        }
+      }
+      mGEQs.emplace_back();
+      mGEQs.back().Coefs.assign(I->first.begin(), I->first.end());
+      mGEQs.back().Const = I->second;
+      ++I;
+    }
+    return true;
+  }
+
+  /// Replace a variable `Var` with an expression `Coefs * Vars + Const`.
+  void substitute(unsigned Var, const Constraint &Expr) {
+    assert(Expr.Coefs[Var] == 0 && "Variable must not be used in expression!");
+    auto update = [this, Var, &Expr](Constraint &C) {
+      auto K = C.Coefs[Var];
+      if (K == 0)
+        return;
+      C.Coefs[Var] = 0;
+      for (unsigned I = 0; I < mNumVars; ++I)
+        C.Coefs[I] = add(C.Coefs[I], mul(K, Expr.Coefs[I]));
+      C.Const = add(C.Const, mul(K, Expr.Const));
+    };
+    for_each(mEQs, update);
+    for_each(mGEQs, update);
+  }
+
+  /// Eliminate a variable from the last equality.
+  ///
+  /// If there is no unit coefficient, the equality is not removed, but its
+  /// coefficients are reduced with the help of a new variable as described
+  /// in the Omega test.
+  /// \return `false` if the system has no integer solutions.
+  bool eliminateEquality() {
+    consume();
+    auto &EQ = mEQs.back();
+    unsigned Var = mNumVars;
+    for (unsigned I = 0; I < mNumVars; ++I)
+      if (EQ.Coefs[I] != 0 &&
+          (Var == mNumVars || std::abs(EQ.Coefs[I]) < std::abs(EQ.Coefs[Var])))
+        Var = I;
+    assert(Var < mNumVars && "Equality must not be trivial!");
+    auto A = EQ.Coefs[Var];
+    if (std::abs(A) == 1) {
+      Constraint Expr;
+      Expr.Coefs.resize(mNumVars);
+      for (unsigned I = 0; I < mNumVars; ++I)
+        if (I != Var)
+          Expr.Coefs[I] = -A * EQ.Coefs[I];
+      Expr.Const = -A * EQ.Const;
+      mEQs.pop_back();
+      substitute(Var, Expr);
+      return true;
+    }
+    auto M = std::abs(A) + 1;
+    auto Sign = A > 0 ? 1 : -1;
+    auto Sigma = addVariable();
+    auto &ModEQ = mEQs.back();
+    Constraint Expr;
+    Expr.Coefs.resize(mNumVars);
+    for (unsigned I = 0; I < Sigma; ++I)
+      if (I != Var)
+        Expr.Coefs[I] = Sign * modHat(ModEQ.Coefs[I], M);
+    Expr.Coefs[Sigma] = -Sign * M;
+    Expr.Const = Sign * modHat(ModEQ.Const, M);
+    substitute(Var, Expr);
+    return true;
+  }
+
+  /// Eliminate a single variable from inequalities.
+  ///
+  /// \return Result if it is known after elimination, otherwise
+  /// the elimination has to be continued.
+  Optional<Feasibility> eliminateInequalities() {
+    struct Candidate {
+      unsigned NumLower = 0;
+      unsigned NumUpper = 0;
+      bool IsUnitLower = true;
+      bool IsUnitUpper = true;
+    };
+    SmallVector<Candidate, 8> Candidates(mNumVars);
+    for (auto &C : mGEQs)
+      for (unsigned I = 0; I < mNumVars; ++I)
+        if (C.Coefs[I] > 0) {
+          ++Candidates[I].NumLower;
+          Candidates[I].IsUnitLower &= C.Coefs[I] == 1;
+        } else if (C.Coefs[I] < 0) {
+          ++Candidates[I].NumUpper;
+          Candidates[I].IsUnitUpper &= C.Coefs[I] == -1;
+        }
+    Optional<unsigned> Var;
+    bool IsExact = false;
+    uint64_t Cost = 0;
+    for (unsigned I = 0; I < mNumVars; ++I) {
+      auto &Info = Candidates[I];
+      if (Info.NumLower + Info.NumUpper == 0)
+        continue;
+      // Variable which is bounded only from one side can be always chosen
+      // to satisfy all constraints which contain it.
+      if (Info.NumLower == 0 || Info.NumUpper == 0) {
+        erase_if(mGEQs, [I](const Constraint &C) { return C.Coefs[I] != 0; });
+        return None;
+      }
+      bool IsUnit = Info.IsUnitLower || Info.IsUnitUpper;
+      uint64_t CurrCost = (uint64_t)Info.NumLower * Info.NumUpper;
+      if (!Var || (IsUnit && !IsExact) ||
+          (IsUnit == IsExact && CurrCost < Cost)) {
+        Var = I;
+        IsExact = IsUnit;
+        Cost = CurrCost;
+      }
+    }
+    assert(Var && "Inequalities must not be trivial!");
+    std::vector<Constraint> Rest, Real, Dark;
+    for (auto &Lower : mGEQs) {
+      if (Lower.Coefs[*Var] == 0) {
+        Rest.push_back(Lower);
+        continue;
+      }
+      if (Lower.Coefs[*Var] < 0)
+        continue;
+      for (auto &Upper : mGEQs) {
+        if (Upper.Coefs[*Var] >= 0)
+          continue;
+        consume();
+        auto A = Lower.Coefs[*Var], B = -Upper.Coefs[*Var];
+        Real.emplace_back();
+        Real.back().Coefs.resize(mNumVars);
+        for (unsigned I = 0; I < mNumVars; ++I)
+          Real.back().Coefs[I] =
+              add(mul(B, Lower.Coefs[I]), mul(A, Upper.Coefs[I]));
+        Real.back().Const = add(mul(B, Lower.Const), mul(A, Upper.Const));
+        if (!IsExact) {
+          Dark.push_back(Real.back());
+          Dark.back().Const =
+              add(Dark.back().Const, -mul(A - 1, B - 1));
+        }
+      }
+    }
+    if (mIsUnknown)
+      return Feasibility::Unknown;
+    if (IsExact) {
+      mGEQs = std::move(Rest);
+      mGEQs.insert(mGEQs.end(), Real.begin(), Real.end());
+      return None;
+    }
+    // Inexact elimination: if there are no real solutions there are no
+    // integer solutions, if dark shadow has integer solutions then the original
+    // system also has integer solutions. Splinters are not explored.
+    ConstraintSystem RealShadow(*this);
+    RealShadow.mGEQs = Rest;
+    RealShadow.mGEQs.insert(RealShadow.mGEQs.end(), Real.begin(), Real.end());
+    auto RealResult = RealShadow.solve();
+    if (RealResult == Feasibility::Infeasible)
+      return Feasibility::Infeasible;
+    ConstraintSystem DarkShadow(*this);
+    DarkShadow.mGEQs = std::move(Rest);
+    DarkShadow.mGEQs.insert(DarkShadow.mGEQs.end(), Dark.begin(), Dark.end());
+    if (DarkShadow.solve() == Feasibility::Feasible)
+      return Feasibility::Feasible;
+    return Feasibility::Unknown;
+  }
+
+  unsigned mNumVars;
+  unsigned *mBudget;
+  bool mIsUnknown = false;
+  std::vector<Constraint> mEQs;
+  std::vector<Constraint> mGEQs;
+};
+}
+
+Optional<AffineDependence>
+tsar::testAffineDependence(const DIArrayAccess &Src, const DIArrayAccess &Dst,
+                           ArrayRef<DIArrayAccess::Scope> CommonLoops,
+                           MaxIterationFn MaxIteration, unsigned Budget) {
+  if (Src.size() != Dst.size())
+    return None;
+  // Each loop has separate iteration variables for the source and
+  // the destination.
+  SmallVector<DIArrayAccess::Scope, 8> VarToLoop;
+  DenseMap<DIArrayAccess::Scope, unsigned> SrcVars, DstVars;
+  for (auto *L : CommonLoops) {
+    SrcVars.try_emplace(L, VarToLoop.size());
+    VarToLoop.push_back(L);
+    DstVars.try_emplace(L, VarToLoop.size());
+    VarToLoop.push_back(L);
+  }
+  auto addVars = [&VarToLoop](const DIAffineSubscript &S,
+                              DenseMap<DIArrayAccess::Scope, unsigned> &Vars) {
+    for (unsigned I = 0, EI = S.getNumberOfMonoms(); I < EI; ++I) {
+      if (S.getMonom(I).Value.getMinSignedBits() > 63)
+        return false;
+      if (Vars.try_emplace(S.getMonom(I).Column, VarToLoop.size()).second)
+        VarToLoop.push_back(S.getMonom(I).Column);
+    }
+    return S.getConstant().getMinSignedBits() <= 63;
+  };
+  for (unsigned DimIdx = 0, DimIdxE = Src.size(); DimIdx < DimIdxE; ++DimIdx) {
+    auto *SrcS = dyn_cast_or_null<DIAffineSubscript>(Src[DimIdx]);
+    auto *DstS = dyn_cast_or_null<DIAffineSubscript>(Dst[DimIdx]);
+    if (!SrcS || !DstS || !addVars(*SrcS, SrcVars) || !addVars(*DstS, DstVars))
+      return None;
+  }
+  SmallVector<Optional<int64_t>, 8> MaxIterations;
+  DenseMap<DIArrayAccess::Scope, Optional<int64_t>> LoopToMax;
+  for (auto *L : VarToLoop) {
+    auto Itr = LoopToMax.find(L);
+    if (Itr == LoopToMax.end())
+      Itr = LoopToMax.try_emplace(L, MaxIteration(L)).first;
+    MaxIterations.push_back(Itr->second);
+  }
+  unsigned NumVars = VarToLoop.size();
+  ConstraintSystem Base(NumVars, Budget);
+  for (unsigned DimIdx = 0, DimIdxE = Src.size(); DimIdx < DimIdxE; ++DimIdx) {
+    auto *SrcS = cast<DIAffineSubscript>(Src[DimIdx]);
+    auto *DstS = cast<DIAffineSubscript>(Dst[DimIdx]);
+    auto &EQ = Base.addEQ();
+    for (unsigned I = 0, EI = SrcS->getNumberOfMonoms(); I < EI; ++I)
+      EQ.Coefs[SrcVars[SrcS->getMonom(I).Column]] +=
+          SrcS->getMonom(I).Value.getSExtValue();
+    for (unsigned I = 0, EI = DstS->getNumberOfMonoms(); I < EI; ++I)
+      EQ.Coefs[DstVars[DstS->getMonom(I).Column]] -=
+          DstS->getMonom(I).Value.getSExtValue();
+    EQ.Const = SrcS->getConstant().getSExtValue();
+    if (SubOverflow(EQ.Const, DstS->getConstant().getSExtValue(), EQ.Const))
+      return None;
+  }
+  for (unsigned I = 0; I < NumVars; ++I) {
+    Base.addGEQ().Coefs[I] = 1;
+    if (MaxIterations[I]) {
+      auto &Upper = Base.addGEQ();
+      Upper.Coefs[I] = -1;
+      Upper.Const = *MaxIterations[I];
+    }
+  }
+  AffineDependence Result;
+  Result.Directions.resize(CommonLoops.size(), AffineDependence::None);
+  auto BaseResult = ConstraintSystem(Base).solve();
+  if (BaseResult == Feasibility::Infeasible) {
+    LLVM_DEBUG(dbgs() << "[AFFINE DEPENDENCE]: independent accesses\n");
+    return Result;
+  }
+  if (BaseResult == Feasibility::Unknown) {
+    Result.IsExact = false;
+    for (auto &Dir : Result.Directions)
+      Dir = AffineDependence::All;
+    return Result;
+  }
+  // Iteration variables of the source and the destination for the Level-th
+  // loop are 2 * Level and 2 * Level + 1.
+  for (unsigned Level = 0, LevelE = CommonLoops.size(); Level < LevelE;
+       ++Level) {
+    auto check = [&Base, &Result, Level](int64_t Src, int64_t Dst,
+                                         int64_t Const, bool IsEQ) {
+      ConstraintSystem S(Base);
+      for (unsigned Outer = 0; Outer < Level; ++Outer) {
+        auto &EQ = S.addEQ();
+        EQ.Coefs[2 * Outer] = 1;
+        EQ.Coefs[2 * Outer + 1] = -1;
+      }
+      auto &C = IsEQ ? S.addEQ() : S.addGEQ();
+      C.Coefs[2 * Level] = Src;
+      C.Coefs[2 * Level + 1] = Dst;
+      C.Const = Const;
+      auto Res = S.solve();
+      Result.IsExact &= Res != Feasibility::Unknown;
+      return Res != Feasibility::Infeasible;
+    };
+    auto &Dir = Result.Directions[Level];
+    // Src < Dst: Dst - Src - 1 >= 0.
+    if (check(-1, 1, -1, false))
+      Dir |= AffineDependence::LT;
+    // Src > Dst: Src - Dst - 1 >= 0.
+    if (check(1, -1, -1, false))
+      Dir |= AffineDependence::GT;
+    if (!check(1, -1, 0, true))
+      break;
+    Dir |= AffineDependence::EQ;
+  }
+  LLVM_DEBUG(dbgs() << "[AFFINE DEPENDENCE]: directions";
+             for (auto Dir : Result.Directions) {
+               dbgs() << " ";
+               if (Dir & AffineDependence::LT) dbgs() << "<";
+               if (Dir & AffineDependence::EQ) dbgs() << "=";
+               if (Dir & AffineDependence::GT) dbgs() << ">";
+               if (Dir == AffineDependence::None) dbgs() << "none";
+             }
+             dbgs() << (Result.IsExact ? "" : " (inexact)") << "\n");
+  return Result;
+}
@@ -616,37 +616,11 @@ void IRToArrayInfoFunctor::operator()(Instruction &I, MemoryLocation &&Loc,
              if (IsRead != AccessInfo::No) dbgs() << "read"; dbgs() << "\n");
   for (std::size_t DimIdx = 0, DimIdxE = Range.Subscripts.size();
        DimIdx < DimIdxE; ++DimIdx) {
-    auto *S = Range.Subscripts[DimIdx];
-    auto AddRecInfo = computeSCEVAddRec(S, SE);
-    const SCEV *Coef, *ConstTerm;
-    const Loop *L = nullptr;
-    if ((!GlobalOpts.IsSafeTypeCast || AddRecInfo.second) &&
-        isa<SCEVAddRecExpr>(AddRecInfo.first)) {
-      auto AddRec = cast<SCEVAddRecExpr>(AddRecInfo.first);
-      Coef = AddRec->getStepRecurrence(SE);
-      ConstTerm = AddRec->getStart();
-      L = AddRec->getLoop();
-    } else {
-      Coef = SE.getZero(S->getType());
-      ConstTerm = S;
-    }
-    if (!isa<SCEVConstant>(ConstTerm))
+    auto *DimAccess = buildAffineSubscript(*Access, DimIdx,
+                                           Range.Subscripts[DimIdx], SE,
+                                           GlobalOpts.IsSafeTypeCast);
+    if (!DimAccess)
       continue;
-    ObjectID MonomLoopID = nullptr;
-    if (L) {
-      if (!isa<SCEVConstant>(Coef))
-        continue;
-      MonomLoopID = L->getLoopID();
-      if (!MonomLoopID)
-        continue;
-    }
-    auto ConstTermValue = cast<SCEVConstant>(ConstTerm)->getAPInt();
-    auto *DimAccess =
-        Access->make<DIAffineSubscript>(DimIdx, APSInt(ConstTermValue, false));
-    if (L) {
-      auto CoefValue = cast<SCEVConstant>(Coef)->getAPInt();
-      DimAccess->emplaceMonom(MonomLoopID, APSInt(CoefValue, false));
-    }
     LLVM_DEBUG(dbgs() << "[DI ARRAY ACCESS]: dimension " << DimIdx
                       << " subscript " << DimAccess->getConstant();
                for (unsigned I = 0, EI = DimAccess->getNumberOfMonoms(); I < EI;
@@ -658,6 +632,36 @@ void IRToArrayInfoFunctor::operator()(Instruction &I, MemoryLocation &&Loc,
   Accesses.add(Access.release(), LoopNest);
 }
 
+DIAffineSubscript *tsar::buildAffineSubscript(DIArrayAccess &Access,
+                                              unsigned DimIdx, const SCEV *Expr,
+                                              ScalarEvolution &SE,
+                                              bool IsSafeTypeCast) {
+  auto AddRecInfo = computeSCEVAddRec(Expr, SE);
+  if (!IsSafeTypeCast || AddRecInfo.second)
+    Expr = AddRecInfo.first;
+  // Collect monoms for all loops in a nest, the start of an inner recurrence
+  // may be a recurrence over an outer loop.
+  SmallVector<DIAffineSubscript::Monom, 2> Monoms;
+  while (auto *AddRec = dyn_cast<SCEVAddRecExpr>(Expr)) {
+    if (!AddRec->isAffine())
+      return nullptr;
+    auto *Coef = dyn_cast<SCEVConstant>(AddRec->getStepRecurrence(SE));
+    auto *LoopID = AddRec->getLoop()->getLoopID();
+    if (!Coef || !LoopID)
+      return nullptr;
+    Monoms.emplace_back(LoopID, APSInt(Coef->getAPInt(), false));
+    Expr = AddRec->getStart();
+  }
+  auto *ConstTerm = dyn_cast<SCEVConstant>(Expr);
+  if (!ConstTerm)
+    return nullptr;
+  auto *Subscript = Access.make<DIAffineSubscript>(
+      DimIdx, APSInt(ConstTerm->getAPInt(), false));
+  for (auto &M : Monoms)
+    Subscript->addMonom(std::move(M));
+  return Subscript;
+}
+
 void DIArrayAccessWrapper::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<LoopInfoWrapperPass>();
   AU.setPreservesAll();
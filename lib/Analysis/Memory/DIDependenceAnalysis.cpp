@@ -42,6 +42,7 @@
 #include "tsar/Support/IRUtils.h"
 #include "tsar/Support/MetadataUtils.h"
 #include "tsar/Support/Tags.h"
+#include "tsar/Support/TraceProfiler.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Unparse/SourceUnparser.h"
 #include "tsar/Unparse/Utils.h"
@@ -2003,6 +2004,8 @@ bool DIDependencyAnalysisPass::runOnFunction(Function &F) {
     if (!L->getLoopID())
       continue;
     assert(L->getLoopID() && "Identifier of a loop must be specified!");
+    TraceScope Scope("DIDependencyAnalysis",
+                     [L]() { return getTraceDetail(*L); });
     auto DILoop = L->getLoopID();
     LLVM_DEBUG(dbgs() << "[DA DI]: process "; TSAR_LLVM_DUMP(L->dump());
       if (DebugLoc DbgLoc = L->getStartLoc()) {
@@ -24,6 +24,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/AnalysisServer.h"
+#include "tsar/Analysis/Memory/ArraySection.h"
 #include "tsar/Analysis/Memory/ClonedDIMemoryMatcher.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
 #include "tsar/Analysis/Memory/DIArrayAccess.h"
@@ -104,6 +105,11 @@ public:
       [&GlobalLiveMemory](GlobalLiveMemoryWrapper &Wrapper) {
         Wrapper.set(GlobalLiveMemory);
       });
+    auto &ArraySections = getAnalysis<GlobalArraySectionWrapper>().get();
+    DIMemoryAnalysisServerProvider::initialize<GlobalArraySectionWrapper>(
+      [&ArraySections](GlobalArraySectionWrapper &Wrapper) {
+        Wrapper.set(ArraySections);
+      });
     return false;
   }
 
@@ -114,6 +120,7 @@ public:
     AU.addRequired<DIMemoryTraitPoolWrapper>();
     AU.addRequired<GlobalDefinedMemoryWrapper>();
     AU.addRequired<GlobalLiveMemoryWrapper>();
+    AU.addRequired<GlobalArraySectionWrapper>();
     AU.setPreservesAll();
   }
 };
@@ -144,6 +151,8 @@ public:
     PM.add(createGlobalOptionsImmutableWrapper(&GO.getOptions()));
     PM.add(createGlobalDefinedMemoryStorage());
     PM.add(createGlobalLiveMemoryStorage());
+    PM.add(createGlobalArraySectionStorage());
+    PM.add(createIRChangeTrackerStorage());
     PM.add(createDIMemoryTraitPoolStorage());
     PM.add(createDIArrayAccessStorage());
     ClientToServerMemory::initializeServer(*this, CM, SM, CToS, PM);
@@ -223,6 +232,7 @@ INITIALIZE_PASS_BEGIN(DIMemoryAnalysisServerProviderPass,
   INITIALIZE_PASS_DEPENDENCY(DIMemoryEnvironmentWrapper)
   INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
   INITIALIZE_PASS_DEPENDENCY(GlobalLiveMemoryWrapper)
+  INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionWrapper)
   INITIALIZE_PASS_END(DIMemoryAnalysisServerProviderPass,
     "di-memory-server-provider-init",
     "Metadata-Level Memory Server (Provider, Initialize)", true, true)
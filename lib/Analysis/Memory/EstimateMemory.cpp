@@ -37,6 +37,7 @@
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
+#include <functional>
 
 using namespace tsar;
 using namespace llvm;
@@ -50,6 +51,9 @@ STATISTIC(NumUnknownNode, "Number of unknown nodes created");
 STATISTIC(NumMergedNode, "Number of alias nodes merged in");
 STATISTIC(NumEstimateMemory, "Number of estimate memory created");
 STATISTIC(NumUnknownMemory, "Number of unknown memory created");
+STATISTIC(NumAliasQuery, "Number of alias queries");
+STATISTIC(NumAliasQueryCached, "Number of cached alias queries");
+STATISTIC(NumAliasNodeSkipped, "Number of alias nodes skipped due to index");
 
 static inline void clarifyUnknownSize(const DataLayout &DL,
     MemoryLocation &Loc, const DominatorTree *DT = nullptr) {
@@ -509,6 +513,8 @@ void AliasTree::add(const MemoryLocation &Loc) {
     EstimateMemory *EM;
     bool IsNew, AddAmbiguous;
     std::tie(EM, IsNew, AddAmbiguous) = insert(Base);
+    if (IsNew || AddAmbiguous)
+      indexMemory(*EM);
     EM->setExplicit(EM->isExplicit() || !PrevChainEnd);
     LLVM_DEBUG(updateEMTreeLog(EM, IsNew, AddAmbiguous, getDomTree()));
     assert(EM && "New estimate memory must not be null!");
@@ -673,11 +679,12 @@ AliasUnknownNode::slowMayAliasUnknownImp(
 }
 
 std::pair<bool, EstimateMemory *>
-AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
+AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM,
+    const AliasTree &G) {
   for (auto &ThisEM : *this)
     for (auto *LHSPtr : ThisEM)
       for (auto *RHSPtr : EM) {
-        auto AR = AA.alias(
+        auto AR = G.alias(
           MemoryLocation(LHSPtr, ThisEM.getSize(), ThisEM.getAAInfo()),
           MemoryLocation(RHSPtr, EM.getSize(), EM.getAAInfo()));
         if (AR == NoAlias)
@@ -688,7 +695,9 @@ AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
 }
 
 std::pair<bool, EstimateMemory *>
-AliasUnknownNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
+AliasUnknownNode::slowMayAliasImp(const EstimateMemory &EM,
+    const AliasTree &G) {
+  auto &AA = G.getAliasAnalysis();
   for (auto *UI : *this) {
     for (auto *Ptr : EM)
       if (AA.getModRefInfo(UI, MemoryLocation(Ptr, EM.getSize(), EM.getAAInfo()))
@@ -698,6 +707,57 @@ AliasUnknownNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
   return std::make_pair(false, nullptr);
 }
 
+AliasResult AliasTree::alias(
+    const MemoryLocation &LHS, const MemoryLocation &RHS) const {
+  auto Key = std::less<const Value *>()(LHS.Ptr, RHS.Ptr) ?
+    std::make_pair(LHS, RHS) : std::make_pair(RHS, LHS);
+  auto Itr = mAliasCache.find(Key);
+  if (Itr != mAliasCache.end()) {
+    ++NumAliasQueryCached;
+    return Itr->second;
+  }
+  ++NumAliasQuery;
+  auto AR = mAA->alias(LHS, RHS);
+  mAliasCache.try_emplace(Key, AR);
+  return AR;
+}
+
+void AliasTree::indexMemory(EstimateMemory &EM) {
+  using CT = bcl::ChainTraits<EstimateMemory, Hierarchy>;
+  // All locations with the same base share the list of ambiguous pointers
+  // and they are neighbors in a chain.
+  auto *First = &EM;
+  while (CT::getPrev(First) && CT::getPrev(First)->isSameBase(EM))
+    First = CT::getPrev(First);
+  for (auto *Curr = First; Curr && Curr->isSameBase(EM);
+       Curr = CT::getNext(Curr))
+    for (auto *Ptr : *Curr) {
+      auto *Obj = GetUnderlyingObject(Ptr, *mDL);
+      if (isIdentifiedObject(Obj))
+        mObjectIndex[Obj].insert(Curr);
+      else
+        mUnidentifiedMemory.insert(Curr);
+    }
+}
+
+bool AliasTree::collectMayAlias(const EstimateMemory &EM,
+    SmallVectorImpl<EstimateMemory *> &MayAlias) const {
+  SmallPtrSet<const Value *, 4> Objects;
+  for (auto *Ptr : EM) {
+    auto *Obj = GetUnderlyingObject(Ptr, *mDL);
+    if (!isIdentifiedObject(Obj))
+      return false;
+    Objects.insert(Obj);
+  }
+  MayAlias.append(mUnidentifiedMemory.begin(), mUnidentifiedMemory.end());
+  for (auto *Obj : Objects) {
+    auto I = mObjectIndex.find(Obj);
+    if (I != mObjectIndex.end())
+      MayAlias.append(I->second.begin(), I->second.end());
+  }
+  return true;
+}
+
 AliasEstimateNode * AliasTree::addEmptyNode(
     const EstimateMemory &NewEM,  AliasNode &Start) {
   auto Current = &Start;
@@ -709,14 +769,35 @@ AliasEstimateNode * AliasTree::addEmptyNode(
     return Ptr.is<AliasNode *>() ? Ptr.get<AliasNode *>() :
       Ptr.get<EstimateMemory *>()->getAliasNode(*this);
   };
+  // Two different identified objects never alias, so it is not necessary to
+  // query alias analysis for nodes which do not contain locations from
+  // the MayAlias list. Note, that nodes may be merged, so a set of nodes
+  // which contain these locations is recalculated at each level.
+  SmallVector<EstimateMemory *, 16> MayAlias;
+  bool UseIndex = collectMayAlias(NewEM, MayAlias);
+  SmallPtrSet<const AliasNode *, 16> MayAliasNodes;
+  auto mayAlias = [UseIndex, &MayAliasNodes](const AliasNode &N) {
+    if (!UseIndex || isa<AliasUnknownNode>(N) || MayAliasNodes.count(&N))
+      return true;
+    ++NumAliasNodeSkipped;
+    return false;
+  };
   for (;;) {
     // This condition is necessary due to alias node which contains full memory
     // should not be descendant of a node which contains part of this memory.
     if (ChildrenNodes.count(Current))
       return cast<AliasEstimateNode>(Current);
     Aliases.clear();
+    if (UseIndex) {
+      MayAliasNodes.clear();
+      for (auto *EM : MayAlias)
+        if (auto *N = EM->getAliasNode(*this))
+          MayAliasNodes.insert(N);
+    }
     for (auto &Ch : make_range(Current->child_begin(), Current->child_end())) {
-      auto Result = Ch.slowMayAlias(NewEM, *mAA);
+      if (!mayAlias(Ch))
+        continue;
+      auto Result = Ch.slowMayAlias(NewEM, *this);
       if (Result.first) {
         if (Result.second)
           Aliases.push_back(Result.second);
@@ -727,7 +808,9 @@ AliasEstimateNode * AliasTree::addEmptyNode(
         // that its children nodes do not alias with this memory. The issue is
         // that unknown node may not cover its children nodes.
         for (auto &N : make_range(Ch.child_begin(), Ch.child_end())) {
-          auto Result = N.slowMayAlias(NewEM, *mAA);
+          if (!mayAlias(N))
+            continue;
+          auto Result = N.slowMayAlias(NewEM, *this);
           if (Result.first) {
             Aliases.push_back(&Ch);
             break;
@@ -1114,5 +1197,6 @@ bool EstimateMemoryPass::runOnFunction(Function &F) {
       }
     }
   }
+  mAliasTree->releaseAliasCache();
   return false;
 }
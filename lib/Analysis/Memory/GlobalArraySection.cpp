@@ -0,0 +1,540 @@
+//===- GlobalArraySection.cpp - Summary Of Array Sections -------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass which computes summaries of array sections
+// accessed in functions. Summaries are computed bottom-up over the call graph.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Memory/ArraySection.h"
+#include "tsar/Analysis/IRChangeTracker.h"
+#include "tsar/Analysis/KnownFunctionTraits.h"
+#include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/PassProvider.h"
+#include "tsar/Support/TraceProfiler.h"
+#include <bcl/utility.h>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/InitializePasses.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/raw_ostream.h>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "array-section"
+
+using namespace llvm;
+using namespace tsar;
+
+STATISTIC(NumSummarizedFunc, "Number of functions with array sections summary");
+STATISTIC(NumReusedSummary, "Number of reused array sections summaries");
+
+static cl::opt<unsigned> SectionLimit("array-section-limit", cl::init(16),
+  cl::Hidden, cl::ZeroOrMore,
+  cl::desc("Maximum number of array sections in a function summary "
+           "(default 16)"));
+
+bool ArraySectionBound::addConstant(int64_t C) {
+  return !AddOverflow(mConstant, C, mConstant);
+}
+
+bool ArraySectionBound::addTerm(unsigned ArgNo, int64_t Coef, CastKind Cast) {
+  auto Itr = find_if(mTerms, [ArgNo, Cast](const Term &T) {
+    return T.ArgNo == ArgNo && T.Cast == Cast;
+  });
+  if (Itr == mTerms.end()) {
+    if (Coef == 0)
+      return true;
+    // Keep terms sorted to simplify comparison of bounds.
+    Itr = find_if(mTerms, [ArgNo, Cast](const Term &T) {
+      return T.ArgNo > ArgNo || (T.ArgNo == ArgNo && T.Cast > Cast);
+    });
+    mTerms.insert(Itr, Term{ArgNo, Coef, Cast});
+    return true;
+  }
+  if (AddOverflow(Itr->Coef, Coef, Itr->Coef))
+    return false;
+  if (Itr->Coef == 0)
+    mTerms.erase(Itr);
+  return true;
+}
+
+bool ArraySectionBound::hasSameTerms(const ArraySectionBound &RHS) const {
+  return mTerms.size() == RHS.mTerms.size() &&
+         std::equal(mTerms.begin(), mTerms.end(), RHS.mTerms.begin(),
+                    [](const Term &LHS, const Term &RHS) {
+                      return LHS.ArgNo == RHS.ArgNo && LHS.Coef == RHS.Coef &&
+                             LHS.Cast == RHS.Cast;
+                    });
+}
+
+const SCEV *tsar::instantiateBound(const ArraySectionBound &Bound,
+    const CallBase &Call, Type *Ty, ScalarEvolution &SE) {
+  SmallVector<const SCEV *, 4> Ops;
+  Ops.push_back(SE.getConstant(Ty, Bound.getConstant(), true));
+  for (auto &T : Bound.terms()) {
+    if (T.ArgNo >= Call.arg_size())
+      return nullptr;
+    auto *Arg = Call.getArgOperand(T.ArgNo);
+    if (!Arg->getType()->isIntegerTy() ||
+        SE.getTypeSizeInBits(Arg->getType()) > SE.getTypeSizeInBits(Ty))
+      return nullptr;
+    auto *Param = SE.getSCEV(Arg);
+    switch (T.Cast) {
+    case ArraySectionBound::SExt:
+      Param = SE.getNoopOrSignExtend(Param, Ty); break;
+    case ArraySectionBound::ZExt:
+      Param = SE.getNoopOrZeroExtend(Param, Ty); break;
+    default:
+      if (Param->getType() != Ty)
+        return nullptr;
+      break;
+    }
+    Ops.push_back(SE.getMulExpr(SE.getConstant(Ty, T.Coef, true), Param));
+  }
+  return SE.getAddExpr(Ops);
+}
+
+const SCEV *tsar::getLoopBound(const SCEV *Expr, bool IsMax,
+    function_ref<bool(const Loop *)> IsEliminated, ScalarEvolution &SE,
+    bool IsSafeTypeCast) {
+  auto isVariant = [IsEliminated](const SCEV *S) {
+    return SCEVExprContains(S, [IsEliminated](const SCEV *S) {
+      auto *AddRec = dyn_cast<SCEVAddRecExpr>(S);
+      return AddRec && IsEliminated(AddRec->getLoop());
+    });
+  };
+  if (!isVariant(Expr))
+    return Expr;
+  if (auto *Add = dyn_cast<SCEVAddExpr>(Expr)) {
+    SmallVector<const SCEV *, 4> Ops;
+    for (auto *Op : Add->operands()) {
+      auto *Bound = getLoopBound(Op, IsMax, IsEliminated, SE, IsSafeTypeCast);
+      if (!Bound)
+        return nullptr;
+      Ops.push_back(Bound);
+    }
+    return SE.getAddExpr(Ops);
+  }
+  if (auto *Mul = dyn_cast<SCEVMulExpr>(Expr)) {
+    auto *C = dyn_cast<SCEVConstant>(Mul->getOperand(0));
+    if (!C || Mul->getNumOperands() != 2)
+      return nullptr;
+    auto *Bound = getLoopBound(Mul->getOperand(1),
+                               C->getAPInt().isNegative() ? !IsMax : IsMax,
+                               IsEliminated, SE, IsSafeTypeCast);
+    return Bound ? SE.getMulExpr(C, Bound) : nullptr;
+  }
+  if (auto *Cast = dyn_cast<SCEVCastExpr>(Expr)) {
+    if (!IsSafeTypeCast ||
+        !(isa<SCEVSignExtendExpr>(Cast) || isa<SCEVZeroExtendExpr>(Cast)))
+      return nullptr;
+    auto *Bound = getLoopBound(Cast->getOperand(), IsMax, IsEliminated, SE,
+                               IsSafeTypeCast);
+    if (!Bound)
+      return nullptr;
+    return isa<SCEVSignExtendExpr>(Cast)
+               ? SE.getSignExtendExpr(Bound, Cast->getType())
+               : SE.getZeroExtendExpr(Bound, Cast->getType());
+  }
+  auto *AddRec = dyn_cast<SCEVAddRecExpr>(Expr);
+  if (!AddRec || !AddRec->isAffine())
+    return nullptr;
+  auto *Start =
+      getLoopBound(AddRec->getStart(), IsMax, IsEliminated, SE, IsSafeTypeCast);
+  if (!Start)
+    return nullptr;
+  auto *L = AddRec->getLoop();
+  if (!IsEliminated(L)) {
+    auto *Step = AddRec->getStepRecurrence(SE);
+    if (isVariant(Step))
+      return nullptr;
+    return SE.getAddRecExpr(Start, Step, L, SCEV::FlagAnyWrap);
+  }
+  auto *Step = dyn_cast<SCEVConstant>(AddRec->getStepRecurrence(SE));
+  if (!Step)
+    return nullptr;
+  // The first iteration of a loop gives the lower bound if the step is not
+  // negative and it gives the upper bound otherwise.
+  if (Step->getAPInt().isNonNegative() != IsMax)
+    return Start;
+  auto *BTC = SE.getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC))
+    BTC = SE.getConstantMaxBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC))
+    return nullptr;
+  // Number of iterations of an inner loop may depend on outer loops.
+  BTC = getLoopBound(BTC, true, IsEliminated, SE, IsSafeTypeCast);
+  if (!BTC || SE.getTypeSizeInBits(BTC->getType()) >
+                  SE.getTypeSizeInBits(Step->getType()))
+    return nullptr;
+  BTC = SE.getNoopOrZeroExtend(BTC, Step->getType());
+  return SE.getAddExpr(Start, SE.getMulExpr(Step, BTC));
+}
+
+namespace {
+class GlobalArraySection : public ModulePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  GlobalArraySection() : ModulePass(ID) {
+    initializeGlobalArraySectionPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+  void getAnalysisUsage(AnalysisUsage& AU) const override;
+};
+
+class GlobalArraySectionStorage :
+  public ImmutablePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  GlobalArraySectionStorage() : ImmutablePass(ID) {
+    initializeGlobalArraySectionStoragePass(*PassRegistry::getPassRegistry());
+  }
+
+  void initializePass() override {
+    getAnalysis<GlobalArraySectionWrapper>().set(mSectionInfo);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<GlobalArraySectionWrapper>();
+  }
+
+  /// Return summaries of array sections accessed in functions.
+  tsar::InterprocArraySectionInfo & getSectionInfo() noexcept {
+    return mSectionInfo;
+  }
+
+  /// Return summaries of array sections accessed in functions.
+  const tsar::InterprocArraySectionInfo & getSectionInfo() const noexcept {
+    return mSectionInfo;
+  }
+
+private:
+  tsar::InterprocArraySectionInfo mSectionInfo;
+};
+
+using GlobalArraySectionProvider =
+    FunctionPassProvider<ScalarEvolutionWrapperPass>;
+
+/// Build summary for a single function.
+class SummaryBuilder {
+public:
+  SummaryBuilder(Function &F, ScalarEvolution &SE,
+                 const InterprocArraySectionInfo &Info, bool IsSafeTypeCast)
+      : mFunc(&F), mSE(&SE), mInfo(&Info), mIsSafeTypeCast(IsSafeTypeCast) {}
+
+  /// Return false if summary can not be built.
+  bool build(ArraySectionSummary &Summary);
+
+private:
+  /// Convert an expression to a linear function of formal parameters.
+  bool buildBound(const SCEV *Expr, int64_t Scale, ArraySectionBound &Bound);
+
+  /// Add section which contains all values of `[Lower, Upper)` where `Lower`
+  /// and `Upper` are offsets from a specified pointer.
+  bool addSection(const Value *Ptr, const SCEV *Lower, const SCEV *Upper,
+                  bool IsRead, bool IsWrite, ArraySectionSummary &Summary);
+
+  bool addAccess(const Value *Ptr, uint64_t Size, bool IsRead, bool IsWrite,
+                 ArraySectionSummary &Summary);
+
+  bool addCall(const CallBase &Call, ArraySectionSummary &Summary);
+
+  Function *mFunc;
+  ScalarEvolution *mSE;
+  const InterprocArraySectionInfo *mInfo;
+  bool mIsSafeTypeCast;
+};
+}
+
+bool SummaryBuilder::buildBound(const SCEV *Expr, int64_t Scale,
+                                ArraySectionBound &Bound) {
+  if (auto *C = dyn_cast<SCEVConstant>(Expr)) {
+    int64_t Value;
+    return C->getAPInt().getMinSignedBits() <= 64 &&
+           !MulOverflow(C->getAPInt().getSExtValue(), Scale, Value) &&
+           Bound.addConstant(Value);
+  }
+  if (auto *Add = dyn_cast<SCEVAddExpr>(Expr)) {
+    for (auto *Op : Add->operands())
+      if (!buildBound(Op, Scale, Bound))
+        return false;
+    return true;
+  }
+  if (auto *Mul = dyn_cast<SCEVMulExpr>(Expr)) {
+    auto *C = dyn_cast<SCEVConstant>(Mul->getOperand(0));
+    int64_t NewScale;
+    return C && Mul->getNumOperands() == 2 &&
+           C->getAPInt().getMinSignedBits() <= 64 &&
+           !MulOverflow(C->getAPInt().getSExtValue(), Scale, NewScale) &&
+           buildBound(Mul->getOperand(1), NewScale, Bound);
+  }
+  auto Cast = ArraySectionBound::NoCast;
+  if (isa<SCEVSignExtendExpr>(Expr))
+    Cast = ArraySectionBound::SExt;
+  else if (isa<SCEVZeroExtendExpr>(Expr))
+    Cast = ArraySectionBound::ZExt;
+  if (Cast != ArraySectionBound::NoCast)
+    Expr = cast<SCEVCastExpr>(Expr)->getOperand();
+  auto *Unknown = dyn_cast<SCEVUnknown>(Expr);
+  if (!Unknown)
+    return false;
+  auto *Arg = dyn_cast<Argument>(Unknown->getValue());
+  return Arg && Arg->getParent() == mFunc && Arg->getType()->isIntegerTy() &&
+         Bound.addTerm(Arg->getArgNo(), Scale, Cast);
+}
+
+bool SummaryBuilder::addSection(const Value *Ptr, const SCEV *Lower,
+    const SCEV *Upper, bool IsRead, bool IsWrite,
+    ArraySectionSummary &Summary) {
+  auto &DL = mFunc->getParent()->getDataLayout();
+  auto *Base = GetUnderlyingObject(Ptr, DL, 0);
+  // Memory allocated in a function is not visible outside this function.
+  if (isa<AllocaInst>(Base))
+    return true;
+  auto *Arg = dyn_cast<Argument>(Base);
+  if (!Arg || Arg->getParent() != mFunc)
+    return false;
+  auto *Offset =
+      mSE->getMinusSCEV(mSE->getSCEV(const_cast<Value *>(Ptr)),
+                        mSE->getSCEV(const_cast<Argument *>(Arg)));
+  if (isa<SCEVCouldNotCompute>(Offset))
+    return false;
+  auto *OffsetTy = mSE->getEffectiveSCEVType(Offset->getType());
+  if (Lower->getType() != OffsetTy || Upper->getType() != OffsetTy)
+    return false;
+  auto IsEliminated = [](const Loop *) { return true; };
+  auto *LowerBound = getLoopBound(mSE->getAddExpr(Offset, Lower), false,
+                                  IsEliminated, *mSE, mIsSafeTypeCast);
+  auto *UpperBound = getLoopBound(mSE->getAddExpr(Offset, Upper), true,
+                                  IsEliminated, *mSE, mIsSafeTypeCast);
+  if (!LowerBound || !UpperBound)
+    return false;
+  ArraySection Section{Arg->getArgNo(), ArraySectionBound(),
+                       ArraySectionBound(), IsRead, IsWrite};
+  if (!buildBound(LowerBound, 1, Section.Lower) ||
+      !buildBound(UpperBound, 1, Section.Upper))
+    return false;
+  // Merge sections which differ in constant offsets only.
+  for (auto &S : Summary)
+    if (S.ArgNo == Section.ArgNo && S.IsRead == IsRead &&
+        S.IsWrite == IsWrite && S.Lower.hasSameTerms(Section.Lower) &&
+        S.Upper.hasSameTerms(Section.Upper)) {
+      if (Section.Lower.getConstant() < S.Lower.getConstant())
+        S.Lower = std::move(Section.Lower);
+      if (Section.Upper.getConstant() > S.Upper.getConstant())
+        S.Upper = std::move(Section.Upper);
+      return true;
+    }
+  if (Summary.size() >= SectionLimit)
+    return false;
+  Summary.push_back(std::move(Section));
+  return true;
+}
+
+bool SummaryBuilder::addAccess(const Value *Ptr, uint64_t Size, bool IsRead,
+                               bool IsWrite, ArraySectionSummary &Summary) {
+  auto *Ty = mSE->getEffectiveSCEVType(Ptr->getType());
+  return addSection(Ptr, mSE->getZero(Ty), mSE->getConstant(Ty, Size), IsRead,
+                    IsWrite, Summary);
+}
+
+bool SummaryBuilder::addCall(const CallBase &Call,
+                             ArraySectionSummary &Summary) {
+  auto *Callee = dyn_cast<Function>(Call.getCalledOperand()->stripPointerCasts());
+  if (!Callee)
+    return false;
+  auto InfoItr = mInfo->find(Callee);
+  if (InfoItr == mInfo->end())
+    return false;
+  for (auto &S : InfoItr->second) {
+    if (S.ArgNo >= Call.arg_size())
+      return false;
+    auto *Ptr = Call.getArgOperand(S.ArgNo);
+    if (!Ptr->getType()->isPointerTy())
+      return false;
+    auto *Ty = mSE->getEffectiveSCEVType(Ptr->getType());
+    auto *Lower = instantiateBound(S.Lower, Call, Ty, *mSE);
+    auto *Upper = instantiateBound(S.Upper, Call, Ty, *mSE);
+    if (!Lower || !Upper ||
+        !addSection(Ptr, Lower, Upper, S.IsRead, S.IsWrite, Summary))
+      return false;
+  }
+  return true;
+}
+
+bool SummaryBuilder::build(ArraySectionSummary &Summary) {
+  auto &DL = mFunc->getParent()->getDataLayout();
+  for (auto &I : instructions(mFunc)) {
+    if (!I.mayReadOrWriteMemory())
+      continue;
+    if (auto *LI = dyn_cast<LoadInst>(&I)) {
+      if (!addAccess(LI->getPointerOperand(),
+                     DL.getTypeStoreSize(LI->getType()), true, false, Summary))
+        return false;
+    } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+      if (!addAccess(SI->getPointerOperand(),
+              DL.getTypeStoreSize(SI->getValueOperand()->getType()), false,
+              true, Summary))
+        return false;
+    } else if (auto *II = dyn_cast<IntrinsicInst>(&I)) {
+      if (isMemoryMarkerIntrinsic(II->getIntrinsicID()) ||
+          isDbgInfoIntrinsic(II->getIntrinsicID()))
+        continue;
+      // Initialization of local arrays is allowed only.
+      auto *MI = dyn_cast<AnyMemIntrinsic>(II);
+      if (!MI || !isa<AllocaInst>(GetUnderlyingObject(MI->getDest(), DL, 0)))
+        return false;
+      if (auto *MTI = dyn_cast<AnyMemTransferInst>(MI))
+        if (!isa<AllocaInst>(GetUnderlyingObject(MTI->getSource(), DL, 0)))
+          return false;
+    } else if (auto *Call = dyn_cast<CallBase>(&I)) {
+      if (!addCall(*Call, Summary))
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+char GlobalArraySectionStorage::ID = 0;
+INITIALIZE_PASS_BEGIN(GlobalArraySectionStorage, "global-array-section-is",
+  "Summary Of Array Sections (Immutable Storage)", true, true)
+INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionWrapper)
+INITIALIZE_PASS_END(GlobalArraySectionStorage, "global-array-section-is",
+  "Summary Of Array Sections (Immutable Storage)", true, true)
+
+template<> char GlobalArraySectionWrapper::ID = 0;
+INITIALIZE_PASS(GlobalArraySectionWrapper, "global-array-section-iw",
+  "Summary Of Array Sections (Immutable Wrapper)", true, true)
+
+INITIALIZE_PROVIDER_BEGIN(GlobalArraySectionProvider,
+                          "global-array-section-provider",
+                          "Summary Of Array Sections (Provider)")
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PROVIDER_END(GlobalArraySectionProvider,
+                        "global-array-section-provider",
+                        "Summary Of Array Sections (Provider)")
+
+char GlobalArraySection::ID = 0;
+INITIALIZE_PASS_BEGIN(GlobalArraySection, "global-array-section",
+                      "Summary Of Array Sections", true, true)
+INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
+INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionProvider)
+INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionWrapper)
+INITIALIZE_PASS_DEPENDENCY(IRChangeTrackerWrapper)
+INITIALIZE_PASS_END(GlobalArraySection, "global-array-section",
+                    "Summary Of Array Sections", true, true)
+
+void GlobalArraySection::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<GlobalArraySectionProvider>();
+  AU.addRequired<GlobalArraySectionWrapper>();
+  AU.addRequired<CallGraphWrapperPass>();
+  AU.addRequired<GlobalOptionsImmutableWrapper>();
+  AU.addRequired<IRChangeTrackerWrapper>();
+  AU.setPreservesAll();
+}
+
+ModulePass *llvm::createGlobalArraySectionPass() {
+  return new GlobalArraySection;
+}
+
+ImmutablePass *llvm::createGlobalArraySectionStorage() {
+  return new GlobalArraySectionStorage;
+}
+
+bool GlobalArraySection::runOnModule(Module &M) {
+  auto &Wrapper = getAnalysis<GlobalArraySectionWrapper>();
+  if (!Wrapper)
+    return false;
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
+  auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  // A summary depends on summaries of callees only, so summaries of functions
+  // which do not (transitively) call changed functions remain valid.
+  auto &Tracker = getAnalysis<IRChangeTrackerWrapper>();
+  bool IsIncremental = Tracker && Tracker->hasSnapshot() && !Wrapper->empty();
+  OutdatedFunctionSet Outdated;
+  if (IsIncremental) {
+    Outdated = findOutdatedFunctions(*Tracker, CG, false);
+    eraseOutdatedResults(M, Outdated, *Wrapper);
+  } else {
+    Wrapper->clear();
+    // Results which depend on this analysis should be also recomputed.
+    if (Tracker)
+      Tracker->clear();
+  }
+  for (scc_iterator<CallGraph *> SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
+    // Functions from the same SCC call each other, so summaries of callees
+    // are not available. Note, that a summary is not built for a function
+    // which calls itself because there is no summary of a callee.
+    if (SCC->size() > 1)
+      continue;
+    auto *F = (*SCC->begin())->getFunction();
+    if (!F || F->isDeclaration() || F->isVarArg())
+      continue;
+    if (IsIncremental && !Outdated.count(F)) {
+      if (Wrapper->count(F))
+        ++NumReusedSummary;
+      continue;
+    }
+    TraceScope Scope("GlobalArraySection", F->getName());
+    auto &SE = getAnalysis<GlobalArraySectionProvider>(*F)
+                   .get<ScalarEvolutionWrapperPass>()
+                   .getSE();
+    ArraySectionSummary Summary;
+    if (!SummaryBuilder(*F, SE, *Wrapper, GO.IsSafeTypeCast).build(Summary)) {
+      LLVM_DEBUG(dbgs() << "[ARRAY SECTION]: unable to summarize "
+                        << F->getName() << "\n");
+      continue;
+    }
+    LLVM_DEBUG(
+      dbgs() << "[ARRAY SECTION]: summary for " << F->getName() << "\n";
+      for (auto &S : Summary) {
+        auto print = [](const ArraySectionBound &B) {
+          dbgs() << B.getConstant();
+          for (auto &T : B.terms())
+            dbgs() << " + " << T.Coef << " * %" << T.ArgNo;
+        };
+        dbgs() << "  %" << S.ArgNo << " [";
+        print(S.Lower);
+        dbgs() << ", ";
+        print(S.Upper);
+        dbgs() << ")" << (S.IsRead ? " read" : "")
+               << (S.IsWrite ? " write" : "") << "\n";
+      });
+    ++NumSummarizedFunc;
+    Wrapper->try_emplace(F, std::move(Summary));
+  }
+  return false;
+}
@@ -22,17 +22,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Attributes.h"
+#include "tsar/Analysis/IRChangeTracker.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/Passes.h"
 #include "tsar/Support/PassProvider.h"
+#include "tsar/Support/TraceProfiler.h"
 #include <bcl/utility.h>
 #include <llvm/ADT/SCCIterator.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Analysis/CallGraph.h>
 #include <llvm/Analysis/CallGraphSCCPass.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/Function.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/IR/Dominators.h>
 
@@ -42,6 +46,19 @@
 using namespace llvm;
 using namespace tsar;
 
+STATISTIC(NumReusedDefUse, "Number of reused interprocedural def-use sets");
+STATISTIC(NumRecursiveFunc, "Number of analyzed recursive functions");
+STATISTIC(NumRecursionIterations,
+  "Number of additional iterations over recursive functions");
+STATISTIC(NumUnstableRecursion,
+  "Number of recursive components with unstable def-use sets");
+
+static cl::opt<unsigned> RecursionLimit("def-mem-recursion-limit",
+  cl::init(8), cl::Hidden, cl::ZeroOrMore,
+  cl::desc("Maximum number of iterations over strongly connected component "
+           "of a call graph in interprocedural reach definition analysis "
+           "(default 8)"));
+
 namespace {
 class GlobalDefinedMemory : public ModulePass, private bcl::Uncopyable {
 public:
@@ -119,6 +136,7 @@ INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryProvider)
 INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
+INITIALIZE_PASS_DEPENDENCY(IRChangeTrackerWrapper)
 INITIALIZE_PASS_END(GlobalDefinedMemory, "global-def-mem",
                     "Global Defined Memory Analysis", true, true)
 
@@ -127,6 +145,7 @@ void GlobalDefinedMemory::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<GlobalDefinedMemoryWrapper>();
   AU.addRequired<CallGraphWrapperPass>();
   AU.addRequired<TargetLibraryInfoWrapperPass>();
+  AU.addRequired<IRChangeTrackerWrapper>();
   AU.setPreservesAll();
 }
 
@@ -142,25 +161,32 @@ bool GlobalDefinedMemory::runOnModule(Module &SCC) {
   auto &Wrapper = getAnalysis<GlobalDefinedMemoryWrapper>();
   if (!Wrapper)
     return false;
-  Wrapper->clear();
   auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
-  for (scc_iterator<CallGraph *> SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
-    /// TODO (kaniandr@gmail.com): implement analysis in case of recursion.
-    if (SCC->size() > 1)
-      continue;
-    CallGraphNode *CGN = *SCC->begin();
-    auto F = CGN->getFunction();
-    // Indirect calls or calls to functions without body may lead to implicit
-    // recursion. So, disable analysis in this case.
-    // TODO (kaniandr@gmail.com): sapfor.direct-user-callee is not set for
-    // library functions, may be analysis of these functions is a special case
-    // and these functions should be pre-analyzed.
-    if (!F || F->empty() || !hasFnAttr(*F, AttrKind::DirectUserCallee))
-      continue;
-    LLVM_DEBUG(dbgs() << "[GLOBAL DEFINED MEMORY]: analyze " << F->getName()
+  // Def-use set of a function depends on def-use sets of its callees, so
+  // results for unchanged functions which do not (transitively) call changed
+  // functions remain valid.
+  auto &Tracker = getAnalysis<IRChangeTrackerWrapper>();
+  bool IsIncremental = Tracker && Tracker->hasSnapshot() && !Wrapper->empty();
+  OutdatedFunctionSet Outdated;
+  if (IsIncremental) {
+    Outdated = findOutdatedFunctions(*Tracker, CG, false);
+    eraseOutdatedResults(SCC, Outdated, *Wrapper);
+  } else {
+    Wrapper->clear();
+    // Results which depend on this analysis should be also recomputed.
+    if (Tracker)
+      Tracker->clear();
+  }
+  FunctionPassProviderCache<GlobalDefinedMemoryProvider> Providers(
+      *this, IRChangeInfo::fingerprint);
+  // Compute def-use set of a function and return true if it differs from
+  // the set which has been already computed.
+  auto analyzeFunction = [this, &Wrapper, &Providers](Function &F) {
+    LLVM_DEBUG(dbgs() << "[GLOBAL DEFINED MEMORY]: analyze " << F.getName()
                       << "\n";);
-    auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(*F);
-    auto &Provider = getAnalysis<GlobalDefinedMemoryProvider>(*F);
+    TraceScope Scope("GlobalDefinedMemory", F.getName());
+    auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
+    auto &Provider = Providers.get(F);
     auto &RegInfo = Provider.get<DFRegionInfoPass>().getRegionInfo();
     auto &AT = Provider.get<EstimateMemoryPass>().getAliasTree();
     const auto &DT = Provider.get<DominatorTreeWrapperPass>().getDomTree();
@@ -171,7 +197,55 @@ bool GlobalDefinedMemory::runOnModule(Module &SCC) {
     auto DefUseSetItr = ReachDefFwk.getDefInfo().find(DFF);
     assert(DefUseSetItr != ReachDefFwk.getDefInfo().end() &&
            "Def-use set must exist for a function!");
-    Wrapper->try_emplace(F, std::move(DefUseSetItr->get<DefUseSet>()));
+    auto &DefUse = DefUseSetItr->get<DefUseSet>();
+    auto Info = Wrapper->try_emplace(&F);
+    if (!Info.second && *Info.first->get<DefUseSet>() == *DefUse)
+      return false;
+    Info.first->get<DefUseSet>() = std::move(DefUse);
+    return true;
+  };
+  for (scc_iterator<CallGraph *> SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
+    SmallVector<Function *, 4> Functions;
+    for (auto *CGN : *SCC) {
+      auto F = CGN->getFunction();
+      // Indirect calls or calls to functions without body may lead to
+      // implicit recursion. So, disable analysis in this case.
+      // TODO (kaniandr@gmail.com): sapfor.direct-user-callee is not set for
+      // library functions, may be analysis of these functions is a special
+      // case and these functions should be pre-analyzed.
+      if (!F || F->empty() || !hasFnAttr(*F, AttrKind::DirectUserCallee))
+        continue;
+      // Note, that all functions from a strongly connected component are
+      // outdated if at least one of them is outdated.
+      if (IsIncremental && !Outdated.count(F)) {
+        if (Wrapper->count(F))
+          ++NumReusedDefUse;
+        continue;
+      }
+      Functions.push_back(F);
+    }
+    if (Functions.empty())
+      continue;
+    // Calls to functions from the same SCC are analyzed conservatively
+    // at the first iteration because there are no summaries for them. Then
+    // summaries are refined until they are not changed. Note, that a summary
+    // obtained at any iteration is correct because it relies on correct
+    // summaries of callees, so analysis may be stopped at any iteration.
+    bool IsRecursive = SCC.hasCycle();
+    for (unsigned Iteration = 1;; ++Iteration) {
+      bool IsChanged = false;
+      for (auto *F : Functions)
+        IsChanged |= analyzeFunction(*F);
+      if (!IsRecursive || !IsChanged)
+        break;
+      if (Iteration >= RecursionLimit) {
+        ++NumUnstableRecursion;
+        break;
+      }
+      ++NumRecursionIterations;
+    }
+    if (IsRecursive)
+      NumRecursiveFunc += Functions.size();
   }
   return false;
 }
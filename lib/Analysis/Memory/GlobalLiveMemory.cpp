@@ -23,18 +23,23 @@
 //===---------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Attributes.h"
+#include "tsar/Analysis/IRChangeTracker.h"
 #include "tsar/Analysis/Memory/LiveMemory.h"
 #include "tsar/Analysis/Memory/MemoryAccessUtils.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/PassProvider.h"
+#include "tsar/Support/TraceProfiler.h"
 #include <llvm/ADT/SCCIterator.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Analysis/CallGraph.h>
 #include <llvm/Analysis/CallGraphSCCPass.h>
 #include <llvm/Analysis/ValueTracking.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/Function.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
 #ifdef LLVM_DEBUG
 #include <llvm/IR/Dominators.h>
@@ -47,6 +52,19 @@
 using namespace llvm;
 using namespace tsar;
 
+STATISTIC(NumReusedLiveSet, "Number of reused interprocedural live sets");
+STATISTIC(NumRecursiveFunc, "Number of analyzed recursive functions");
+STATISTIC(NumRecursionIterations,
+  "Number of additional iterations over recursive functions");
+STATISTIC(NumUnstableRecursion,
+  "Number of recursive components with conservative live sets");
+
+static cl::opt<unsigned> RecursionLimit("live-mem-recursion-limit",
+  cl::init(8), cl::Hidden, cl::ZeroOrMore,
+  cl::desc("Maximum number of iterations over strongly connected component "
+           "of a call graph in interprocedural live memory analysis "
+           "(default 8)"));
+
 namespace {
 class GlobalLiveMemory : public ModulePass, private bcl::Uncopyable {
 public:
@@ -104,6 +122,12 @@ using CallList = std::vector<
 /// a function (which is a key).
 using LiveMemoryForCalls = DenseMap<const Function *, CallList>;
 
+/// Analyzed functions from a strongly connected component of a call graph.
+struct FunctionSCC {
+  SmallVector<CallGraphNode *, 4> Nodes;
+  bool IsRecursive = false;
+};
+
 using GlobalLiveMemoryProvider = FunctionPassProvider<
   DFRegionInfoPass,
   DefinedMemoryPass,
@@ -212,6 +236,7 @@ INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(GlobalLiveMemoryWrapper)
 INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
+INITIALIZE_PASS_DEPENDENCY(IRChangeTrackerWrapper)
 INITIALIZE_PASS_END(GlobalLiveMemory, "global-live-mem",
                     "Global Live Memory Analysis", true, true)
 
@@ -222,6 +247,7 @@ void GlobalLiveMemory::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TargetLibraryInfoWrapperPass>();
   AU.addRequired<GlobalLiveMemoryWrapper>();
   AU.addRequired<GlobalOptionsImmutableWrapper>();
+  AU.addRequired<IRChangeTrackerWrapper>();
   AU.setPreservesAll();
 }
 
@@ -237,32 +263,51 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
   auto &Wrapper = getAnalysis<GlobalLiveMemoryWrapper>();
   if (!Wrapper)
     return false;
-  Wrapper->clear();
   auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
-  std::vector<CallGraphNode *> Worklist;
+  // Live memory at exit of a function depends on callers and def-use set of
+  // a function depends on callees. So, results for connected components of
+  // a call graph which contain changed functions are recomputed only.
+  auto &Tracker = getAnalysis<IRChangeTrackerWrapper>();
+  bool IsIncremental = Tracker && Tracker->hasSnapshot() && !Wrapper->empty();
+  OutdatedFunctionSet Outdated;
+  if (IsIncremental) {
+    Outdated = findOutdatedFunctions(*Tracker, CG, true);
+    eraseOutdatedResults(M, Outdated, *Wrapper);
+  } else {
+    Wrapper->clear();
+    // Results which depend on this analysis should be also recomputed.
+    if (Tracker)
+      Tracker->clear();
+  }
+  std::vector<FunctionSCC> Worklist;
   SmallPtrSet<CallGraphNode *, 32> HasExternalCalls;
   for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
-    // TODO (kaniandr@gmail.com): implement analysis in case of recursion.
-    if (I->size() > 1)
-      return false;
-    CallGraphNode *CGN = I->front();
-    auto F = CGN->getFunction();
-    if (!F && !GO.NoExternalCalls)
-      for (auto Callee : *CGN)
-        HasExternalCalls.insert(Callee.second);
-    // Avoid analysis of a library function because we must ensure that
-    // all callers will be analyzed earlier. However, in general a library
-    // function without body may call another library function.
-    if (!F || hasFnAttr(*F, AttrKind::LibFunc) ||
-        isDbgInfoIntrinsic(F->getIntrinsicID()) ||
-        isMemoryMarkerIntrinsic(F->getIntrinsicID()))
-      continue;
-    if (F->empty() || !hasFnAttr(*F, AttrKind::DirectUserCallee))
-      return false;
-    if (!checkCallsFrom(*CGN))
-      return false;
-    Worklist.push_back(CGN);
+    FunctionSCC SCC;
+    SCC.IsRecursive = I.hasCycle();
+    for (auto *CGN : *I) {
+      auto F = CGN->getFunction();
+      if (!F && !GO.NoExternalCalls)
+        for (auto Callee : *CGN)
+          HasExternalCalls.insert(Callee.second);
+      // Avoid analysis of a library function because we must ensure that
+      // all callers will be analyzed earlier. However, in general a library
+      // function without body may call another library function.
+      if (!F || hasFnAttr(*F, AttrKind::LibFunc) ||
+          isDbgInfoIntrinsic(F->getIntrinsicID()) ||
+          isMemoryMarkerIntrinsic(F->getIntrinsicID()))
+        continue;
+      if (F->empty() || !hasFnAttr(*F, AttrKind::DirectUserCallee) ||
+          !checkCallsFrom(*CGN)) {
+        Wrapper->clear();
+        if (Tracker)
+          Tracker->clear();
+        return false;
+      }
+      SCC.Nodes.push_back(CGN);
+    }
+    if (!SCC.Nodes.empty())
+      Worklist.push_back(std::move(SCC));
   }
   auto &GDM = getAnalysis<GlobalDefinedMemoryWrapper>();
   if (GDM) {
@@ -271,13 +316,21 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
   }
   auto &DL = M.getDataLayout();
   LiveMemoryForCalls LiveSetForCalls;
-  for (auto *CGN : llvm::reverse(Worklist)) {
+  FunctionPassProviderCache<GlobalLiveMemoryProvider> Providers(
+      *this, IRChangeInfo::fingerprint);
+  // Locations which are live after exit from functions at the previous
+  // iteration over a strongly connected component of a call graph.
+  DenseMap<Function *, DataFlowTraits<LiveDFFwk *>::ValueType> Boundaries;
+  // Compute live memory for a function and return true if boundary conditions
+  // (locations which are live after exit) have been changed.
+  auto analyzeFunction = [this, &Wrapper, &DL, &LiveSetForCalls,
+                          &HasExternalCalls, &Providers,
+                          &Boundaries](CallGraphNode *CGN) {
     auto F = CGN->getFunction();
-    if (!F || F->empty())
-      continue;
     LLVM_DEBUG(dbgs() << "[GLOBAL LIVE MEMORY]: analyze " << F->getName()
                       << "\n";);
-    auto &Provider = getAnalysis<GlobalLiveMemoryProvider>(*F);
+    TraceScope Scope("GlobalLiveMemory", F->getName());
+    auto &Provider = Providers.get(*F);
     auto &RegInfo = Provider.get<DFRegionInfoPass>().getRegionInfo();
     auto *TopRegion = cast<DFFunction>(RegInfo.getTopLevelRegion());
     auto &DefInfo = Provider.get<DefinedMemoryPass>().getDefInfo();
@@ -300,6 +353,10 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
         if (!isa<AllocaInst>(GetUnderlyingObject(Loc.Ptr, DL, 0)))
           MayLives.insert(Loc);
     }
+    auto Boundary = Boundaries.try_emplace(F, MayLives);
+    bool IsChanged = Boundary.second || Boundary.first->second != MayLives;
+    if (!Boundary.second)
+      Boundary.first->second = MayLives;
     LiveMemoryInfo IntraLiveInfo;
     auto LiveItr =
       IntraLiveInfo.try_emplace(TopRegion, std::make_unique<LiveSet>()).first;
@@ -308,6 +365,16 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
     LiveDFFwk LiveFwk(IntraLiveInfo, DefInfo, DT);
     solveDataFlowDownward(&LiveFwk, TopRegion);
     auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(*F);
+    // Forget results for calls from this function which have been computed
+    // at the previous iteration.
+    for (auto &CallRecord : *CGN)
+      if (auto *Callee = CallRecord.second->getFunction()) {
+        auto FuncInfo = LiveSetForCalls.find(Callee);
+        if (FuncInfo != LiveSetForCalls.end())
+          llvm::erase_if(FuncInfo->second, [F](CallList::value_type &Call) {
+            return Call.get<Instruction>()->getFunction() == F;
+          });
+      }
     for (auto &CallRecord : *CGN) {
       Function *Callee = CallRecord.second->getFunction();
       if (!CallRecord.first || !Callee)
@@ -334,7 +401,45 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
           },
           [](Instruction &, AccessInfo, AccessInfo) {});
     }
-    Wrapper->try_emplace(F, std::move(IntraLiveInfo[TopRegion]));
+    Wrapper->try_emplace(F).first->get<LiveSet>() =
+        std::move(IntraLiveInfo[TopRegion]);
+    return IsChanged;
+  };
+  for (auto &SCC : llvm::reverse(Worklist)) {
+    // Note, that all functions from a connected component of a call graph
+    // are outdated if at least one of them is outdated.
+    if (IsIncremental && !Outdated.count(SCC.Nodes.front()->getFunction())) {
+      for (auto *CGN : SCC.Nodes)
+        if (Wrapper->count(CGN->getFunction()))
+          ++NumReusedLiveSet;
+      continue;
+    }
+    // Calls from functions of the same SCC are not taken into account at the
+    // first iteration, so the obtained sets of live locations may be too
+    // small. Iterations are repeated until live locations after exit from
+    // each function are not changed. Note, that these sets can only grow
+    // and they are bounded by def-use sets of functions. If the limit of
+    // iterations is exceeded conservative boundary conditions are used.
+    for (unsigned Iteration = 1;; ++Iteration) {
+      bool IsChanged = false;
+      for (auto *CGN : SCC.Nodes)
+        IsChanged |= analyzeFunction(CGN);
+      if (!SCC.IsRecursive || !IsChanged)
+        break;
+      if (Iteration >= RecursionLimit) {
+        LLVM_DEBUG(dbgs() << "[GLOBAL LIVE MEMORY]: recursion limit is "
+                             "exceeded, use conservative boundary "
+                             "conditions\n");
+        ++NumUnstableRecursion;
+        HasExternalCalls.insert(SCC.Nodes.begin(), SCC.Nodes.end());
+        for (auto *CGN : SCC.Nodes)
+          analyzeFunction(CGN);
+        break;
+      }
+      ++NumRecursionIterations;
+    }
+    if (SCC.IsRecursive)
+      NumRecursiveFunc += SCC.Nodes.size();
   }
   LLVM_DEBUG(visitedFunctionsLog(LiveSetForCalls));
   return false;
@@ -45,6 +45,7 @@ void llvm::initializeMemoryAnalysis(PassRegistry &Registry) {
   initializeDelinearizationPassPass(Registry);
   initializeGlobalDefinedMemoryPass(Registry);
   initializeGlobalLiveMemoryPass(Registry);
+  initializeGlobalArraySectionPass(Registry);
   initializeDIArrayAccessWrapperPass(Registry);
   initializeAllocasAAWrapperPassPass(Registry);
 }
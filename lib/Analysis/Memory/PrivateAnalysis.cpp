@@ -29,8 +29,12 @@
 #include "tsar/Analysis/Attributes.h"
 #include "tsar/Analysis/DFRegionInfo.h"
 #include "tsar/Analysis/PrintUtils.h"
+#include "tsar/Analysis/Memory/AffineDependence.h"
+#include "tsar/Analysis/Memory/ArraySection.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
+#include "tsar/Analysis/Memory/Delinearization.h"
 #include "tsar/Analysis/Memory/DependenceAnalysis.h"
+#include "tsar/Analysis/Memory/DIArrayAccess.h"
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/LiveMemory.h"
 #include "tsar/Analysis/Memory/MemoryCoverage.h"
@@ -40,6 +44,7 @@
 #include "tsar/Core/Query.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/IRUtils.h"
+#include "tsar/Support/TraceProfiler.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Unparse/Utils.h"
 #include <llvm/ADT/DenseMap.h>
@@ -49,6 +54,7 @@
 #include <llvm/ADT/STLExtras.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
 #include <llvm/Analysis/ValueTracking.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/Dominators.h>
@@ -57,9 +63,11 @@
 #include "llvm/IR/InstIterator.h"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Operator.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/Debug.h>
 #include <bcl/utility.h>
+#include <chrono>
 
 using namespace llvm;
 using namespace tsar;
@@ -70,6 +78,24 @@ using bcl::operator "" _b;
 #define DEBUG_TYPE "private"
 
 MEMORY_TRAIT_STATISTIC(NumTraits)
+STATISTIC(NumTestedPairs, "Number of tested pairs of loads and stores");
+STATISTIC(NumPrunedPairs,
+  "Number of pairs of loads and stores pruned due to alias tree");
+STATISTIC(NumTestMicroseconds,
+  "Time (in microseconds) spent to test pairs of loads and stores");
+STATISTIC(NumSavedMicroseconds,
+  "Estimated time (in microseconds) saved due to pruned pairs");
+STATISTIC(NumAffineTestedPairs,
+  "Number of pairs of loads and stores checked with exact affine test");
+STATISTIC(NumAffineIndependentPairs,
+  "Number of pairs of loads and stores proved independent with affine test");
+STATISTIC(NumSectionIndependentPairs,
+  "Number of pairs of array sections proved independent at calls");
+
+static cl::opt<unsigned> AffineTestBudget("affine-dependence-budget",
+  cl::init(256), cl::Hidden, cl::ZeroOrMore,
+  cl::desc("Maximum number of constraints produced by exact dependence test "
+           "for affine subscripts (default 256)"));
 
 char PrivateRecognitionPass::ID = 0;
 INITIALIZE_PASS_IN_GROUP_BEGIN(PrivateRecognitionPass, "private",
@@ -82,8 +108,11 @@ INITIALIZE_PASS_DEPENDENCY(DefinedMemoryPass)
 INITIALIZE_PASS_DEPENDENCY(LiveMemoryPass)
 INITIALIZE_PASS_DEPENDENCY(EstimateMemoryPass)
 INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DelinearizationPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
+INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionWrapper)
 INITIALIZE_PASS_IN_GROUP_END(PrivateRecognitionPass, "private",
   "Private Variable Analysis", false, true,
   DefaultQueryManager::PrintPassGroup::getPassRegistry())
@@ -97,6 +126,9 @@ struct DependenceCache {
     std::pair<std::unique_ptr<Dependence>, unsigned short>;
   using CacheT = DenseMap<SrcDstPair, DependenceConfusedPair>;
   CacheT Impl;
+  /// Results of exact test for affine subscripts, `None` if the test
+  /// is not applicable.
+  DenseMap<SrcDstPair, Optional<AffineDependence>> AffineImpl;
 };
 }
 }
@@ -120,6 +152,12 @@ bool PrivateRecognitionPass::runOnFunction(Function &F) {
   mDL = &F.getParent()->getDataLayout();
   mTLI = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
   mSE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  mLI = &LpInfo;
+  mDelinInfo = &getAnalysis<DelinearizationPass>().getDelinearizeInfo();
+  mGlobalOpts = &GlobalOpts;
+  auto &ArraySections = getAnalysis<GlobalArraySectionWrapper>();
+  if (ArraySections)
+    mArraySections = &ArraySections.get();
   auto *DFF = cast<DFFunction>(RegionInfo.getTopLevelRegion());
   GraphNumbering<const AliasNode *> Numbers;
   numberGraph(mAliasTree, &Numbers);
@@ -507,6 +545,8 @@ void PrivateRecognitionPass::resolveCandidats(
     const AliasTreeRelation &AliasSTR, DFRegion *R, DependenceCache &Cache) {
   assert(R && "Region must not be null!");
   if (auto *L = dyn_cast<DFLoop>(R)) {
+    TraceScope Scope("PrivateRecognition",
+                     [L]() { return getTraceDetail(*L->getLoop()); });
     LLVM_DEBUG(dbgs() << "[PRIVATE]: analyze loop ";
       L->getLoop()->print(dbgs());
       if (DebugLoc DbgLoc = L->getLoop()->getStartLoc()) {
@@ -530,7 +570,7 @@ void PrivateRecognitionPass::resolveCandidats(
       NodeTraits.insert(
         std::make_pair(&N, std::make_tuple(TraitList(), UnknownList())));
     DependenceMap Deps;
-    collectDependencies(L->getLoop(), Deps, Cache);
+    collectDependencies(L->getLoop(), AliasSTR, Deps, Cache);
     resolveAccesses(L->getLoop(), R->getLatchNode(), R->getExitNode(),
       *DefItr->get<DefUseSet>(), *LiveItr->get<LiveSet>(), Deps, AliasSTR,
       ExplicitAccesses, ExplicitUnknowns, NodeTraits);
@@ -614,128 +654,534 @@ void PrivateRecognitionPass::insertDependence(const Dependence &Dep,
                    Deps);
 }
 
-void PrivateRecognitionPass::collectDependencies(Loop *L, DependenceMap &Deps,
+Optional<AffineDependence> PrivateRecognitionPass::checkAffineDependence(
+    Instruction &Src, const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, DependenceCache &Cache) {
+  auto CacheItr = Cache.AffineImpl.find(std::make_pair(&Src, &Dst));
+  if (CacheItr != Cache.AffineImpl.end())
+    return CacheItr->second;
+  auto &Result = Cache.AffineImpl[std::make_pair(&Src, &Dst)];
+  if (!SrcLoc.Size.hasValue() || SrcLoc.Size != DstLoc.Size ||
+      SrcLoc.Ptr->getType() != DstLoc.Ptr->getType())
+    return Result;
+  auto SrcInfo = mDelinInfo->findRange(SrcLoc.Ptr);
+  auto DstInfo = mDelinInfo->findRange(DstLoc.Ptr);
+  if (!SrcInfo.first || SrcInfo.first != DstInfo.first ||
+      !SrcInfo.first->isDelinearized())
+    return Result;
+  auto *A = SrcInfo.first;
+  for (auto *R : {SrcInfo.second, DstInfo.second})
+    if (!R->isValid() || !R->isElement() ||
+        R->Subscripts.size() != A->getNumberOfDims())
+      return Result;
+  // Accesses must not cover more than a single element, otherwise accesses
+  // to different elements may overlap.
+  auto *ElementTy =
+      cast<PointerType>(SrcInfo.second->Ptr->getType())->getElementType();
+  if (!ElementTy->isSized() ||
+      SrcLoc.Size.getValue() > mDL->getTypeStoreSize(ElementTy))
+    return Result;
+  // Collect loops which contain accesses, all loops must have identifiers.
+  DenseMap<DIArrayAccess::Scope, const Loop *> IDToLoop;
+  auto collectLoops = [&IDToLoop](const Loop *L,
+                                  SmallVectorImpl<const Loop *> &Nest) {
+    for (; L; L = L->getParentLoop()) {
+      auto *ID = L->getLoopID();
+      if (!ID)
+        return false;
+      IDToLoop.try_emplace(ID, L);
+      Nest.push_back(L);
+    }
+    return true;
+  };
+  SmallVector<const Loop *, 4> SrcNest, DstNest;
+  if (!collectLoops(mLI->getLoopFor(Src.getParent()), SrcNest) ||
+      !collectLoops(mLI->getLoopFor(Dst.getParent()), DstNest))
+    return Result;
+  auto MaxIteration = [this, &IDToLoop](DIArrayAccess::Scope ID) {
+    auto Itr = IDToLoop.find(ID);
+    if (Itr == IDToLoop.end())
+      return Optional<int64_t>();
+    auto TripCount = mSE->getSmallConstantMaxTripCount(Itr->second);
+    return TripCount > 0 ? Optional<int64_t>(TripCount - 1) : None;
+  };
+  auto buildAccess = [this, A, &IDToLoop, &MaxIteration](
+                         const Array::Range &R, ArrayRef<const Loop *> Nest,
+                         DIArrayAccess &Access) {
+    for (unsigned DimIdx = 0, DimIdxE = R.Subscripts.size(); DimIdx < DimIdxE;
+         ++DimIdx) {
+      auto *S = buildAffineSubscript(Access, DimIdx, R.Subscripts[DimIdx], *mSE,
+                                     mGlobalOpts->IsSafeTypeCast);
+      if (!S || S->getConstant().getMinSignedBits() > 63)
+        return false;
+      // Each loop in a subscript must contain the access, otherwise
+      // the subscript depends on the last iteration of the loop.
+      for (unsigned I = 0, EI = S->getNumberOfMonoms(); I < EI; ++I) {
+        auto Itr = IDToLoop.find(S->getMonom(I).Column);
+        if (Itr == IDToLoop.end() || !is_contained(Nest, Itr->second))
+          return false;
+      }
+      // Subscripts in all dimensions except the first one must be in bounds,
+      // otherwise different subscripts may refer to the same element.
+      if (DimIdx == 0 || mGlobalOpts->InBoundsSubscripts)
+        continue;
+      auto *Size = dyn_cast<SCEVConstant>(A->getDimSize(DimIdx));
+      if (!Size)
+        return false;
+      int64_t Min = S->getConstant().getSExtValue(), Max = Min;
+      for (unsigned I = 0, EI = S->getNumberOfMonoms(); I < EI; ++I) {
+        auto M = S->getMonom(I);
+        auto MaxItr = MaxIteration(M.Column);
+        if (!MaxItr || M.Value.getMinSignedBits() > 63)
+          return false;
+        int64_t Bound;
+        if (MulOverflow(M.Value.getSExtValue(), *MaxItr, Bound))
+          return false;
+        auto &MinMax = Bound < 0 ? Min : Max;
+        if (AddOverflow(MinMax, Bound, MinMax))
+          return false;
+      }
+      if (Min < 0 || Size->getAPInt().sle(Max))
+        return false;
+    }
+    return true;
+  };
+  DIArrayAccess SrcAccess(nullptr, nullptr, SrcInfo.second->Subscripts.size(),
+                          AccessInfo::May, AccessInfo::May);
+  DIArrayAccess DstAccess(nullptr, nullptr, DstInfo.second->Subscripts.size(),
+                          AccessInfo::May, AccessInfo::May);
+  if (!buildAccess(*SrcInfo.second, SrcNest, SrcAccess) ||
+      !buildAccess(*DstInfo.second, DstNest, DstAccess))
+    return Result;
+  // Common loops from the outermost one, so the position of a loop in this
+  // list is equal to its depth minus 1.
+  SmallVector<DIArrayAccess::Scope, 4> CommonLoops;
+  for (auto *L : reverse(SrcNest))
+    if (is_contained(DstNest, L))
+      CommonLoops.push_back(L->getLoopID());
+  ++NumAffineTestedPairs;
+  Result = testAffineDependence(SrcAccess, DstAccess, CommonLoops, MaxIteration,
+                                AffineTestBudget);
+  if (Result && Result->IsExact &&
+      all_of(Result->Directions,
+             [](uint8_t Dir) { return Dir == AffineDependence::None; }))
+    ++NumAffineIndependentPairs;
+  return Result;
+}
+
+bool PrivateRecognitionPass::collectAffineDependence(Loop &L,
+    Instruction &Src, const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, DependenceMap &Deps,
     DependenceCache &Cache) {
+  auto Dep = checkAffineDependence(Src, SrcLoc, Dst, DstLoc, Cache);
+  if (!Dep)
+    return false;
+  assert(L.getLoopDepth() <= Dep->Directions.size() &&
+    "Loop must contain both accesses!");
+  auto Dir = Dep->Directions[L.getLoopDepth() - 1];
+  if (!(Dir & (AffineDependence::LT | AffineDependence::GT))) {
+    LLVM_DEBUG(dbgs() << "[PRIVATE]: affine test proves absence of "
+      "loop-carried dependence\n");
+    return true;
+  }
+  LLVM_DEBUG(dbgs() << "[PRIVATE]: affine test finds loop-carried dependence"
+    << (Dep->IsExact ? "" : " (inexact)") << "\n");
+  DependenceImp::Descriptor Dptr;
+  bool SrcWrite = Src.mayWriteToMemory(), DstWrite = Dst.mayWriteToMemory();
+  if (SrcWrite && DstWrite) {
+    Dptr.set<trait::Output>();
+  } else {
+    // A write which precedes a read in the order of iterations
+    // produces a flow dependence, otherwise it produces an anti dependence.
+    if (Dir & AffineDependence::LT)
+      SrcWrite ? Dptr.set<trait::Flow>() : Dptr.set<trait::Anti>();
+    if (Dir & AffineDependence::GT)
+      SrcWrite ? Dptr.set<trait::Anti>() : Dptr.set<trait::Flow>();
+  }
+  trait::Dependence::Flag Flag = trait::Dependence::LoadStoreCause |
+    trait::Dependence::UnknownDistance |
+    (Dep->IsExact ? trait::Dependence::No : trait::Dependence::May);
+  updateDependence(mAliasTree->find(SrcLoc), Dptr, Flag, DistanceInfo{}, Deps);
+  updateDependence(mAliasTree->find(DstLoc), Dptr, Flag, DistanceInfo{}, Deps);
+  return true;
+}
+
+void PrivateRecognitionPass::collectUnknownDependence(Instruction &Src,
+    Instruction &Dst, DependenceMap &Deps) {
+  auto &AA = mAliasTree->getAliasAnalysis();
+  trait::Dependence::Flag Flag = trait::Dependence::May |
+    trait::Dependence::UnknownDistance |
+    (!isa<CallBase>(Src) && !isa<CallBase>(Dst)
+       ? trait::Dependence::UnknownCause
+       : trait::Dependence::CallCause);
+  DependenceImp::Descriptor Dptr;
+  Dptr.set<trait::Flow, trait::Anti, trait::Output>();
+  SmallVector<Value *, 2> Causes;
+  if (isa<CallBase>(Src))
+    Causes.push_back(&Src);
+  if (isa<CallBase>(Dst))
+    Causes.push_back(&Dst);
+  auto insertUnknownDep =
+    [this, &AA, &Src, &Dst, &Dptr, Flag, &Causes, &Deps](
+      Instruction &, MemoryLocation &&Loc, unsigned,
+      AccessInfo R, AccessInfo W) {
+    if (R == AccessInfo::No && W == AccessInfo::No)
+      return;
+    if (AA.getModRefInfo(&Src, Loc) == ModRefInfo::NoModRef)
+      return;
+    if (AA.getModRefInfo(&Dst, Loc) == ModRefInfo::NoModRef)
+      return;
+    updateDependence(mAliasTree->find(Loc), Dptr, Flag, DistanceInfo{},
+                     Deps, Causes);
+  };
+  auto stab = [](Instruction &, AccessInfo, AccessInfo) {};
+  LLVM_DEBUG(dbgs() << "[PRIVATE]: conservatively assume dependence: ";
+             Src.print(dbgs()); dbgs() << "\n";
+             Dst.print(dbgs()); dbgs() << "\n");
+  for_each_memory(Src, *mTLI, insertUnknownDep, stab);
+  for_each_memory(Dst, *mTLI, insertUnknownDep, stab);
+}
+
+void PrivateRecognitionPass::collectUnknownDependence(Instruction &Src,
+    const MemoryLocation &SrcLoc, Instruction &Dst, DependenceMap &Deps) {
+  auto &AA = mAliasTree->getAliasAnalysis();
+  if (AA.getModRefInfo(&Dst, SrcLoc) == ModRefInfo::NoModRef)
+    return;
+  trait::Dependence::Flag Flag = trait::Dependence::May |
+    trait::Dependence::UnknownDistance |
+    (!isa<CallBase>(Dst) ? trait::Dependence::UnknownCause :
+      trait::Dependence::CallCause);
+  DependenceImp::Descriptor Dptr;
+  Dptr.set<trait::Flow, trait::Anti, trait::Output>();
+  LLVM_DEBUG(dbgs() << "[PRIVATE]: conservatively assume dependence: ";
+             Src.print(dbgs()); dbgs() << "\n";
+             Dst.print(dbgs()); dbgs() << "\n");
+  updateDependence(mAliasTree->find(SrcLoc), Dptr, Flag, DistanceInfo{},
+                   Deps, isa<CallBase>(Dst) ? &Dst : nullptr);
+}
+
+namespace {
+/// Range of addresses `[Lower, Upper)` accessed on an iteration of a loop.
+struct SectionAccess {
+  MemoryLocation Loc;
+  const SCEV *Lower;
+  const SCEV *Upper;
+  bool IsWrite;
+};
+
+/// Return true if specified ranges do not overlap on different iterations
+/// of a specified loop.
+bool isSectionIndependent(const Loop &L, const SectionAccess &Src,
+    const SectionAccess &Dst, unsigned MaxTripCount, ScalarEvolution &SE) {
+  // Represent an expression as `Start + Step * I` where I is an iteration.
+  auto split = [&L, &SE](const SCEV *Expr, const SCEV *&Start,
+                         const SCEV *&Step) {
+    if (auto *AddRec = dyn_cast<SCEVAddRecExpr>(Expr))
+      if (AddRec->getLoop() == &L) {
+        if (!AddRec->isAffine())
+          return false;
+        Start = AddRec->getStart();
+        Step = AddRec->getStepRecurrence(SE);
+        return true;
+      }
+    if (!SE.isLoopInvariant(Expr, &L))
+      return false;
+    Start = Expr;
+    Step = SE.getZero(SE.getEffectiveSCEVType(Expr->getType()));
+    return true;
+  };
+  const SCEV *SrcLower, *SrcUpper, *DstLower, *DstUpper;
+  const SCEV *Steps[4];
+  if (!split(Src.Lower, SrcLower, Steps[0]) ||
+      !split(Src.Upper, SrcUpper, Steps[1]) ||
+      !split(Dst.Lower, DstLower, Steps[2]) ||
+      !split(Dst.Upper, DstUpper, Steps[3]))
+    return false;
+  auto *StepC = dyn_cast<SCEVConstant>(Steps[0]);
+  if (!StepC || any_of(Steps, [StepC](const SCEV *S) { return S != StepC; }))
+    return false;
+  // Ranges overlap on iterations I and J if and only if
+  // DstLower - SrcUpper < Step * (I - J) < DstUpper - SrcLower.
+  auto *MinC = dyn_cast<SCEVConstant>(SE.getMinusSCEV(DstLower, SrcUpper));
+  auto *MaxC = dyn_cast<SCEVConstant>(SE.getMinusSCEV(DstUpper, SrcLower));
+  if (!MinC || !MaxC || MinC->getAPInt().getMinSignedBits() > 62 ||
+      MaxC->getAPInt().getMinSignedBits() > 62 ||
+      StepC->getAPInt().getMinSignedBits() > 62)
+    return false;
+  int64_t Min = MinC->getAPInt().getSExtValue();
+  int64_t Max = MaxC->getAPInt().getSExtValue();
+  int64_t Step = StepC->getAPInt().getSExtValue();
+  // Ranges are the same on each iteration.
+  if (Step == 0)
+    return Min >= 0 || Max <= 0 || MaxTripCount == 1;
+  if (Step < 0) {
+    Step = -Step;
+    std::swap(Min, Max);
+    Min = -Min;
+    Max = -Max;
+  }
+  // Find bounds of I - J, Min < Step * (I - J) < Max.
+  int64_t DistMin = Min / Step + 1 - (Min % Step != 0 && Min < 0 ? 1 : 0);
+  int64_t DistMax = Max / Step - 1 + (Max % Step != 0 && Max > 0 ? 1 : 0);
+  if (MaxTripCount > 0) {
+    DistMin = std::max<int64_t>(DistMin, 1 - (int64_t)MaxTripCount);
+    DistMax = std::min<int64_t>(DistMax, (int64_t)MaxTripCount - 1);
+  }
+  return DistMin > DistMax || (DistMin == 0 && DistMax == 0);
+}
+}
+
+bool PrivateRecognitionPass::collectSectionDependence(Loop &L,
+    Instruction &Src, Instruction &Dst, DependenceMap &Deps) {
+  if (!mArraySections)
+    return false;
+  // Accesses in inner loops are represented with ranges which cover
+  // all iterations of these loops.
+  auto IsEliminated = [&L](const Loop *Inner) { return !Inner->contains(&L); };
+  auto collectSections = [this, &IsEliminated](Instruction &I,
+      SmallVectorImpl<SectionAccess> &Sections) {
+    auto addSection = [this, &IsEliminated, &Sections](
+        const MemoryLocation &Loc, const SCEV *Lower, const SCEV *Upper,
+        bool IsWrite) {
+      Lower = getLoopBound(Lower, false, IsEliminated, *mSE,
+                           mGlobalOpts->IsSafeTypeCast);
+      Upper = getLoopBound(Upper, true, IsEliminated, *mSE,
+                           mGlobalOpts->IsSafeTypeCast);
+      if (!Lower || !Upper)
+        return false;
+      Sections.push_back({Loc, Lower, Upper, IsWrite});
+      return true;
+    };
+    if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+      auto Loc = isa<LoadInst>(I) ? MemoryLocation::get(cast<LoadInst>(&I))
+                                  : MemoryLocation::get(cast<StoreInst>(&I));
+      if (!Loc.Size.hasValue())
+        return false;
+      auto *Ty = mSE->getEffectiveSCEVType(Loc.Ptr->getType());
+      auto *Lower = mSE->getSCEV(const_cast<Value *>(Loc.Ptr));
+      auto *Upper =
+          mSE->getAddExpr(Lower, mSE->getConstant(Ty, Loc.Size.getValue()));
+      return addSection(Loc, Lower, Upper, isa<StoreInst>(I));
+    }
+    auto *Call = dyn_cast<CallBase>(&I);
+    if (!Call)
+      return false;
+    auto *Callee =
+        dyn_cast<Function>(Call->getCalledOperand()->stripPointerCasts());
+    if (!Callee)
+      return false;
+    auto SummaryItr = mArraySections->find(Callee);
+    if (SummaryItr == mArraySections->end())
+      return false;
+    for (auto &S : SummaryItr->second) {
+      if (S.ArgNo >= Call->arg_size())
+        return false;
+      auto *Ptr = Call->getArgOperand(S.ArgNo);
+      if (!Ptr->getType()->isPointerTy() || isa<UndefValue>(Ptr) ||
+          isa<ConstantPointerNull>(Ptr))
+        return false;
+      auto *Ty = mSE->getEffectiveSCEVType(Ptr->getType());
+      auto *Lower = instantiateBound(S.Lower, *Call, Ty, *mSE);
+      auto *Upper = instantiateBound(S.Upper, *Call, Ty, *mSE);
+      if (!Lower || !Upper)
+        return false;
+      auto *Base = mSE->getSCEV(Ptr);
+      if (!addSection(MemoryLocation::getForArgument(Call, S.ArgNo, *mTLI),
+                      mSE->getAddExpr(Base, Lower),
+                      mSE->getAddExpr(Base, Upper), S.IsWrite))
+        return false;
+    }
+    return true;
+  };
+  SmallVector<SectionAccess, 4> SrcSections, DstSections;
+  if (!collectSections(Src, SrcSections) || !collectSections(Dst, DstSections))
+    return false;
   auto &AA = mAliasTree->getAliasAnalysis();
-  std::vector<Instruction *> LoopInsts;
+  auto MaxTripCount = mSE->getSmallConstantMaxTripCount(&L);
+  SmallVector<Value *, 2> Causes;
+  if (isa<CallBase>(Src))
+    Causes.push_back(&Src);
+  if (isa<CallBase>(Dst) && &Src != &Dst)
+    Causes.push_back(&Dst);
+  trait::Dependence::Flag Flag = trait::Dependence::May |
+    trait::Dependence::UnknownDistance | trait::Dependence::CallCause;
+  for (auto &SrcS : SrcSections)
+    for (auto &DstS : DstSections) {
+      if (!SrcS.IsWrite && !DstS.IsWrite)
+        continue;
+      if (AA.alias(SrcS.Loc, DstS.Loc) == NoAlias)
+        continue;
+      if (isSectionIndependent(L, SrcS, DstS, MaxTripCount, *mSE)) {
+        ++NumSectionIndependentPairs;
+        continue;
+      }
+      LLVM_DEBUG(dbgs() << "[PRIVATE]: array sections may overlap: ";
+                 Src.print(dbgs()); dbgs() << "\n";
+                 Dst.print(dbgs()); dbgs() << "\n");
+      DependenceImp::Descriptor Dptr;
+      Dptr.set<trait::Flow, trait::Anti, trait::Output>();
+      updateDependence(mAliasTree->find(SrcS.Loc), Dptr, Flag,
+                       DistanceInfo{}, Deps, Causes);
+      updateDependence(mAliasTree->find(DstS.Loc), Dptr, Flag,
+                       DistanceInfo{}, Deps, Causes);
+    }
+  return true;
+}
+
+void PrivateRecognitionPass::collectLoadStoreDependence(Loop &L,
+    Instruction &Src, const MemoryLocation &SrcLoc, Instruction &Dst,
+    const MemoryLocation &DstLoc, DependenceMap &Deps,
+    DependenceCache &Cache) {
+  if (!Src.mayWriteToMemory() && !Dst.mayWriteToMemory()) {
+    LLVM_DEBUG(dbgs() << "[PRIVATE]: ignore input dependence\n");
+    return;
+  }
+  auto CacheItr = Cache.Impl.find(std::make_pair(&Src, &Dst));
+  unsigned short ConfusedLevels;
+  Dependence *Dep = nullptr;
+  if (CacheItr != Cache.Impl.end()) {
+    Dep = CacheItr->second.first.get();
+    ConfusedLevels = CacheItr->second.second;
+  } else {
+    auto D = mDepInfo->depends(&Src, &Dst, true, &ConfusedLevels);
+    Dep = D.get();
+    Cache.Impl.try_emplace(std::make_pair(&Src, &Dst),
+      std::move(D), ConfusedLevels);
+  }
+  auto LoopDepth = L.getLoopDepth();
+  if (((Dep && (Dep->isConfused() ||
+                Dep->getConfusedLevels() >= LoopDepth)) ||
+       (!Dep && LoopDepth <= ConfusedLevels)) &&
+      collectAffineDependence(L, Src, SrcLoc, Dst, DstLoc, Deps, Cache))
+    return;
+  if (Dep) {
+    LLVM_DEBUG(
+      dbgs() << "[PRIVATE]: dependence found: ";
+      Dep->dump(dbgs());
+      Src.print(dbgs()); dbgs() << "\n";
+      Dst.print(dbgs()); dbgs() << "\n";
+    );
+    // Do not use Dependence::isLoopIndependent() to check loop
+    // independent dependencies. This method returns `may` instead of
+    // `must`. This means that if it returns `true` than dependency
+    // may be loop-carried or may arise inside a single iteration.
+    insertDependence(*Dep, SrcLoc, DstLoc, trait::Dependence::No, L, Deps);
+  } else if (L.getLoopDepth() <= ConfusedLevels) {
+    LLVM_DEBUG(dbgs() << "[PRIVATE]: assume confused dependence"
+      " (confused levels " << ConfusedLevels << ")\n");
+    DependenceImp::Descriptor Dptr;
+    Dptr.set<trait::Flow, trait::Anti, trait::Output>();
+    trait::Dependence::Flag Flag = trait::Dependence::ConfusedCause |
+      trait::Dependence::LoadStoreCause | trait::Dependence::May;
+    updateDependence(mAliasTree->find(SrcLoc), Dptr, Flag, DistanceInfo{},
+                     Deps);
+    updateDependence(mAliasTree->find(DstLoc), Dptr, Flag, DistanceInfo{},
+                     Deps);
+  }
+}
+
+void PrivateRecognitionPass::collectDependencies(Loop *L,
+    const AliasTreeRelation &AliasSTR, DependenceMap &Deps,
+    DependenceCache &Cache) {
+  // List of instructions which access memory (in order of their appearance
+  // in the loop). For loads and stores the accessed location and the alias
+  // node which contains this location are also remembered.
+  struct MemoryAccess {
+    Instruction *Inst;
+    MemoryLocation Loc;
+    const AliasNode *Node;
+  };
+  std::vector<MemoryAccess> LoopAccesses;
+  SmallVector<unsigned, 8> UnknownAccesses;
+  bool HasUngroupedAccess = false;
   for (auto *BB : L->getBlocks())
-    for (auto &I : *BB)
-      LoopInsts.push_back(&I);
-  for (auto SrcItr = LoopInsts.begin(), EndItr = LoopInsts.end();
-       SrcItr != EndItr; ++SrcItr) {
-    if (!(**SrcItr).mayReadOrWriteMemory())
-      continue;
-    auto Src = getLoadOrStoreLocation(*SrcItr);
-    if (!Src.Ptr) {
-      if (auto II = dyn_cast<IntrinsicInst>(*SrcItr))
-        if (isMemoryMarkerIntrinsic(II->getIntrinsicID()))
-          continue;
-      for (auto DstItr = SrcItr; DstItr != EndItr; ++DstItr) {
-        if (!(**DstItr).mayReadOrWriteMemory())
-          continue;
-        if (auto II = dyn_cast<IntrinsicInst>(*DstItr))
+    for (auto &I : *BB) {
+      if (!I.mayReadOrWriteMemory())
+        continue;
+      auto Loc = getLoadOrStoreLocation(&I);
+      if (!Loc.Ptr) {
+        if (auto II = dyn_cast<IntrinsicInst>(&I))
           if (isMemoryMarkerIntrinsic(II->getIntrinsicID()))
             continue;
-        trait::Dependence::Flag Flag = trait::Dependence::May |
-          trait::Dependence::UnknownDistance |
-          (!isa<CallBase>(*SrcItr) && !isa<CallBase>(*DstItr)
-             ? trait::Dependence::UnknownCause
-             : trait::Dependence::CallCause);
-        DependenceImp::Descriptor Dptr;
-        Dptr.set<trait::Flow, trait::Anti, trait::Output>();
-        SmallVector<Value *, 2> Causes;
-        if (isa<CallBase>(*SrcItr))
-          Causes.push_back(*SrcItr);
-        if (isa<CallBase>(*DstItr))
-          Causes.push_back(*DstItr);
-        auto insertUnknownDep =
-          [this, &AA, &SrcItr, &DstItr, &Dptr, Flag, &Causes, &Deps](
-            Instruction &, MemoryLocation &&Loc, unsigned,
-            AccessInfo R, AccessInfo W) {
-          if (R == AccessInfo::No && W == AccessInfo::No)
-            return;
-          if (AA.getModRefInfo(*SrcItr, Loc) == ModRefInfo::NoModRef)
-            return;
-          if (AA.getModRefInfo(*DstItr, Loc) == ModRefInfo::NoModRef)
-            return;
-          updateDependence(mAliasTree->find(Loc), Dptr, Flag, DistanceInfo{},
-                           Deps, Causes);
-        };
-        auto stab = [](Instruction &, AccessInfo, AccessInfo) {};
-        LLVM_DEBUG(dbgs() << "[PRIVATE]: conservatively assume dependence: ";
-                   (**SrcItr).print(dbgs()); dbgs() << "\n";
-                   (**DstItr).print(dbgs()); dbgs() << "\n");
-        for_each_memory(**SrcItr, *mTLI, insertUnknownDep, stab);
-        for_each_memory(**DstItr, *mTLI, insertUnknownDep, stab);
+        UnknownAccesses.push_back(LoopAccesses.size());
+        LoopAccesses.push_back({ &I, Loc, nullptr });
+      } else {
+        auto *EM = mAliasTree->find(Loc);
+        // If a location is missed in the alias tree it is not known which
+        // accesses may alias it, so pairs in this loop are not pruned.
+        if (!EM)
+          HasUngroupedAccess = true;
+        LoopAccesses.push_back(
+            {&I, Loc, EM ? EM->getAliasNode(*mAliasTree) : nullptr});
       }
-    } else {
+    }
+  // Pairs which contain at least one access to unknown memory can not be
+  // pruned, so check all of them.
+  for (auto UnknownIdx : UnknownAccesses) {
+    auto &Unknown = LoopAccesses[UnknownIdx];
+    for (unsigned Idx = 0; Idx < UnknownIdx; ++Idx)
+      if (LoopAccesses[Idx].Loc.Ptr &&
+          !collectSectionDependence(*L, *LoopAccesses[Idx].Inst,
+                                    *Unknown.Inst, Deps))
+        collectUnknownDependence(*LoopAccesses[Idx].Inst,
+          LoopAccesses[Idx].Loc, *Unknown.Inst, Deps);
+    for (unsigned Idx = UnknownIdx, EIdx = LoopAccesses.size(); Idx < EIdx;
+         ++Idx)
+      if (!collectSectionDependence(*L, *Unknown.Inst,
+                                    *LoopAccesses[Idx].Inst, Deps))
+        collectUnknownDependence(*Unknown.Inst, *LoopAccesses[Idx].Inst, Deps);
+  }
+  // Group loads and stores by top-level subtrees of the alias tree. All loads
+  // and stores are placed in a single group (with a null key) if some of them
+  // can not be grouped.
+  DenseMap<const AliasNode *, unsigned> SubtreeToGroup;
+  std::vector<SmallVector<unsigned, 8>> Groups;
+  auto *TopNode = mAliasTree->getTopLevelNode();
+  for (unsigned Idx = 0, EIdx = LoopAccesses.size(); Idx < EIdx; ++Idx) {
+    if (!LoopAccesses[Idx].Loc.Ptr)
+      continue;
+    const AliasNode *Subtree =
+        HasUngroupedAccess ? nullptr : LoopAccesses[Idx].Node;
+    if (Subtree)
+      for (auto *Parent = Subtree->getParent(*mAliasTree); Parent != TopNode;
+           Parent = Parent->getParent(*mAliasTree))
+        Subtree = Parent;
+    auto GroupItr = SubtreeToGroup.try_emplace(Subtree, Groups.size()).first;
+    if (GroupItr->second == Groups.size())
+      Groups.emplace_back();
+    Groups[GroupItr->second].push_back(Idx);
+  }
+  uint64_t NumberOfLoadStores = LoopAccesses.size() - UnknownAccesses.size();
+  uint64_t NumberOfPairs = NumberOfLoadStores * (NumberOfLoadStores + 1) / 2;
+  uint64_t NumberOfTested = 0;
+  auto StartTime = std::chrono::steady_clock::now();
+  for (auto &Group : Groups)
+    for (auto SrcItr = Group.begin(), EndItr = Group.end(); SrcItr != EndItr;
+         ++SrcItr) {
+      auto &Src = LoopAccesses[*SrcItr];
       for (auto DstItr = SrcItr; DstItr != EndItr; ++DstItr) {
-        auto Dst = getLoadOrStoreLocation(*DstItr);
-        if (!Dst.Ptr) {
-          if (!(**DstItr).mayReadOrWriteMemory())
-            continue;
-          if (auto II = dyn_cast<IntrinsicInst>(*DstItr))
-            if (isMemoryMarkerIntrinsic(II->getIntrinsicID()))
-              continue;
-          if (AA.getModRefInfo(*DstItr, Src) == ModRefInfo::NoModRef)
-            continue;
-          trait::Dependence::Flag Flag = trait::Dependence::May |
-            trait::Dependence::UnknownDistance |
-            (!isa<CallBase>(*DstItr) ? trait::Dependence::UnknownCause :
-              trait::Dependence::CallCause);
-          DependenceImp::Descriptor Dptr;
-          Dptr.set<trait::Flow, trait::Anti, trait::Output>();
-          LLVM_DEBUG(dbgs() << "[PRIVATE]: conservatively assume dependence: ";
-                     (**SrcItr).print(dbgs()); dbgs() << "\n";
-                     (**DstItr).print(dbgs()); dbgs() << "\n");
-          updateDependence(mAliasTree->find(Src), Dptr, Flag, DistanceInfo{},
-                           Deps, isa<CallBase>(*DstItr) ? *DstItr : nullptr);
-        } else {
-          if (!(*SrcItr)->mayWriteToMemory() &&
-              !(*DstItr)->mayWriteToMemory()) {
-            LLVM_DEBUG(dbgs() << "[PRIVATE]: ignore input dependence\n");
-            continue;
-          }
-          auto CacheItr = Cache.Impl.find(std::make_pair(*SrcItr, *DstItr));
-          unsigned short ConfusedLevels;
-          Dependence *Dep = nullptr;
-          if (CacheItr != Cache.Impl.end()) {
-            Dep = CacheItr->second.first.get();
-            ConfusedLevels = CacheItr->second.second;
-          } else {
-            auto D = mDepInfo->depends(*SrcItr, *DstItr, true, &ConfusedLevels);
-            Dep = D.get();
-            Cache.Impl.try_emplace(std::make_pair(*SrcItr, *DstItr),
-              std::move(D), ConfusedLevels);
-          }
-          if (Dep) {
-            LLVM_DEBUG(
-              dbgs() << "[PRIVATE]: dependence found: ";
-              Dep->dump(dbgs());
-              (**SrcItr).print(dbgs()); dbgs() << "\n";
-              (**DstItr).print(dbgs()); dbgs() << "\n";
-            );
-            // Do not use Dependence::isLoopIndependent() to check loop
-            // independent dependencies. This method returns `may` instead of
-            // `must`. This means that if it returns `true` than dependency
-            // may be loop-carried or may arise inside a single iteration.
-            insertDependence(*Dep, Src, Dst, trait::Dependence::No, *L, Deps);
-          } else if (L->getLoopDepth() <= ConfusedLevels) {
-            LLVM_DEBUG(dbgs() << "[PRIVATE]: assume confused dependence"
-              " (confused levels " << ConfusedLevels << ")\n");
-            DependenceImp::Descriptor Dptr;
-            Dptr.set<trait::Flow, trait::Anti, trait::Output>();
-            trait::Dependence::Flag Flag = trait::Dependence::ConfusedCause |
-              trait::Dependence::LoadStoreCause | trait::Dependence::May;
-            updateDependence(mAliasTree->find(Src), Dptr, Flag, DistanceInfo{},
-                             Deps);
-            updateDependence(mAliasTree->find(Dst), Dptr, Flag, DistanceInfo{},
-                             Deps);
-          }
-        }
+        auto &Dst = LoopAccesses[*DstItr];
+        if (Src.Node && Dst.Node && AliasSTR.isUnreachable(Src.Node, Dst.Node))
+          continue;
+        ++NumberOfTested;
+        collectLoadStoreDependence(*L, *Src.Inst, Src.Loc, *Dst.Inst, Dst.Loc,
+                                   Deps, Cache);
       }
     }
-  }
+  std::chrono::duration<double, std::micro> Time =
+    std::chrono::steady_clock::now() - StartTime;
+  // Assume that each pruned pair takes as much time as an average tested one.
+  double SavedTime = NumberOfTested > 0 ?
+    Time.count() / NumberOfTested * (NumberOfPairs - NumberOfTested) : 0;
+  NumTestedPairs += NumberOfTested;
+  NumPrunedPairs += NumberOfPairs - NumberOfTested;
+  NumTestMicroseconds += static_cast<uint64_t>(Time.count());
+  NumSavedMicroseconds += static_cast<uint64_t>(SavedTime);
+  LLVM_DEBUG(
+    dbgs() << "[PRIVATE]: test " << NumberOfTested << " pairs of loads and "
+              "stores, prune " << NumberOfPairs - NumberOfTested << " pairs";
+    dbgs() << " (" << Groups.size() << " alias subtrees, " << Time.count()
+           << "us spent, estimated " << SavedTime << "us saved)\n");
 }
 
 void PrivateRecognitionPass::resolveAccesses(Loop *L, const DFNode *LatchNode,
@@ -1367,6 +1813,7 @@ void PrivateRecognitionPass::storeResults(
 
 void PrivateRecognitionPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<GlobalOptionsImmutableWrapper>();
+  AU.addRequired<GlobalArraySectionWrapper>();
   AU.addRequired<DominatorTreeWrapperPass>();
   AU.addRequired<LoopInfoWrapperPass>();
   AU.addRequired<DFRegionInfoPass>();
@@ -1374,6 +1821,7 @@ void PrivateRecognitionPass::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<LiveMemoryPass>();
   AU.addRequired<EstimateMemoryPass>();
   AU.addRequired<DependenceAnalysisWrapperPass>();
+  AU.addRequired<DelinearizationPass>();
   AU.addRequired<TargetLibraryInfoWrapperPass>();
   AU.addRequired<ScalarEvolutionWrapperPass>();
   AU.setPreservesAll();
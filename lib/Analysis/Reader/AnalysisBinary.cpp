@@ -0,0 +1,280 @@
+//===- AnalysisBinary.cpp - Analysis Results In Binary Form ------*- C++ -*===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements reading and writing of external analysis results
+// in compact binary form.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Reader/AnalysisBinary.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/raw_ostream.h>
+#include <type_traits>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+namespace {
+const char Magic[] = {'T', 'S', 'A', 'R', 'I', 'N', 'F', 'O'};
+const uint32_t Version = 1;
+
+/// This writes analysis results to a stream, each string is written once.
+class BinaryWriter {
+public:
+  explicit BinaryWriter(raw_ostream &OS) : mWriter(OS, support::little) {}
+
+  void write(const trait::Info &Info) {
+    collectStrings(Info);
+    mWriter.OS.write(Magic, sizeof(Magic));
+    mWriter.write<uint32_t>(Version);
+    mWriter.write<uint32_t>(mStrings.size());
+    for (auto Str : mStrings) {
+      mWriter.write<uint32_t>(Str.size());
+      mWriter.OS << Str;
+    }
+    mWriter.write<uint32_t>(Info[trait::Info::Functions].size());
+    for (auto &F : Info[trait::Info::Functions]) {
+      mWriter.write<uint32_t>(mStringIds[F[trait::Function::File]]);
+      mWriter.write<uint32_t>(F[trait::Function::Line]);
+      mWriter.write<uint32_t>(F[trait::Function::Column]);
+      mWriter.write<uint32_t>(mStringIds[F[trait::Function::Name]]);
+      mWriter.write<uint8_t>(F[trait::Function::Pure] ? 1 : 0);
+    }
+    mWriter.write<uint32_t>(Info[trait::Info::Vars].size());
+    for (auto &V : Info[trait::Info::Vars]) {
+      mWriter.write<uint32_t>(mStringIds[V[trait::Var::File]]);
+      mWriter.write<uint32_t>(V[trait::Var::Line]);
+      mWriter.write<uint32_t>(V[trait::Var::Column]);
+      mWriter.write<uint32_t>(mStringIds[V[trait::Var::Name]]);
+    }
+    mWriter.write<uint32_t>(Info[trait::Info::Loops].size());
+    for (auto &L : Info[trait::Info::Loops]) {
+      mWriter.write<uint32_t>(mStringIds[L[trait::Loop::File]]);
+      mWriter.write<uint32_t>(L[trait::Loop::Line]);
+      mWriter.write<uint32_t>(L[trait::Loop::Column]);
+      writeIds(L[trait::Loop::Private]);
+      mWriter.write<uint32_t>(L[trait::Loop::Reduction].size());
+      for (auto &R : L[trait::Loop::Reduction]) {
+        mWriter.write<uint64_t>(R.first);
+        mWriter.write<uint8_t>(R.second);
+      }
+      writeDistances(L[trait::Loop::Flow]);
+      writeDistances(L[trait::Loop::Anti]);
+      writeIds(L[trait::Loop::Output]);
+      writeIds(L[trait::Loop::WriteOccurred]);
+      writeIds(L[trait::Loop::ReadOccurred]);
+      writeIds(L[trait::Loop::UseAfterLoop]);
+    }
+  }
+
+private:
+  void addString(StringRef Str) {
+    if (mStringIds.try_emplace(Str, mStrings.size()).second)
+      mStrings.push_back(Str);
+  }
+
+  void collectStrings(const trait::Info &Info) {
+    for (auto &F : Info[trait::Info::Functions]) {
+      addString(F[trait::Function::File]);
+      addString(F[trait::Function::Name]);
+    }
+    for (auto &V : Info[trait::Info::Vars]) {
+      addString(V[trait::Var::File]);
+      addString(V[trait::Var::Name]);
+    }
+    for (auto &L : Info[trait::Info::Loops])
+      addString(L[trait::Loop::File]);
+  }
+
+  void writeIds(const std::set<trait::IdTy> &Ids) {
+    mWriter.write<uint32_t>(Ids.size());
+    for (auto Id : Ids)
+      mWriter.write<uint64_t>(Id);
+  }
+
+  void writeDistances(const std::map<trait::IdTy, trait::Distance> &Dists) {
+    mWriter.write<uint32_t>(Dists.size());
+    for (auto &D : Dists) {
+      mWriter.write<uint64_t>(D.first);
+      mWriter.write<int32_t>(D.second[trait::Distance::Min]);
+      mWriter.write<int32_t>(D.second[trait::Distance::Max]);
+    }
+  }
+
+  support::endian::Writer mWriter;
+  StringMap<uint32_t> mStringIds;
+  std::vector<StringRef> mStrings;
+};
+
+/// This reads analysis results from a buffer, all accesses to the buffer are
+/// checked, so a truncated buffer is safely diagnosed.
+class BinaryReader {
+public:
+  explicit BinaryReader(StringRef Buffer) : mBuffer(Buffer) {}
+
+  bool parse(trait::Info &Info) {
+    if (!isAnalysisBinary(mBuffer))
+      return false;
+    mPos = sizeof(Magic);
+    uint32_t V;
+    if (!read(V) || V != Version)
+      return false;
+    uint32_t Size;
+    // Each string contains at least its length.
+    if (!readCount(Size, sizeof(uint32_t)))
+      return false;
+    mStrings.resize(Size);
+    for (auto &Str : mStrings) {
+      uint32_t Length;
+      if (!read(Length) || mPos + Length > mBuffer.size())
+        return false;
+      Str = mBuffer.substr(mPos, Length);
+      mPos += Length;
+    }
+    // File, line, column, name and purity.
+    if (!readCount(Size, 4 * sizeof(uint32_t) + sizeof(uint8_t)))
+      return false;
+    auto &Functions = Info[trait::Info::Functions];
+    Functions.resize(Size);
+    for (auto &F : Functions) {
+      uint8_t Pure;
+      if (!readString(F[trait::Function::File]) ||
+          !read(F[trait::Function::Line]) ||
+          !read(F[trait::Function::Column]) ||
+          !readString(F[trait::Function::Name]) || !read(Pure))
+        return false;
+      F[trait::Function::Pure] = Pure != 0;
+    }
+    // File, line, column and name.
+    if (!readCount(Size, 4 * sizeof(uint32_t)))
+      return false;
+    auto &Vars = Info[trait::Info::Vars];
+    Vars.resize(Size);
+    for (auto &Var : Vars)
+      if (!readString(Var[trait::Var::File]) || !read(Var[trait::Var::Line]) ||
+          !read(Var[trait::Var::Column]) || !readString(Var[trait::Var::Name]))
+        return false;
+    // File, line, column and sizes of 8 lists of traits.
+    if (!readCount(Size, 11 * sizeof(uint32_t)))
+      return false;
+    auto &Loops = Info[trait::Info::Loops];
+    Loops.resize(Size);
+    for (auto &L : Loops) {
+      if (!readString(L[trait::Loop::File]) || !read(L[trait::Loop::Line]) ||
+          !read(L[trait::Loop::Column]) || !readIds(L[trait::Loop::Private]))
+        return false;
+      if (!read(Size))
+        return false;
+      for (uint32_t I = 0; I < Size; ++I) {
+        uint64_t Id;
+        uint8_t Kind;
+        if (!read(Id) || !read(Kind) || Kind >= trait::Reduction::RK_NumberOf)
+          return false;
+        L[trait::Loop::Reduction].emplace_hint(
+            L[trait::Loop::Reduction].end(), Id,
+            static_cast<trait::Reduction::Kind>(Kind));
+      }
+      if (!readDistances(L[trait::Loop::Flow]) ||
+          !readDistances(L[trait::Loop::Anti]) ||
+          !readIds(L[trait::Loop::Output]) ||
+          !readIds(L[trait::Loop::WriteOccurred]) ||
+          !readIds(L[trait::Loop::ReadOccurred]) ||
+          !readIds(L[trait::Loop::UseAfterLoop]))
+        return false;
+    }
+    return mPos == mBuffer.size();
+  }
+
+private:
+  template<class T> bool read(T &Value) {
+    using ValueT = std::conditional_t<std::is_same<T, unsigned>::value,
+                                      uint32_t, T>;
+    if (mPos + sizeof(ValueT) > mBuffer.size())
+      return false;
+    Value = support::endian::read<ValueT, support::little, support::unaligned>(
+        mBuffer.data() + mPos);
+    mPos += sizeof(ValueT);
+    return true;
+  }
+
+  /// Read number of records in a list, a list of a specified size must fit
+  /// into the rest of the buffer (each record occupies at least
+  /// `MinRecordSize` bytes).
+  ///
+  /// This check prevents allocation of a huge amount of memory for a list
+  /// if a size is corrupted.
+  bool readCount(uint32_t &Size, std::size_t MinRecordSize) {
+    return read(Size) && Size <= (mBuffer.size() - mPos) / MinRecordSize;
+  }
+
+  bool readString(std::string &Str) {
+    uint32_t Id;
+    if (!read(Id) || Id >= mStrings.size())
+      return false;
+    Str = mStrings[Id].str();
+    return true;
+  }
+
+  bool readIds(std::set<trait::IdTy> &Ids) {
+    uint32_t Size;
+    if (!read(Size))
+      return false;
+    for (uint32_t I = 0; I < Size; ++I) {
+      uint64_t Id;
+      if (!read(Id))
+        return false;
+      Ids.insert(Ids.end(), Id);
+    }
+    return true;
+  }
+
+  bool readDistances(std::map<trait::IdTy, trait::Distance> &Dists) {
+    uint32_t Size;
+    if (!read(Size))
+      return false;
+    for (uint32_t I = 0; I < Size; ++I) {
+      uint64_t Id;
+      int32_t Min, Max;
+      if (!read(Id) || !read(Min) || !read(Max))
+        return false;
+      Dists.emplace_hint(Dists.end(), Id, trait::Distance(Min, Max));
+    }
+    return true;
+  }
+
+  StringRef mBuffer;
+  std::size_t mPos = 0;
+  std::vector<StringRef> mStrings;
+};
+}
+
+bool tsar::isAnalysisBinary(StringRef Buffer) {
+  return Buffer.startswith(StringRef(Magic, sizeof(Magic)));
+}
+
+void tsar::writeAnalysisBinary(const trait::Info &Info, raw_ostream &OS) {
+  BinaryWriter(OS).write(Info);
+}
+
+bool tsar::readAnalysisBinary(StringRef Buffer, trait::Info &Info) {
+  return BinaryReader(Buffer).parse(Info);
+}
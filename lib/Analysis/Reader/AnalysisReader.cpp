@@ -28,6 +28,7 @@
 #include "tsar/Analysis/Memory/DIMemoryTrait.h"
 #include "tsar/Analysis/Memory/MemoryTraitJSON.h"
 #include "tsar/Analysis/Memory/Passes.h"
+#include "tsar/Analysis/Reader/AnalysisBinary.h"
 #include "tsar/Analysis/Reader/AnalysisJSON.h"
 #include "tsar/Analysis/Reader/Passes.h"
 #include "tsar/Support/GlobalOptions.h"
@@ -37,6 +38,8 @@
 #include <bcl/cell.h>
 #include <bcl/utility.h>
 #include <bcl/tagged.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Analysis/LoopInfo.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/DebugLoc.h>
@@ -45,6 +48,7 @@
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/Debug.h>
+#include <llvm/Support/raw_ostream.h>
 #include <map>
 
 using namespace llvm;
@@ -159,8 +163,22 @@ template<class... Tags> bool isOnlyAnyOf(const TraitT &Traits) {
 /// Map from variable to its traits in some loop.
 using TraitCache = std::map<VariableT, TraitT>;
 
+/// External analysis results which are loaded once per module and shared
+/// between all analyzed functions.
+struct ExternalInfo {
+  trait::Info Info;
+  FunctionCache Functions;
+  LoopCache Loops;
+  /// Traits of variables for each loop, it is lazily built on the first
+  /// access to a loop.
+  DenseMap<const trait::Loop *, TraitCache> Traits;
+};
+
 /// This pass load results from a specified file and update traits of
 /// metadata-level memory locations accessed in loops.
+///
+/// The file is parsed once per module on the first analyzed function,
+/// each function looks up traits for its own loops only.
 class AnalysisReader : public FunctionPass, bcl::Uncopyable {
 public:
   static char ID;
@@ -173,8 +191,20 @@ public:
   bool runOnFunction(Function &F) override;
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 
+  bool doFinalization(Module &M) override {
+    mInfo.reset();
+    mIsLoaded = false;
+    return false;
+  }
+
 private:
+  /// Parse external analysis results (JSON or binary), return `nullptr` if
+  /// results are not available.
+  ExternalInfo * load(Function &F);
+
   std::string mDataFile;
+  bool mIsLoaded = false;
+  std::unique_ptr<ExternalInfo> mInfo;
 };
 
 /// Extract a list of analyzed functions from external analysis results.
@@ -366,6 +396,7 @@ INITIALIZE_PASS_BEGIN(AnalysisReader, "analysis-reader",
   "External Analysis Results Reader", true, true)
 INITIALIZE_PASS_DEPENDENCY(DIMemoryTraitPoolWrapper)
 INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_END(AnalysisReader, "analysis-reader",
   "External Analysis Results Reader", true, true)
 
@@ -378,56 +409,100 @@ FunctionPass * llvm::createAnalysisReader(StringRef DataFile) {
 void AnalysisReader::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<DIMemoryTraitPoolWrapper>();
   AU.addRequired<GlobalOptionsImmutableWrapper>();
+  AU.addRequired<LoopInfoWrapperPass>();
 }
 
-bool AnalysisReader::runOnFunction(Function &F) {
-  auto DWLang = getLanguage(F);
-  if (!DWLang)
-    return false;
+ExternalInfo * AnalysisReader::load(Function &F) {
+  if (mIsLoaded)
+    return mInfo.get();
+  mIsLoaded = true;
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   if (mDataFile.empty()) {
-    auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
     if (!GO.AnalysisUse.empty())
       mDataFile = GO.AnalysisUse;
     else
-      return false;
+      return nullptr;
   }
   auto FileOrErr = MemoryBuffer::getFile(mDataFile);
   if (auto EC = FileOrErr.getError()) {
     F.getContext().diagnose(DiagnosticInfoPGOProfile(mDataFile.data(),
       Twine("unable to open file: ") + EC.message()));
-    return false;
+    return nullptr;
   }
-  auto &TraitPool = getAnalysis<DIMemoryTraitPoolWrapper>().get();
-  json::Parser<> Parser((**FileOrErr).getBuffer().str());
-  trait::Info Info;
-  if (!Parser.parse(Info)) {
-    for (auto D : Parser.errors()) {
-      DiagnosticInfoPGOProfile Diag(mDataFile.data(), D, DS_Note);
-      F.getContext().diagnose(Diag);
+  auto Info = std::make_unique<ExternalInfo>();
+  auto Buffer = (**FileOrErr).getBuffer();
+  if (isAnalysisBinary(Buffer)) {
+    LLVM_DEBUG(dbgs() << "[ANALYSIS READER]: read binary results from "
+                      << mDataFile << "\n");
+    if (!readAnalysisBinary(Buffer, Info->Info)) {
+      F.getContext().diagnose(DiagnosticInfoPGOProfile(mDataFile.data(),
+        "unable to read external analysis results in binary form"));
+      return nullptr;
     }
-    F.getContext().diagnose(DiagnosticInfoPGOProfile(mDataFile.data(),
-      "unable to parse external analysis results"));
-    return false;
+  } else {
+    json::Parser<> Parser(Buffer.str());
+    if (!Parser.parse(Info->Info)) {
+      for (auto D : Parser.errors()) {
+        DiagnosticInfoPGOProfile Diag(mDataFile.data(), D, DS_Note);
+        F.getContext().diagnose(Diag);
+      }
+      F.getContext().diagnose(DiagnosticInfoPGOProfile(mDataFile.data(),
+        "unable to parse external analysis results"));
+      return nullptr;
+    }
+  }
+  if (!GO.AnalysisEmitBinary.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OS(GO.AnalysisEmitBinary, EC, sys::fs::OF_None);
+    if (EC)
+      F.getContext().diagnose(DiagnosticInfoPGOProfile(
+        GO.AnalysisEmitBinary.data(),
+        Twine("unable to open file: ") + EC.message()));
+    else
+      writeAnalysisBinary(Info->Info, OS);
   }
-  auto FunctionCache = buildFunctionCache(Info);
-  auto LoopCache = buildLoopCache(Info);
-  for (auto &TraitLoop : TraitPool) {
-    auto LoopID = cast<MDNode>(TraitLoop.get<Region>());
-    auto *L = findLoop(LoopID, LoopCache, Info);
+  Info->Functions = buildFunctionCache(Info->Info);
+  Info->Loops = buildLoopCache(Info->Info);
+  mInfo = std::move(Info);
+  return mInfo.get();
+}
+
+bool AnalysisReader::runOnFunction(Function &F) {
+  auto DWLang = getLanguage(F);
+  if (!DWLang)
+    return false;
+  auto *External = load(F);
+  if (!External)
+    return false;
+  auto &Info = External->Info;
+  auto &TraitPool = getAnalysis<DIMemoryTraitPoolWrapper>().get();
+  auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  for (auto *Lp : LI.getLoopsInPreorder()) {
+    auto LoopID = Lp->getLoopID();
+    if (!LoopID)
+      continue;
+    auto TraitLoopItr = TraitPool.find(LoopID);
+    if (TraitLoopItr == TraitPool.end())
+      continue;
+    auto *L = findLoop(LoopID, External->Loops, Info);
     if (!L)
       continue;
     LLVM_DEBUG(dbgs() << "[ANALYSIS READER]: update traits for loop at "
                       << (*L)[trait::Loop::File] << ":"
                       << (*L)[trait::Loop::Line] << ":"
                       << (*L)[trait::Loop::Column] << "\n");
-    auto TraitCache = buildTraitCache(Info, *L);
-    for (auto &DITrait : *TraitLoop.get<Pool>()) {
+    auto TraitCacheItr = External->Traits.find(L);
+    if (TraitCacheItr == External->Traits.end())
+      TraitCacheItr =
+          External->Traits.try_emplace(L, buildTraitCache(Info, *L)).first;
+    auto &TraitCache = TraitCacheItr->second;
+    for (auto &DITrait : *TraitLoopItr->get<Pool>()) {
       if (auto *DIUM{ dyn_cast<DIUnknownMemory>(DITrait.getMemory()) };
           DIUM && DIUM->isExec()) {
         auto *MD{DIUM->getMetadata()};
         assert(MD && "MDNode must not be null!");
         if (auto *DISub{dyn_cast<DISubprogram>(MD)})
-          if (auto *F{findFunction(DISub, FunctionCache, Info)}) {
+          if (auto *F{findFunction(DISub, External->Functions, Info)}) {
             LLVM_DEBUG(dbgs() << "[ANALYSIS READER]: update traits for the "
                               << (*F)[trait::Function::Name] << " function at "
                               << (*F)[trait::Function::File] << ":"
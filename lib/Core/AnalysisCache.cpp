@@ -0,0 +1,320 @@
+//===- AnalysisCache.cpp - Persistent Cache of Analysis Results -*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a content-addressed on-disk cache of analysis results.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Core/AnalysisCache.h"
+#include "tsar/Core/tsar-config.h"
+#include "tsar/Core/TransformationContext.h"
+#include "tsar/Frontend/Clang/TransformationContext.h"
+#include "tsar/Support/GlobalOptions.h"
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/LangOptions.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/IR/DebugInfo.h>
+#include <llvm/IR/Module.h>
+#include <llvm/PassInfo.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace clang;
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "analysis-cache"
+
+STATISTIC(NumCacheHit, "Number of modules with cached analysis results");
+STATISTIC(NumCacheMiss, "Number of modules without cached analysis results");
+
+namespace {
+/// Add an integer value to a hash, value is added in a platform independent
+/// form.
+void update(MD5 &Hash, uint64_t Value) {
+  uint8_t Bytes[sizeof(uint64_t)];
+  support::endian::write64le(Bytes, Value);
+  Hash.update(Bytes);
+}
+
+/// Add a string to a hash, the length is also added to separate neighboring
+/// strings.
+void update(MD5 &Hash, StringRef Str) {
+  update(Hash, static_cast<uint64_t>(Str.size()));
+  Hash.update(Str);
+}
+
+void update(MD5 &Hash, const GlobalOptions &Options) {
+  update(Hash, Options.PrintFilenameOnly);
+  update(Hash, Options.IsSafeTypeCast);
+  update(Hash, Options.InBoundsSubscripts);
+  update(Hash, Options.AnalyzeLibFunc);
+  update(Hash, static_cast<uint64_t>(Options.IgnoreRedundantMemory));
+  update(Hash, Options.UnsafeTfmAnalysis);
+  update(Hash, Options.NoExternalCalls);
+  update(Hash, Options.NoInline);
+  update(Hash, Options.MemoryAccessInlineThreshold);
+  // External analysis results may change without changes in the file name.
+  update(Hash, Options.AnalysisUse);
+  if (!Options.AnalysisUse.empty())
+    if (auto Buffer = MemoryBuffer::getFile(Options.AnalysisUse))
+      update(Hash, (*Buffer)->getBuffer());
+  update(Hash, Options.OptRegions.size());
+  for (auto &R : Options.OptRegions)
+    update(Hash, R);
+  update(Hash, Options.CommandLine.size());
+  for (auto &Arg : Options.CommandLine)
+    update(Hash, Arg);
+}
+
+/// Add identifier of the analyzer build.
+///
+/// Default values of options and analysis algorithms may be changed without
+/// changes in the version string, so the executable is also taken into
+/// account.
+void updateBuild(MD5 &Hash) {
+  static int Anchor;
+  update(Hash, TSAR_VERSION_STRING);
+  auto Path = sys::fs::getMainExecutable(nullptr, &Anchor);
+  sys::fs::file_status Status;
+  if (Path.empty() || sys::fs::status(Path, Status))
+    return;
+  update(Hash, Path);
+  update(Hash, Status.getSize());
+  update(Hash, static_cast<uint64_t>(
+    Status.getLastModificationTime().time_since_epoch().count()));
+}
+
+/// Add IR of a module.
+///
+/// The whole module is printed, so metadata (names, lines and types from
+/// debug information) is also taken into account. The module identifier
+/// and the name of the source file do not affect the key.
+void updateIR(MD5 &Hash, const Module &M) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  M.print(OS, nullptr);
+  StringRef Body(OS.str());
+  while (Body.startswith("; ModuleID") || Body.startswith("source_filename"))
+    Body = Body.split('\n').second;
+  update(Hash, Body);
+}
+
+/// Add sources of a module.
+///
+/// Printed results contain source-level locations and names, so changes in
+/// sources (for example, in comments) may change the results even if IR
+/// remains the same. Files are referenced from debug information, headers
+/// which do not produce any debug information are taken from source
+/// managers of transformation contexts.
+void updateSources(MD5 &Hash, const Module &M, TransformationInfo *TfmInfo) {
+  StringSet<> Visited;
+  auto addFile = [&Hash, &Visited](StringRef Path) {
+    if (!Visited.insert(Path).second)
+      return;
+    update(Hash, Path);
+    if (auto Buffer = MemoryBuffer::getFile(Path))
+      update(Hash, (*Buffer)->getBuffer());
+  };
+  auto addDIFile = [&addFile](const DIFile *File) {
+    if (!File)
+      return;
+    SmallString<128> Path(File->getFilename());
+    sys::fs::make_absolute(File->getDirectory(), Path);
+    addFile(Path);
+  };
+  DebugInfoFinder Finder;
+  Finder.processModule(M);
+  for (auto *CU : Finder.compile_units())
+    addDIFile(CU->getFile());
+  for (auto *SP : Finder.subprograms())
+    addDIFile(SP->getFile());
+  for (auto *GVE : Finder.global_variables())
+    addDIFile(GVE->getVariable()->getFile());
+  for (auto *Ty : Finder.types())
+    addDIFile(Ty->getFile());
+  for (auto *Scope : Finder.scopes())
+    addDIFile(Scope->getFile());
+  if (!TfmInfo)
+    return;
+  // Sort included files, because source manager does not store them in
+  // a stable order.
+  std::vector<std::string> Includes;
+  for (auto *CU : M.debug_compile_units())
+    if (auto *TfmCtx = dyn_cast_or_null<ClangTransformationContext>(
+            TfmInfo->getContext(*CU)))
+      if (TfmCtx->hasInstance()) {
+        auto &SrcMgr = TfmCtx->getContext().getSourceManager();
+        for (auto &Info :
+             make_range(SrcMgr.fileinfo_begin(), SrcMgr.fileinfo_end())) {
+          SmallString<128> Path(Info.first->getName());
+          sys::fs::make_absolute(Path);
+          Includes.emplace_back(Path.str());
+        }
+      }
+  llvm::sort(Includes);
+  for (auto &Path : Includes)
+    addFile(Path);
+}
+}
+
+AnalysisCache::AnalysisCache(StringRef Dir, const Module &M,
+    const GlobalOptions &Options, ArrayRef<const PassInfo *> PrintPasses,
+    unsigned PrintSteps, TransformationInfo *TfmInfo)
+    : mDir(Dir) {
+  // A binary form is emitted only if external results are used.
+  if (!Options.AnalysisUse.empty())
+    mEmitBinary = Options.AnalysisEmitBinary;
+  MD5 Hash;
+  updateBuild(Hash);
+  updateIR(Hash, M);
+  updateSources(Hash, M, TfmInfo);
+  update(Hash, Options);
+  update(Hash, PrintPasses.size());
+  for (auto *PI : PrintPasses)
+    update(Hash, PI->getPassArgument());
+  update(Hash, PrintSteps);
+  if (TfmInfo) {
+    update(Hash, TfmInfo->getCommandLine().size());
+    for (auto &Arg : TfmInfo->getCommandLine())
+      update(Hash, Arg);
+  }
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  mFilename = mDir;
+  sys::path::append(mFilename, Result.digest() + ".txt");
+  mDiagFilename = mDir;
+  sys::path::append(mDiagFilename, Result.digest() + ".diag");
+  if (!mEmitBinary.empty()) {
+    mBinaryFilename = mDir;
+    sys::path::append(mBinaryFilename, Result.digest() + ".bin");
+  }
+}
+
+/// Record rendered diagnostics and pass them to the original client.
+class AnalysisCache::DiagnosticRecorder : public DiagnosticConsumer {
+public:
+  DiagnosticRecorder(DiagnosticsEngine &Diags, const LangOptions &LangOpts,
+                     std::string &Out)
+      : mDiags(Diags), mClient(Diags.getClient()),
+        mOwnsClient(Diags.ownsClient()), mOS(Out),
+        mPrinter(mOS, &Diags.getDiagnosticOptions()) {
+    if (mOwnsClient)
+      Diags.takeClient().release();
+    mPrinter.BeginSourceFile(LangOpts);
+    Diags.setClient(this, /*ShouldOwnClient=*/false);
+  }
+
+  ~DiagnosticRecorder() override {
+    mPrinter.EndSourceFile();
+    mDiags.setClient(mClient, mOwnsClient);
+  }
+
+  DiagnosticsEngine &getDiagnostics() const noexcept { return mDiags; }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    mPrinter.HandleDiagnostic(Level, Info);
+    mOS.flush();
+    if (mClient)
+      mClient->HandleDiagnostic(Level, Info);
+  }
+
+  bool IncludeInDiagnosticCounts() const override {
+    return mClient ? mClient->IncludeInDiagnosticCounts() : true;
+  }
+
+private:
+  DiagnosticsEngine &mDiags;
+  DiagnosticConsumer *mClient;
+  bool mOwnsClient;
+  raw_string_ostream mOS;
+  TextDiagnosticPrinter mPrinter;
+};
+
+AnalysisCache::~AnalysisCache() = default;
+
+void AnalysisCache::recordDiagnostics(DiagnosticsEngine &Diags,
+                                      const LangOptions &LangOpts) {
+  for (auto &R : mRecorders)
+    if (&R->getDiagnostics() == &Diags)
+      return;
+  mRecorders.push_back(
+      std::make_unique<DiagnosticRecorder>(Diags, LangOpts, mDiagnostics));
+}
+
+bool AnalysisCache::replay(raw_ostream &OS) const {
+  auto Buffer = MemoryBuffer::getFile(mFilename);
+  auto DiagBuffer = MemoryBuffer::getFile(mDiagFilename);
+  // Binary form of external analysis results is written as a side effect of
+  // the analysis, so it should be restored on a hit.
+  if (!Buffer || !DiagBuffer ||
+      (!mEmitBinary.empty() &&
+       sys::fs::copy_file(mBinaryFilename, mEmitBinary))) {
+    ++NumCacheMiss;
+    return false;
+  }
+  ++NumCacheHit;
+  // Diagnostics are printed immediately while results are buffered until
+  // the end of analysis, so diagnostics are replayed first.
+  OS << (*DiagBuffer)->getBuffer();
+  OS << (*Buffer)->getBuffer();
+  return true;
+}
+
+void AnalysisCache::store(StringRef Results) const {
+  if (auto EC = sys::fs::create_directories(mDir)) {
+    errs() << "WARNING: unable to create analysis cache directory '" << mDir
+           << "': " << EC.message() << "\n";
+    return;
+  }
+  if (!mEmitBinary.empty()) {
+    SmallString<128> TmpFilename;
+    int FD;
+    if (sys::fs::createUniqueFile(mBinaryFilename + "-%%%%%%%%", FD,
+                                  TmpFilename))
+      return;
+    auto EC = sys::fs::copy_file(mEmitBinary, FD);
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    if (EC || sys::fs::rename(TmpFilename, mBinaryFilename)) {
+      sys::fs::remove(TmpFilename);
+      return;
+    }
+  }
+  {
+    AtomicallyMovedFile File(mDiagFilename);
+    if (!File.hasStream())
+      return;
+    File.getStream() << mDiagnostics;
+  }
+  AtomicallyMovedFile File(mFilename);
+  if (File.hasStream())
+    File.getStream() << Results;
+}
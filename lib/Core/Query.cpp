@@ -32,8 +32,10 @@
 #ifdef APC_FOUND
 # include "tsar/APC/Passes.h"
 #endif
+#include "tsar/Core/AnalysisCache.h"
 #include "tsar/Core/Query.h"
 #include "tsar/Core/TransformationContext.h"
+#include "tsar/Frontend/Clang/TransformationContext.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/PassBarrier.h"
 #include "tsar/Transform/AST/Passes.h"
@@ -61,6 +63,7 @@
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/Utils.h>
+#include <optional>
 
 using namespace clang;
 using namespace llvm;
@@ -117,10 +120,12 @@ void addBeforeTfmAnalysis(legacy::PassManager &Passes, StringRef AnalysisUse) {
   Passes.add(createCallExtractorPass());
   Passes.add(createGlobalDefinedMemoryPass());
   Passes.add(createGlobalLiveMemoryPass());
+  Passes.add(createGlobalArraySectionPass());
   Passes.add(createFunctionMemoryAttrsAnalysis());
   Passes.add(createDIDependencyAnalysisPass());
   Passes.add(createProcessDIMemoryTraitPass(mark<trait::DirectAccess>));
   Passes.add(createAnalysisReader());
+  Passes.add(createIRChangeSnapshotPass());
 }
 
 void addAfterSROAAnalysis(const GlobalOptions &GO, const DataLayout &DL,
@@ -150,10 +155,16 @@ void addAfterSROAAnalysis(const GlobalOptions &GO, const DataLayout &DL,
   Passes.add(createPOFunctionAttrsAnalysis());
   Passes.add(createMemoryMatcherPass());
   Passes.add(createCallExtractorPass());
+  // Interprocedural analysis of defined and live memory and array sections
+  // recomputes results for functions which have been changed since the last
+  // snapshot (and for functions which depend on them), results for other
+  // functions are reused.
   Passes.add(createGlobalDefinedMemoryPass());
   Passes.add(createGlobalLiveMemoryPass());
+  Passes.add(createGlobalArraySectionPass());
   Passes.add(createFunctionMemoryAttrsAnalysis());
   Passes.add(createDIDependencyAnalysisPass());
+  Passes.add(createIRChangeSnapshotPass());
 }
 
 void addAfterFunctionInlineAnalysis(
@@ -182,8 +193,10 @@ void addAfterLoopRotateAnalysis(legacy::PassManager &Passes) {
   Passes.add(createCallExtractorPass());
   Passes.add(createGlobalDefinedMemoryPass());
   Passes.add(createGlobalLiveMemoryPass());
+  Passes.add(createGlobalArraySectionPass());
   Passes.add(createFunctionMemoryAttrsAnalysis());
   Passes.add(createDIDependencyAnalysisPass());
+  Passes.add(createIRChangeSnapshotPass());
 }
 } // namespace tsar
 
@@ -206,6 +219,36 @@ void DefaultQueryManager::addWithPrint(llvm::Pass *P, bool PrintResult,
 
 void DefaultQueryManager::run(llvm::Module *M, TransformationInfo *TfmInfo) {
   assert(M && "Module must not be null!");
+  // Note, that function passes between barriers are not executed in parallel
+  // even if GlobalOptions::NumThreads is greater than 1. Analysis passes
+  // create metadata in a single LLVM context, update the shared pool of
+  // memory traits and use lazily computed module-level alias analysis
+  // results (CFL, globals), so none of them is thread-safe. Stages of
+  // processing which do not depend on the LLVM context may use more threads.
+  //
+  // Printed results are cached if it is possible. Output passes have side
+  // effects (for example, they write files), so if such passes are specified
+  // the cache is not used. Diagnostics reported to source-level contexts are
+  // cached with the results. A key is computed before any transformation of
+  // the module.
+  std::optional<AnalysisCache> Cache;
+  if (!mGlobalOptions->AnalysisCacheDir.empty() && !mUseServer &&
+      mOutputPasses.empty() && !mPrintPasses.empty()) {
+    Cache.emplace(mGlobalOptions->AnalysisCacheDir, *M, *mGlobalOptions,
+                  mPrintPasses, mPrintSteps, TfmInfo);
+    if (Cache->replay(errs()))
+      return;
+    if (TfmInfo)
+      for (auto *CU : M->debug_compile_units())
+        if (auto *TfmCtx = dyn_cast_or_null<ClangTransformationContext>(
+                TfmInfo->getContext(*CU)))
+          if (TfmCtx->hasInstance())
+            Cache->recordDiagnostics(TfmCtx->getContext().getDiagnostics(),
+                                     TfmCtx->getContext().getLangOpts());
+  }
+  std::string CachedResults;
+  raw_string_ostream CacheOS(CachedResults);
+  raw_ostream &PrintOS = Cache ? static_cast<raw_ostream &>(CacheOS) : errs();
   legacy::PassManager Passes;
   Passes.add(createGlobalOptionsImmutableWrapper(mGlobalOptions));
   if (TfmInfo) {
@@ -217,7 +260,7 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationInfo *TfmInfo) {
   }
   addImmutableAliasAnalysis(Passes);
   addInitialTransformations(Passes);
-  auto addPrint = [&Passes, this](ProcessingStep CurrentStep) {
+  auto addPrint = [&Passes, &PrintOS, this](ProcessingStep CurrentStep) {
     if (!(CurrentStep & mPrintSteps))
       return;
     for (auto PI : mPrintPasses) {
@@ -235,10 +278,10 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationInfo *TfmInfo) {
         llvm_unreachable("Printers does not support this kind of passes yet!");
         break;
       case PT_Function:
-        Passes.add(createFunctionPassPrinter(PI, errs()));
+        Passes.add(createFunctionPassPrinter(PI, PrintOS));
         break;
       case PT_Module:
-        Passes.add(createModulePassPrinter(PI, errs()));
+        Passes.add(createModulePassPrinter(PI, PrintOS));
         break;
       }
     }
@@ -290,6 +333,8 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationInfo *TfmInfo) {
   Passes.add(createMemoryMatcherPass());
   Passes.add(createGlobalDefinedMemoryStorage());
   Passes.add(createGlobalLiveMemoryStorage());
+  Passes.add(createGlobalArraySectionStorage());
+  Passes.add(createIRChangeTrackerStorage());
   // It is necessary to destroy DIMemoryTraitPool before DIMemoryEnvironment to
   // avoid dangling handles. So, we add pool before environment in the manager.
   Passes.add(createDIMemoryTraitPoolStorage());
@@ -325,6 +370,10 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationInfo *TfmInfo) {
   addOutput(AfterLoopRotateAnalysis);
   Passes.add(createVerifierPass());
   Passes.run(*M);
+  if (Cache) {
+    errs() << CacheOS.str();
+    Cache->store(CachedResults);
+  }
 }
 
 bool EmitLLVMQueryManager::beginSourceFile(
@@ -356,7 +405,8 @@ void InstrLLVMQueryManager::run(llvm::Module *M,
   Passes.add(createDINodeRetrieverPass());
   Passes.add(createMemoryMatcherPass());
   Passes.add(createDILoopRetrieverPass());
-  Passes.add(createInstrumentationPass(mInstrEntry, mInstrStart));
+  Passes.add(
+    createInstrumentationPass(mInstrEntry, mInstrStart, mInstrLoopRanges));
   Passes.add(createPrintModulePass(*mOS, "", mCodeGenOpts->EmitLLVMUseLists));
   Passes.run(*M);
 }
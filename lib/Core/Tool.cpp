@@ -32,18 +32,26 @@
 #include "tsar/Frontend/Clang/ASTMergeAction.h"
 #include "tsar/Frontend/Clang/Pragma.h"
 #include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/TraceProfiler.h"
 #ifdef APC_FOUND
 # include "tsar/APC/Utils.h"
 #endif
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/ADT/Triple.h>
 #include <llvm/IR/LegacyPassNameParser.h>
 #include <llvm/Support/Debug.h>
 #include <llvm/Support/Path.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/StringSaver.h>
 #ifdef lp_solve_FOUND
 # include <lp_solve/lp_solve_config.h>
 #endif
@@ -119,6 +127,7 @@ struct Options : private bcl::Uncopyable {
   llvm::cl::opt<bool> InstrLLVM;
   llvm::cl::opt<std::string> InstrEntry;
   llvm::cl::list<std::string> InstrStart;
+  llvm::cl::opt<bool> InstrLoopRanges;
   llvm::cl::opt<bool> EmitAST;
   llvm::cl::opt<bool> MergeAST;
   llvm::cl::alias MergeASTA;
@@ -138,6 +147,8 @@ struct Options : private bcl::Uncopyable {
   llvm::cl::opt<bool> PrintAST;
   llvm::cl::opt<bool> DumpAST;
   llvm::cl::opt<bool> TimeReport;
+  llvm::cl::opt<std::string> TimeTrace;
+  llvm::cl::opt<unsigned> TimeTraceGranularity;
   llvm::cl::opt<bool> UseServer;
 
   llvm::cl::opt<bool> PrintAll;
@@ -169,11 +180,15 @@ struct Options : private bcl::Uncopyable {
   llvm::cl::opt<bool> LoadSources;
   llvm::cl::opt<bool> NoLoadSources;
   llvm::cl::opt<std::string> AnalysisUse;
+  llvm::cl::opt<std::string> AnalysisEmitBinary;
+  llvm::cl::opt<std::string> AnalysisCache;
   llvm::cl::list<std::string> OptRegion;
+  llvm::cl::opt<unsigned> NumThreads;
 
   llvm::cl::OptionCategory TransformCategory;
   llvm::cl::opt<bool> NoFormat;
   llvm::cl::opt<std::string> OutputSuffix;
+  llvm::cl::opt<unsigned> MILPTimeout;
 private:
   /// Default constructor.
   ///
@@ -202,6 +217,8 @@ Options::Options() :
   InstrStart("instr-start", cl::cat(CompileCategory), cl::value_desc("functions"),
     cl::ZeroOrMore, cl::ValueRequired, cl::CommaSeparated,
     cl::desc("Add start point for instrumentation")),
+  InstrLoopRanges("instr-loop-ranges", cl::cat(CompileCategory),
+    cl::desc("Register affine memory accesses once per loop execution")),
   EmitAST("emit-ast", cl::cat(CompileCategory),
     cl::desc("Emit Clang AST files for source inputs")),
   MergeAST("merge-ast", cl::cat(CompileCategory),
@@ -236,6 +253,11 @@ Options::Options() :
     cl::desc("Build ASTs and then debug dump them")),
   TimeReport("ftime-report", cl::cat(DebugCategory),
     cl::desc("Print some statistics about the time consumed by each pass when it finishes")),
+  TimeTrace("ftime-trace", cl::cat(DebugCategory), cl::value_desc("filename"),
+    cl::desc("Write time and memory profile of passes, loops and analysis server requests in Chrome trace-event format")),
+  TimeTraceGranularity("ftime-trace-granularity", cl::cat(DebugCategory),
+    cl::value_desc("microseconds"), cl::init(500),
+    cl::desc("Minimum time granularity (in microseconds) traced by time profiler")),
   UseServer("use-analysis-server", cl::cat(DebugCategory),
     cl::desc("Run default workflow on analysis server")),
   PrintAll("print-all", cl::cat(DebugCategory),
@@ -306,14 +328,28 @@ Options::Options() :
   AnalysisUse("fanalysis-use", cl::cat(AnalysisCategory),
     cl::value_desc("filename"),
     cl::desc("Use external analysis results to clarify analysis")),
+  AnalysisEmitBinary("fanalysis-emit-binary", cl::cat(AnalysisCategory),
+    cl::value_desc("filename"),
+    cl::desc("Store external analysis results in a compact binary form")),
+  AnalysisCache("fanalysis-cache", cl::cat(AnalysisCategory),
+    cl::value_desc("directory"),
+    cl::desc("Reuse printed analysis results cached in a specified directory")),
   OptRegion("foptimize-only", cl::cat(AnalysisCategory), cl::value_desc("regions"),
     cl::ZeroOrMore, cl::ValueRequired, cl::CommaSeparated,
     cl::desc("Allow optimization of specified regions (comma separated list of region names")),
+  NumThreads("j", cl::cat(AnalysisCategory), cl::value_desc("N"),
+    cl::init(1), cl::Prefix,
+    cl::desc("Number of threads to use for independent stages of processing "
+             "(0 means the number of hardware threads)")),
   TransformCategory("Transformation options"),
   NoFormat("no-format", cl::cat(TransformCategory),
     cl::desc("Disable format of transformed sources")),
   OutputSuffix("output-suffix", cl::cat(TransformCategory), cl::value_desc("suffix"),
-    cl::desc("Filename suffix (between name and extension) for transformed sources")) {
+    cl::desc("Filename suffix (between name and extension) for transformed sources")),
+  MILPTimeout("fmilp-timeout", cl::cat(TransformCategory),
+    cl::value_desc("seconds"), cl::init(0),
+    cl::desc("Time limit to solve each independent part of MILP model "
+             "(0 means no limit)")) {
   StringMap<cl::Option*> &Opts = cl::getRegisteredOptions();
   assert(Opts.count("help") == 1 && "Option '-help' must be specified!");
   auto Help = Opts["help"];
@@ -398,6 +434,63 @@ static std::vector<const char *> addInternalArgs(int Argc, const char **Argv) {
   return Args;
 }
 
+/// Return true if a specified option does not affect analysis results.
+///
+/// These options are ignored when cached analysis results are looked up.
+static bool isAnalysisIrrelevantOption(StringRef Name) {
+  return StringSwitch<bool>(Name)
+      .Cases("j", "o", "v", "fanalysis-cache", "fanalysis-emit-binary", true)
+      .Cases("ftime-report", "ftime-trace", "ftime-trace-granularity", true)
+      .Cases("stats", "debug", "debug-only", "debug-pass", true)
+      .Default(false);
+}
+
+/// Remove options which do not affect analysis results from a specified
+/// command line (response files must be already expanded).
+///
+/// LLVM does not provide a generic way to read the value of a registered
+/// option, so arguments are used to identify cached results. Hidden options
+/// may also change results, so only known irrelevant options are removed.
+static std::vector<std::string>
+getAnalysisCommandLine(ArrayRef<const char *> Args) {
+  auto &Registered = cl::getRegisteredOptions();
+  // Return an irrelevant option which matches a specified name. Prefix
+  // options (for example, -j4 or -ofile) are also checked.
+  auto findIrrelevant = [&Registered](StringRef Name) -> cl::Option * {
+    auto Itr = Registered.find(Name);
+    if (Itr != Registered.end())
+      return isAnalysisIrrelevantOption(Name) ? Itr->second : nullptr;
+    for (StringRef Prefix : {"j", "o"})
+      if (Name.startswith(Prefix)) {
+        Itr = Registered.find(Prefix);
+        if (Itr != Registered.end() &&
+            Itr->second->getFormattingFlag() == cl::Prefix)
+          return Itr->second;
+      }
+    return nullptr;
+  };
+  std::vector<std::string> CommandLine;
+  for (unsigned I = 0, EI = Args.size(); I < EI; ++I) {
+    StringRef Arg(Args[I]);
+    if (!Arg.startswith("-") || Arg == "-") {
+      CommandLine.emplace_back(Arg);
+      continue;
+    }
+    StringRef Name, Value;
+    std::tie(Name, Value) = Arg.ltrim('-').split('=');
+    auto *O = findIrrelevant(Name);
+    if (!O) {
+      CommandLine.emplace_back(Arg);
+      continue;
+    }
+    // Skip a value of an option which is specified in a separate argument.
+    if (Name == O->ArgStr && !Arg.contains('=') &&
+        O->getValueExpectedFlag() == cl::ValueRequired)
+      ++I;
+  }
+  return CommandLine;
+}
+
 Tool::Tool(int Argc, const char **Argv) {
   assert(Argv && "List of command line arguments must not be null!");
   Options::get(); // At first, initialize command line options.
@@ -408,6 +501,17 @@ Tool::Tool(int Argc, const char **Argv) {
   auto Args = addInternalArgs(Argc, Argv);
   cl::ParseCommandLineOptions(Args.size(), Args.data(), Descr);
   storeCLOptions();
+  if (!mGlobalOpts.AnalysisCacheDir.empty()) {
+    BumpPtrAllocator Alloc;
+    StringSaver Saver(Alloc);
+    SmallVector<const char *, 64> CommandLine(Args.begin() + 1, Args.end());
+    cl::ExpandResponseFiles(Saver,
+                            Triple(sys::getProcessTriple()).isOSWindows()
+                                ? cl::TokenizeWindowsCommandLine
+                                : cl::TokenizeGNUCommandLine,
+                            CommandLine);
+    mGlobalOpts.CommandLine = getAnalysisCommandLine(CommandLine);
+  }
   InitializeAllTargetInfos();
   InitializeAllTargetMCs();
   InitializeAllAsmParsers();
@@ -430,8 +534,9 @@ inline static EmitLLVMQueryManager * getEmitLLVMQM() {
 }
 
 inline static InstrLLVMQueryManager * getInstrLLVMQM(
-    StringRef InstrEntry, ArrayRef<std::string> InstrStart) {
-  static InstrLLVMQueryManager QM(InstrEntry, InstrStart);
+    StringRef InstrEntry, ArrayRef<std::string> InstrStart,
+    bool InstrLoopRanges) {
+  static InstrLLVMQueryManager QM(InstrEntry, InstrStart, InstrLoopRanges);
   return &QM;
 }
 
@@ -618,6 +723,11 @@ void Tool::storeCLOptions() {
       Options::get().MemoryAccessInlineThreshold;
   mGlobalOpts.OptRegions = Options::get().OptRegion;
   mGlobalOpts.AnalysisUse = Options::get().AnalysisUse;
+  mGlobalOpts.AnalysisEmitBinary = Options::get().AnalysisEmitBinary;
+  mGlobalOpts.AnalysisCacheDir = Options::get().AnalysisCache;
+  mGlobalOpts.NumThreads = Options::get().NumThreads;
+  mTimeTraceFile = Options::get().TimeTrace;
+  mTimeTraceGranularity = Options::get().TimeTraceGranularity;
   mEmitAST = addLLIfSet(addIfSet(Options::get().EmitAST));
   mMergeAST = mEmitAST ?
     addLLIfSet(addIfSet(Options::get().MergeAST)) :
@@ -629,7 +739,9 @@ void Tool::storeCLOptions() {
   mInstrLLVM = addIfSet(Options::get().InstrLLVM);
   mInstrEntry = Options::get().InstrEntry;
   mInstrStart = Options::get().InstrStart;
-  if (!mInstrLLVM && (!mInstrEntry.empty() || !mInstrStart.empty()))
+  mInstrLoopRanges = Options::get().InstrLoopRanges;
+  if (!mInstrLLVM &&
+      (!mInstrEntry.empty() || !mInstrStart.empty() || mInstrLoopRanges))
     errs() << "WARNING: Instrumentation options are ignored when "
               "-instr-llvm is not set.\n";
   mCheck = addLLIfSet(addIfSet(Options::get().Check));
@@ -656,6 +768,7 @@ void Tool::storeCLOptions() {
   }
   mGlobalOpts.NoFormat = addIfSetIf(Options::get().NoFormat, NoTfmPass);
   mGlobalOpts.OutputSuffix = Options::get().OutputSuffix;
+  mGlobalOpts.MILPTimeout = Options::get().MILPTimeout;
   if (NoTfmPass && !mGlobalOpts.OutputSuffix.empty()) {
     IncompatibleOpts.push_back(&Options::get().OutputSuffix);
     LLIncompatibleOpts.push_back(&Options::get().OutputSuffix);
@@ -684,6 +797,15 @@ void Tool::storeCLOptions() {
 }
 
 int Tool::run(QueryManager *QM) {
+  if (!mTimeTraceFile.empty())
+    traceProfilerInitialize(mTimeTraceGranularity, "tsar");
+  auto WriteTimeTrace = make_scope_exit([this]() {
+    if (mTimeTraceFile.empty())
+      return;
+    if (auto E = traceProfilerWrite(mTimeTraceFile))
+      errs() << "WARNING: Unable to write time trace profile: "
+             << toString(std::move(E)) << "\n";
+  });
   std::vector<std::string> NoASTSources;
   std::vector<std::string> SourcesToMerge;
   std::vector<std::string> LLSources;
@@ -704,38 +826,76 @@ int Tool::run(QueryManager *QM) {
   // Evaluation of Clang AST files by this tool leads an error,
   // so these sources should be excluded.
   ClangTool EmitPCHTool(*mCompilations, NoASTSources);
-  auto ArgumentsAdjuster = [&SourcesToMerge, this](
-    const CommandLineArguments &CL, StringRef Filename) {
-    CommandLineArguments Adjusted;
-    for (std::size_t I = 0; I < CL.size(); ++I) {
-      StringRef Arg = CL[I];
-      // If `-fsyntax-only` is set all output files will be ignored.
-      if (Arg.startswith("-fsyntax-only"))
-        Adjusted.emplace_back("-emit-ast");
-      else
-        Adjusted.push_back(Arg.str());
+  auto getArgumentsAdjuster =
+      [this](std::vector<std::string> &SourcesToMerge) {
+    return [&SourcesToMerge, this](
+        const CommandLineArguments &CL, StringRef Filename) {
+      CommandLineArguments Adjusted;
+      for (std::size_t I = 0; I < CL.size(); ++I) {
+        StringRef Arg = CL[I];
+        // If `-fsyntax-only` is set all output files will be ignored.
+        if (Arg.startswith("-fsyntax-only"))
+          Adjusted.emplace_back("-emit-ast");
+        else
+          Adjusted.push_back(Arg.str());
+      }
+      Adjusted.emplace_back("-o");
+      if (mOutputFilename.empty()) {
+        SmallString<128> PCHFile = Filename;
+        sys::path::replace_extension(PCHFile, ".ast");
+        Adjusted.push_back(std::string(PCHFile));
+        SourcesToMerge.push_back(std::string(PCHFile));
+      } else {
+        Adjusted.push_back(mOutputFilename);
+        SourcesToMerge.push_back(mOutputFilename);
+      }
+      return Adjusted;
+    };
+  };
+  EmitPCHTool.appendArgumentsAdjuster(getArgumentsAdjuster(SourcesToMerge));
+  // Emit Clang AST files for each source in a separate thread if it is
+  // possible, this is similar to clang::tooling::AllTUsToolExecutor.
+  // Names of emitted files are appended to the list of sources to merge
+  // in the order of sources in the command line.
+  auto emitAST = [&EmitPCHTool, &NoASTSources, &SourcesToMerge,
+                  &getArgumentsAdjuster, this]() {
+    auto Strategy = hardware_concurrency(mGlobalOpts.NumThreads);
+    if (Strategy.compute_thread_count() < 2 || NoASTSources.size() < 2)
+      return EmitPCHTool.run(
+          newActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
+    std::vector<std::vector<std::string>> EmittedFiles(NoASTSources.size());
+    std::vector<int> Results(NoASTSources.size(), 0);
+    {
+      ThreadPool Pool(Strategy);
+      for (std::size_t I = 0, EI = NoASTSources.size(); I < EI; ++I)
+        Pool.async([&EmittedFiles, &Results, &NoASTSources,
+                    &getArgumentsAdjuster, I, this]() {
+          // Each thread gets an independent copy of a file system to allow
+          // different concurrent working directories.
+          IntrusiveRefCntPtr<vfs::FileSystem> FS =
+              vfs::createPhysicalFileSystem().release();
+          ClangTool Tool(*mCompilations, NoASTSources[I],
+                         std::make_shared<PCHContainerOperations>(), FS);
+          Tool.appendArgumentsAdjuster(getArgumentsAdjuster(EmittedFiles[I]));
+          Results[I] = Tool.run(
+              newActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
+        });
     }
-    Adjusted.emplace_back("-o");
-    if (mOutputFilename.empty()) {
-      SmallString<128> PCHFile = Filename;
-      sys::path::replace_extension(PCHFile, ".ast");
-      Adjusted.push_back(std::string(PCHFile));
-      SourcesToMerge.push_back(std::string(PCHFile));
-    } else {
-      Adjusted.push_back(mOutputFilename);
-      SourcesToMerge.push_back(mOutputFilename);
+    int Result = 0;
+    for (std::size_t I = 0, EI = NoASTSources.size(); I < EI; ++I) {
+      SourcesToMerge.insert(SourcesToMerge.end(), EmittedFiles[I].begin(),
+                            EmittedFiles[I].end());
+      Result = Result ? Result : Results[I];
     }
-    return Adjusted;
+    return Result;
   };
-  EmitPCHTool.appendArgumentsAdjuster(ArgumentsAdjuster);
   if (mEmitAST) {
     if (!mOutputFilename.empty() && NoASTSources.size() > 1) {
       errs() << "WARNING: The -o (output filename) option is ignored when "
                 "generating multiple output files.\n";
       mOutputFilename.clear();
     }
-    return EmitPCHTool.run(
-        newActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
+    return emitAST();
   }
   if (!mOutputFilename.empty())
     errs() << "WARNING: The -o (output filename) option is ignored when "
@@ -747,15 +907,13 @@ int Tool::run(QueryManager *QM) {
   // analysis. AST files will be stored in SourcesToMerge collection.
   // If an input file already contains Clang AST it will be pushed into
   // the SourcesToMerge collection only.
-  if (mMergeAST) {
-    EmitPCHTool.run(
-        newActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
-  }
+  if (mMergeAST)
+    emitAST();
   if (!QM) {
     if (mEmitLLVM)
       QM = getEmitLLVMQM();
     else if (mInstrLLVM)
-      QM = getInstrLLVMQM(mInstrEntry, mInstrStart);
+      QM = getInstrLLVMQM(mInstrEntry, mInstrStart, mInstrLoopRanges);
     else if (mTfmPass)
       QM = getTransformationQM(mTfmPass, mGlobalOpts);
     else if (mCheck)
@@ -771,22 +929,26 @@ int Tool::run(QueryManager *QM) {
     if (mDumpAST)
       return CTool.run(
           newActionFactory<tsar::ASTDumpAction, tsar::ASTMergeAction>(
-              std::forward_as_tuple(), std::forward_as_tuple(SourcesToMerge))
+              std::forward_as_tuple(),
+              std::forward_as_tuple(SourcesToMerge, mGlobalOpts.NumThreads))
               .get());
     if (mPrintAST)
       return CTool.run(
           newActionFactory<tsar::ASTPrintAction, tsar::ASTMergeAction>(
-              std::forward_as_tuple(), std::forward_as_tuple(SourcesToMerge))
+              std::forward_as_tuple(),
+              std::forward_as_tuple(SourcesToMerge, mGlobalOpts.NumThreads))
               .get());
     if (!ImportInfoStorage)
       return CTool.run(newActionFactory<MainAction, tsar::ASTMergeAction>(
                            std::forward_as_tuple(mCommandLine, QM),
-                           std::forward_as_tuple(SourcesToMerge))
+                           std::forward_as_tuple(SourcesToMerge,
+                                                 mGlobalOpts.NumThreads))
                            .get());
     return CTool.run(
         newActionFactory<MainAction, ASTMergeActionWithInfo>(
             std::forward_as_tuple(mCommandLine, QM),
-            std::forward_as_tuple(SourcesToMerge, ImportInfoStorage))
+            std::forward_as_tuple(SourcesToMerge, ImportInfoStorage,
+                                  mGlobalOpts.NumThreads))
             .get());
   }
   ClangTool CTool(*mCompilations, NoLLSources);
@@ -36,6 +36,9 @@
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Sema/SemaDiagnostic.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <future>
 
 using namespace clang;
 using namespace llvm;
@@ -65,6 +68,37 @@ public:
 };
 }
 
+namespace {
+/// This stores diagnostics to report them later.
+class StoreDiagnosticConsumer : public DiagnosticConsumer {
+public:
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    mDiags.emplace_back(Level, Info);
+  }
+
+  std::vector<StoredDiagnostic> takeDiagnostics() {
+    return std::move(mDiags);
+  }
+
+private:
+  std::vector<StoredDiagnostic> mDiags;
+};
+
+/// AST unit which may be loaded in a separate thread.
+///
+/// Each unit has its own diagnostics engine, which stores diagnostics until
+/// the unit is imported. So, a diagnostic consumer of the compiler instance
+/// is accessed from the importing thread only.
+struct PendingUnit {
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags;
+  StoreDiagnosticConsumer *Stored = nullptr;
+  std::unique_ptr<ASTUnit> Unit;
+  std::shared_future<void> Loaded;
+};
+}
+
 namespace tsar {
 /// This is implementation of ASTImporter for the general use in analyzer.
 class GeneralImporter : public ASTImporter {
@@ -267,16 +301,60 @@ void ASTMergeAction::ExecuteAction() {
   // successfully loaded. However this leads to assertion fail when deferred
   // locations f will be emitted by CodeGenModule::EmitDeferred().
   CI.getASTContext().getTranslationUnitDecl()->decls_begin();
+  // AST files are loaded in parallel with import of already loaded units.
+  // Import itself is sequential because it updates the single AST context.
+  // Note, that the pool must be destroyed before the list of pending units.
+  std::vector<PendingUnit> Units(mASTFiles.size());
+  auto Strategy = hardware_concurrency(mNumThreads);
+  auto NumThreads = Strategy.compute_thread_count();
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads > 1 && Units.size() > 1)
+    Pool = std::make_unique<ThreadPool>(Strategy);
+  unsigned NextToLoad = 0;
+  auto prefetch = [&CI, &Units, &Pool, &NextToLoad, this](unsigned Limit) {
+    for (Limit = std::min<unsigned>(Limit, Units.size()); NextToLoad < Limit;
+         ++NextToLoad) {
+      auto &P = Units[NextToLoad];
+      // Do not share reference counted diagnostic IDs and options between
+      // threads, counters are not thread-safe.
+      P.Stored = new StoreDiagnosticConsumer;
+      P.Diags = new DiagnosticsEngine(new DiagnosticIDs,
+        new DiagnosticOptions(CI.getDiagnosticOpts()), P.Stored,
+        /*ShouldOwnClient=*/true);
+      auto Load = [&P, &CI, &File = mASTFiles[NextToLoad]]() {
+        P.Unit = ASTUnit::LoadFromASTFile(File, CI.getPCHContainerReader(),
+          ASTUnit::LoadEverything, P.Diags, CI.getFileSystemOpts(), false);
+      };
+      if (Pool)
+        P.Loaded = Pool->async(std::move(Load));
+      else
+        Load();
+    }
+  };
   for (unsigned I = 0, N = mASTFiles.size(); I != N; ++I) {
-    IntrusiveRefCntPtr<DiagnosticsEngine>
-      Diags(new DiagnosticsEngine(DiagIDs, &CI.getDiagnosticOpts(),
-        new ForwardingDiagnosticConsumer(
-          *CI.getDiagnostics().getClient()), /*ShouldOwnClient=*/true));
-    std::unique_ptr<ASTUnit> Unit =
-      ASTUnit::LoadFromASTFile(mASTFiles[I], CI.getPCHContainerReader(),
-        ASTUnit::LoadEverything, Diags, CI.getFileSystemOpts(), false);
-    if (!Unit)
+    prefetch(I + (Pool ? NumThreads : 1));
+    auto &P = Units[I];
+    if (P.Loaded.valid())
+      P.Loaded.wait();
+    std::unique_ptr<ASTUnit> Unit = std::move(P.Unit);
+    IntrusiveRefCntPtr<DiagnosticsEngine> Diags = std::move(P.Diags);
+    auto StoredDiags = P.Stored->takeDiagnostics();
+    if (!Unit) {
+      // Source manager of the unit is not available, so diagnostics are
+      // reported without locations.
+      IntrusiveRefCntPtr<DiagnosticsEngine>
+        LoadDiags(new DiagnosticsEngine(DiagIDs, &CI.getDiagnosticOpts(),
+          new ForwardingDiagnosticConsumer(
+            *CI.getDiagnostics().getClient()), /*ShouldOwnClient=*/true));
+      for (auto &SD : StoredDiags)
+        LoadDiags->Report(
+          StoredDiagnostic(SD.getLevel(), SD.getID(), SD.getMessage()));
       continue;
+    }
+    Diags->setClient(new ForwardingDiagnosticConsumer(
+      *CI.getDiagnostics().getClient()), /*ShouldOwnClient=*/true);
+    for (auto &SD : StoredDiags)
+      Diags->Report(SD);
     std::unique_ptr<ASTImporter> Importer(
       newImporter(CI.getASTContext(), CI.getFileManager(),
         Unit->getASTContext(), Unit->getFileManager(), /*MinimalImport=*/false));
@@ -365,9 +443,9 @@ bool ASTMergeAction::BeginSourceFileAction(CompilerInstance &CI) {
 
 ASTMergeAction::ASTMergeAction(
     std::unique_ptr<clang::FrontendAction> WrappedAction,
-    clang::ArrayRef<std::string> ASTFiles) :
+    clang::ArrayRef<std::string> ASTFiles, unsigned NumThreads) :
   PublicWrapperFrontendAction(WrappedAction.release()),
-  mASTFiles(ASTFiles.begin(), ASTFiles.end()) {}
+  mASTFiles(ASTFiles.begin(), ASTFiles.end()), mNumThreads(NumThreads) {}
 }
 
 INITIALIZE_PASS(ImmutableASTImportInfoPass, "clang-import-info",
@@ -0,0 +1,297 @@
+//===--- TraceProfiler.cpp ---- Trace Event Profiler ------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a profiler which writes events in Chrome trace-event
+// format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Support/TraceProfiler.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/DebugLoc.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+# include <windows.h>
+# include <psapi.h>
+#elif defined(LLVM_ON_UNIX)
+# include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+# include <malloc.h>
+#endif
+
+using namespace llvm;
+using namespace tsar;
+
+namespace {
+/// Period of sampling of memory usage.
+constexpr std::chrono::milliseconds MemorySamplePeriod(10);
+
+/// Return number of bytes allocated in heap.
+///
+/// Unlike sys::Process::GetMallocUsage() this also takes into account large
+/// blocks which are allocated with mmap() by glibc.
+uint64_t getHeapUsage() {
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  auto Info = mallinfo2();
+  return Info.uordblks + Info.hblkhd;
+#elif defined(__GLIBC__)
+  auto Info = mallinfo();
+  return static_cast<unsigned>(Info.uordblks) +
+         static_cast<unsigned>(Info.hblkhd);
+#else
+  return sys::Process::GetMallocUsage();
+#endif
+}
+
+/// Return peak resident set size in bytes (0 if it is not available).
+uint64_t getPeakRSS() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS Counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+    return Counters.PeakWorkingSetSize;
+  return 0;
+#elif defined(LLVM_ON_UNIX)
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+# if defined(__APPLE__)
+  return Usage.ru_maxrss;
+# else
+  return static_cast<uint64_t>(Usage.ru_maxrss) * 1024;
+# endif
+#else
+  return 0;
+#endif
+}
+
+struct TraceEvent {
+  std::string Name;
+  std::string Detail;
+  uint64_t Tid;
+  std::chrono::microseconds Start;
+  std::chrono::microseconds Duration;
+  /// Change of heap usage of the whole process (not only of the current
+  /// thread) between the beginning and the end of an event.
+  int64_t ProcessHeapDelta;
+  /// Peak resident set size of the whole process at the end of an event.
+  uint64_t ProcessPeakRSS;
+};
+
+struct MemorySample {
+  std::chrono::microseconds Time;
+  uint64_t Heap;
+  uint64_t PeakRSS;
+};
+
+class TraceProfiler {
+public:
+  explicit TraceProfiler(unsigned Granularity)
+      : mStart(std::chrono::steady_clock::now()), mGranularity(Granularity) {
+    mSampler = std::thread([this]() {
+      std::unique_lock<std::mutex> Lock(mSamplerLock);
+      do {
+        sample();
+      } while (!mSamplerStop.wait_for(Lock, MemorySamplePeriod,
+                                      [this]() { return mIsStopped; }));
+    });
+  }
+
+  ~TraceProfiler() { stop(); }
+
+  /// Stop sampling of memory usage.
+  void stop() {
+    if (!mSampler.joinable())
+      return;
+    {
+      std::lock_guard<std::mutex> Lock(mSamplerLock);
+      mIsStopped = true;
+    }
+    mSamplerStop.notify_one();
+    mSampler.join();
+    sample();
+  }
+
+  std::chrono::microseconds
+  getTime(std::chrono::steady_clock::time_point T) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(T - mStart);
+  }
+
+  void record(TraceEvent &&E) {
+    if (static_cast<uint64_t>(E.Duration.count()) < mGranularity)
+      return;
+    std::lock_guard<std::mutex> Lock(mEventsLock);
+    mEvents.push_back(std::move(E));
+  }
+
+  void write(raw_ostream &OS, StringRef LLVMTrace);
+
+private:
+  void sample() {
+    MemorySample S{getTime(std::chrono::steady_clock::now()), getHeapUsage(),
+                   getPeakRSS()};
+    std::lock_guard<std::mutex> Lock(mEventsLock);
+    mSamples.push_back(S);
+  }
+
+  std::chrono::steady_clock::time_point mStart;
+  unsigned mGranularity;
+  std::mutex mEventsLock;
+  std::vector<TraceEvent> mEvents;
+  std::vector<MemorySample> mSamples;
+  std::thread mSampler;
+  std::mutex mSamplerLock;
+  std::condition_variable mSamplerStop;
+  bool mIsStopped = false;
+};
+
+void TraceProfiler::write(raw_ostream &OS, StringRef LLVMTrace) {
+  json::OStream J(OS);
+  J.object([&]() {
+    J.attributeArray("traceEvents", [&]() {
+      // Events from LLVM time trace profiler (passes and functions). Use
+      // the same process identifier to show all events on the same track.
+      int64_t Pid = 1;
+      if (!LLVMTrace.empty()) {
+        auto Trace = json::parse(LLVMTrace);
+        if (!Trace) {
+          consumeError(Trace.takeError());
+        } else if (auto *Obj = Trace->getAsObject()) {
+          if (auto *Events = Obj->getArray("traceEvents"))
+            for (auto &E : *Events) {
+              if (auto *EventObj = E.getAsObject())
+                if (auto EventPid = EventObj->getInteger("pid"))
+                  Pid = *EventPid;
+              J.value(E);
+            }
+        }
+      }
+      std::lock_guard<std::mutex> Lock(mEventsLock);
+      for (auto &E : mEvents)
+        J.object([&]() {
+          J.attribute("pid", Pid);
+          J.attribute("tid", static_cast<int64_t>(E.Tid));
+          J.attribute("ph", "X");
+          J.attribute("ts", static_cast<int64_t>(E.Start.count()));
+          J.attribute("dur", static_cast<int64_t>(E.Duration.count()));
+          J.attribute("name", E.Name);
+          J.attributeObject("args", [&]() {
+            if (!E.Detail.empty())
+              J.attribute("detail", E.Detail);
+            J.attribute("process-heap-delta", E.ProcessHeapDelta);
+            J.attribute("process-peak-rss",
+                        static_cast<int64_t>(E.ProcessPeakRSS));
+          });
+        });
+      for (auto &S : mSamples)
+        J.object([&]() {
+          J.attribute("pid", Pid);
+          J.attribute("ph", "C");
+          J.attribute("ts", static_cast<int64_t>(S.Time.count()));
+          J.attribute("name", "Process Memory");
+          J.attributeObject("args", [&]() {
+            J.attribute("heap", static_cast<int64_t>(S.Heap));
+            J.attribute("peak-rss", static_cast<int64_t>(S.PeakRSS));
+          });
+        });
+    });
+  });
+}
+
+std::unique_ptr<TraceProfiler> Profiler;
+std::atomic<TraceProfiler *> ProfilerInstance{nullptr};
+}
+
+void tsar::traceProfilerInitialize(unsigned Granularity, StringRef ProcName) {
+  assert(!Profiler && "Profiler has been already initialized!");
+  timeTraceProfilerInitialize(Granularity, ProcName);
+  Profiler = std::make_unique<TraceProfiler>(Granularity);
+  ProfilerInstance = Profiler.get();
+}
+
+bool tsar::isTraceProfilerEnabled() { return ProfilerInstance != nullptr; }
+
+Error tsar::traceProfilerWrite(StringRef Filename) {
+  assert(Profiler && "Profiler must be initialized!");
+  ProfilerInstance = nullptr;
+  Profiler->stop();
+  SmallString<0> LLVMTrace;
+  if (timeTraceProfilerEnabled()) {
+    raw_svector_ostream LLVMOS(LLVMTrace);
+    timeTraceProfilerWrite(LLVMOS);
+    timeTraceProfilerCleanup();
+  }
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, sys::fs::OF_Text);
+  if (EC) {
+    Profiler.reset();
+    return createFileError(Filename, EC);
+  }
+  Profiler->write(OS, LLVMTrace);
+  Profiler.reset();
+  return Error::success();
+}
+
+std::string tsar::getTraceDetail(const Loop &L) {
+  std::string Detail;
+  raw_string_ostream OS(Detail);
+  OS << L.getHeader()->getParent()->getName();
+  if (DebugLoc Loc = L.getStartLoc()) {
+    OS << " at ";
+    Loc.print(OS);
+  }
+  return OS.str();
+}
+
+void TraceScope::begin(StringRef Name, std::string Detail) {
+  mIsActive = true;
+  mName = Name.str();
+  mDetail = std::move(Detail);
+  mProcessHeap = getHeapUsage();
+  mStart = std::chrono::steady_clock::now();
+}
+
+void TraceScope::end() {
+  auto End = std::chrono::steady_clock::now();
+  auto *P = ProfilerInstance.load();
+  if (!P)
+    return;
+  auto Start = P->getTime(mStart);
+  P->record({std::move(mName), std::move(mDetail), get_threadid(), Start,
+             P->getTime(End) - Start,
+             static_cast<int64_t>(getHeapUsage()) -
+                 static_cast<int64_t>(mProcessHeap),
+             getPeakRSS()});
+}
@@ -24,13 +24,18 @@
 
 #include "tsar/Analysis/AnalysisServer.h"
 #include "tsar/Analysis/DFRegionInfo.h"
+#include "tsar/Analysis/KnownFunctionTraits.h"
+#include "tsar/Analysis/Clang/ASTDependenceAnalysis.h"
 #include "tsar/Analysis/Clang/CanonicalLoop.h"
+#include "tsar/Analysis/Clang/DIMemoryMatcher.h"
 #include "tsar/Analysis/Clang/RegionDirectiveInfo.h"
 #include "tsar/Analysis/Clang/MemoryMatcher.h"
 #include "tsar/Analysis/Clang/PerfectLoop.h"
+#include "tsar/Analysis/Memory/ClonedDIMemoryMatcher.h"
 #include "tsar/Analysis/Memory/DIArrayAccess.h"
 #include "tsar/Analysis/Memory/DIDependencyAnalysis.h"
 #include "tsar/Analysis/Memory/DIEstimateMemory.h"
+#include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/MemoryTraitUtils.h"
 #include "tsar/Analysis/Memory/PassAAProvider.h"
 #include "tsar/Analysis/Parallel/ParallelLoop.h"
@@ -38,6 +43,8 @@
 #include "tsar/Analysis/PrintUtils.h"
 #include "tsar/Core/Query.h"
 #include "tsar/Core/TransformationContext.h"
+#include "tsar/Frontend/Clang/Pragma.h"
+#include "tsar/Frontend/Clang/TransformationContext.h"
 #include "tsar/Support/Clang/Diagnostic.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/IRUtils.h"
@@ -45,20 +52,30 @@
 #include "tsar/Transform/Clang/Passes.h"
 #include "tsar/Unparse/Utils.h"
 #include <clang/AST/ASTContext.h>
+#include <clang/AST/ParentMapContext.h>
+#include <llvm/ADT/BitVector.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/IntEqClasses.h>
 #include <llvm/ADT/iterator.h>
+#include <llvm/ADT/MapVector.h>
 #include <llvm/ADT/Optional.h>
 #include <llvm/ADT/SmallSet.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/Sequence.h>
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/ThreadPool.h>
 #include <bcl/utility.h>
 #include <bcl/Json.h>
 #include <lp_solve/lp_lib.h>
+#include <cmath>
+#include <mutex>
+#include <set>
 
 #undef max
 #undef min
@@ -66,6 +83,12 @@
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "clang-dvmh-parallel"
 
+STATISTIC(NumMILPComponents, "Number of independent components of MILP model");
+STATISTIC(NumMILPOptimal, "Number of optimally solved components");
+STATISTIC(NumMILPSuboptimal, "Number of suboptimally solved components");
+STATISTIC(NumMILPFailed, "Number of components without solution");
+STATISTIC(NumDVMHParallel, "Number of inserted DVMH parallel directives");
+
 using namespace tsar;
 using namespace llvm;
 
@@ -131,6 +154,195 @@ static inline MILPColumnT getFreeColumn() {
   return (*FreeColumn)++;
 }
 
+/// Description of a MILP model which does not depend on a solver.
+///
+/// Columns are numbered starting from 1 (as in lp_solve).
+class MILPModel {
+public:
+  struct Column {
+    std::string Name;
+    bool IsInt = false;
+    bool IsBinary = false;
+    MILPValueT Lower = 0;
+    /// Upper bound is infinite if it is not specified.
+    Optional<MILPValueT> Upper;
+    /// Coefficient of the column in the objective function.
+    MILPValueT Cost = 0;
+  };
+
+  struct Constraint {
+    SmallVector<MILPColumnT, 5> Columns;
+    SmallVector<MILPValueT, 5> Multipliers;
+    int Type;
+    MILPValueT Constant;
+  };
+
+  /// Columns and constraints which do not share constraints with other ones.
+  struct Component {
+    std::vector<MILPColumnT> Columns;
+    std::vector<unsigned> Constraints;
+  };
+
+  explicit MILPModel(MILPColumnT NumberOfColumns)
+      : mColumns(NumberOfColumns + 1) {}
+
+  Column &operator[](MILPColumnT C) {
+    assert(C > 0 && C < (MILPColumnT)mColumns.size() && "Unknown column!");
+    return mColumns[C];
+  }
+
+  const Column &operator[](MILPColumnT C) const {
+    assert(C > 0 && C < (MILPColumnT)mColumns.size() && "Unknown column!");
+    return mColumns[C];
+  }
+
+  MILPColumnT getNumColumns() const { return mColumns.size() - 1; }
+
+  const Constraint &getConstraint(unsigned Idx) const {
+    return mConstraints[Idx];
+  }
+
+  void addConstraint(ArrayRef<MILPColumnT> Columns,
+                     ArrayRef<MILPValueT> Multipliers, int Type,
+                     MILPValueT Constant) {
+    assert(!Columns.empty() && Columns.size() == Multipliers.size() &&
+           "Each column must have a multiplier!");
+    mConstraints.push_back({{Columns.begin(), Columns.end()},
+                            {Multipliers.begin(), Multipliers.end()}, Type,
+                            Constant});
+  }
+
+  /// Split the model into independent connected components.
+  std::vector<Component> partition() const {
+    IntEqClasses Classes(mColumns.size());
+    for (auto &C : mConstraints)
+      for (auto Column : drop_begin(C.Columns, 1))
+        Classes.join(C.Columns.front(), Column);
+    Classes.compress();
+    std::vector<Component> Components(Classes.getNumClasses());
+    for (MILPColumnT C = 1, EC = mColumns.size(); C < EC; ++C)
+      Components[Classes[C]].Columns.push_back(C);
+    for (unsigned I = 0, EI = mConstraints.size(); I < EI; ++I)
+      Components[Classes[mConstraints[I].Columns.front()]]
+          .Constraints.push_back(I);
+    // Remove a class which contains unused column 0.
+    erase_if(Components, [](const Component &C) { return C.Columns.empty(); });
+    return Components;
+  }
+
+private:
+  std::vector<Column> mColumns;
+  std::vector<Constraint> mConstraints;
+};
+
+/// Solution of a component of MILP model.
+struct MILPSolution {
+  /// Status returned by lp_solve.
+  int Status = NOFEASFOUND;
+  /// Values of columns in the order of columns in the component.
+  std::vector<MILPValueT> Values;
+  long long NumNodes = 0;
+  /// Time (in seconds) spent to solve the component.
+  double Time = 0;
+};
+
+/// Solve a specified component of a model.
+///
+/// The solver minimizes the sum of costs of columns (Column::Cost), so
+/// the solution describes the cheapest shadow edges and remote accesses.
+///
+/// \param [in] Timeout Time limit in seconds, 0 means no limit.
+/// \return Solution, `NOMEMORY` status means that lp_solve model can not be
+/// created.
+MILPSolution solveComponent(const MILPModel &Model,
+                            const MILPModel::Component &Component,
+                            unsigned Timeout) {
+  MILPSolution Solution;
+  // Use values which are closest to zero as an initial guess, so solver
+  // starts from a solution without shadow edges and remote accesses.
+  SmallVector<MILPValueT, 16> Guess(Component.Columns.size() + 1, 0);
+  for (std::size_t Idx = 0, EIdx = Component.Columns.size(); Idx < EIdx;
+       ++Idx) {
+    auto &C = Model[Component.Columns[Idx]];
+    Guess[Idx + 1] = std::max(C.Lower, std::min<MILPValueT>(
+                                           0, C.Upper ? *C.Upper : 0));
+  }
+  if (Component.Constraints.empty()) {
+    Solution.Status = OPTIMAL;
+    Solution.Values.assign(Guess.begin() + 1, Guess.end());
+    return Solution;
+  }
+  lprec *LP = make_lp(0, Component.Columns.size());
+  if (!LP) {
+    Solution.Status = NOMEMORY;
+    return Solution;
+  }
+  DenseMap<MILPColumnT, MILPColumnT> ToLocal;
+  SmallVector<MILPColumnT, 16> CostColumns;
+  SmallVector<MILPValueT, 16> Costs;
+  bool IsOk = true;
+  for (std::size_t Idx = 0, EIdx = Component.Columns.size(); Idx < EIdx;
+       ++Idx) {
+    MILPColumnT Local = Idx + 1;
+    ToLocal.try_emplace(Component.Columns[Idx], Local);
+    auto &C = Model[Component.Columns[Idx]];
+    if (C.Cost != 0) {
+      CostColumns.push_back(Local);
+      Costs.push_back(C.Cost);
+    }
+    if (!C.Name.empty())
+      set_col_name(LP, Local, const_cast<char *>(C.Name.c_str()));
+    if (C.IsBinary)
+      IsOk &= set_binary(LP, Local, TRUE) == TRUE;
+    else
+      IsOk &= set_int(LP, Local, C.IsInt ? TRUE : FALSE) == TRUE &&
+              set_bounds(LP, Local, C.Lower,
+                         C.Upper ? *C.Upper : get_infinite(LP)) == TRUE;
+  }
+  // Objective function must be set before constraints are added in row mode.
+  IsOk &= set_obj_fnex(LP, CostColumns.size(), Costs.data(),
+                       CostColumns.data()) == TRUE;
+  set_add_rowmode(LP, TRUE);
+  SmallVector<MILPColumnT, 5> Columns;
+  for (auto Idx : Component.Constraints) {
+    auto &C = Model.getConstraint(Idx);
+    Columns.clear();
+    for (auto Column : C.Columns)
+      Columns.push_back(ToLocal[Column]);
+    IsOk &= addConstraintex(LP, Columns, C.Multipliers, C.Type, C.Constant) ==
+            TRUE;
+  }
+  set_add_rowmode(LP, FALSE);
+  if (!IsOk) {
+    delete_lp(LP);
+    Solution.Status = NOMEMORY;
+    return Solution;
+  }
+  set_minim(LP);
+  set_verbose(LP, NEUTRAL);
+  if (Timeout > 0)
+    set_timeout(LP, Timeout);
+  std::vector<int> Basis(1 + get_Nrows(LP) + get_Ncolumns(LP));
+  if (guess_basis(LP, Guess.data(), Basis.data()))
+    set_basis(LP, Basis.data(), TRUE);
+  LLVM_DEBUG({
+    // Components are solved concurrently, so do not mix their dumps.
+    static std::mutex DumpLock;
+    std::lock_guard<std::mutex> Lock(DumpLock);
+    write_LP(LP, stderr);
+  });
+  Solution.Status = ::solve(LP);
+  Solution.NumNodes = get_total_nodes(LP);
+  Solution.Time = time_elapsed(LP);
+  if (Solution.Status == OPTIMAL || Solution.Status == SUBOPTIMAL ||
+      Solution.Status == PRESOLVED) {
+    Solution.Values.resize(Component.Columns.size());
+    get_variables(LP, Solution.Values.data());
+  }
+  delete_lp(LP);
+  return Solution;
+}
+
 class ShadowRange {
 public:
   ShadowRange() = default;
@@ -163,29 +375,8 @@ private:
   SmallVector<APInt, 8> mShadows;
 };
 
+/// Constant terms B of accesses A * I + B which have the same multiplier A.
 struct RemoteData {
-  struct MILPShadow {
-    MILPColumnT Column;
-    MILPColumnT ChoiceColumn;
-  };
-
-  struct MILPRemote {
-    MILPColumnT Column;
-    MILPColumnT InverseColumn;
-  };
-
-  RemoteData() {
-    Remote.Column = getFreeColumn();
-    Remote.InverseColumn = getFreeColumn();
-    Left.Column = getFreeColumn();
-    Left.ChoiceColumn = getFreeColumn();
-    Right.Column = getFreeColumn();
-    Right.ChoiceColumn = getFreeColumn();
-  }
-
-  MILPShadow Left;
-  MILPShadow Right;
-  MILPRemote Remote;
   ShadowRange Shadows;
 };
 
@@ -196,8 +387,10 @@ public:
     return BitWidth;
   }
 
-  DimensionAccessBase(unsigned Dimension, MILPColumnT DimensionID)
-      : mColumn(DimensionID), mDimension(Dimension) {}
+  DimensionAccessBase(unsigned Dimension, MILPColumnT LeftShadowID,
+                      MILPColumnT RightShadowID)
+      : mLeftShadow(LeftShadowID), mRightShadow(RightShadowID),
+        mDimension(Dimension) {}
 
   void add(const APInt &Constant, bool IsWrite) {
     auto B = Constant.sextOrSelf(BitWidth);
@@ -312,7 +505,7 @@ public:
   }
 
   bool hasConstantAccess() const noexcept {
-    return mConstantAccesses.empty();
+    return !mConstantAccesses.empty();
   }
 
   void setUnknownAccess(bool IsWrite) noexcept {
@@ -362,13 +555,19 @@ public:
   auto loop_size() const { return mLoops.size(); }
   auto loop_empty() const { return mLoops.empty(); }
 
-  MILPColumnT getDimensionID() const noexcept { return mColumn; }
+  /// Return MILP column which contains width of the left shadow edge.
+  MILPColumnT getLeftShadowID() const noexcept { return mLeftShadow; }
+
+  /// Return MILP column which contains width of the right shadow edge.
+  MILPColumnT getRightShadowID() const noexcept { return mRightShadow; }
+
   unsigned getDimension() const noexcept { return mDimension; }
 
   const auto &getWrite() const noexcept { return mWrite; }
 
 private:
-  MILPColumnT mColumn;
+  MILPColumnT mLeftShadow;
+  MILPColumnT mRightShadow;
   unsigned mDimension;
 
   /// Dimension bounds which enclose all accesses in the analyzed region.
@@ -406,16 +605,27 @@ private:
   Optional<AffineAccess> mWrite;
 };
 
+/// Alignment I -> A * I + B of a loop from a parallel nest with a dimension
+/// of an array which is specified in the 'on' clause.
+struct LoopMapping {
+  unsigned LoopIdx;
+  unsigned Dimension;
+  APInt Multiplier;
+  APInt Constant;
+};
+
 template<unsigned BitWidth = 64>
 class ParallelNestAccessBase {
-  using LoopList =
-      SmallVector<bcl::tagged_tuple<bcl::tagged<ObjectID, Loop>,
-                                    bcl::tagged<APInt, trait::Induction>,
-                                    bcl::tagged<DebugLoc, DebugLoc>,
-                                    bcl::tagged<MILPColumnT, MILPColumnT>>,
-                  4>;
+  using LoopList = SmallVector<
+      bcl::tagged_tuple<bcl::tagged<ObjectID, Loop>,
+                        bcl::tagged<APInt, trait::Induction>,
+                        bcl::tagged<DebugLoc, DebugLoc>,
+                        bcl::tagged<clang::ForStmt *, clang::ForStmt>,
+                        bcl::tagged<clang::VarDecl *, clang::VarDecl>>,
+      4>;
 public:
   using DimensionAccess = DimensionAccessBase<64>;
+  using TraitInfo = ClangDependenceAnalyzer::ASTRegionTraitInfo;
 
 private:
   using LoopAccessMap = DenseMap<
@@ -488,7 +698,23 @@ public:
     return DimItr == I->get<DimensionAccess>().end() ? nullptr : &*DimItr;
   }
 
-  auto array_insert(DIMemory *DIM) { return mAccesses.try_emplace(DIM); }
+  auto array_insert(DIMemory *DIM) {
+    auto Info = mAccesses.try_emplace(DIM);
+    if (Info.second)
+      mRemotes.try_emplace(DIM, getFreeColumn());
+    return Info;
+  }
+
+  /// Return MILP column which determines whether a specified array is
+  /// accessed remotely.
+  MILPColumnT getRemoteID(DIMemory *DIM) const {
+    auto I = mRemotes.find(DIM);
+    assert(I != mRemotes.end() && "Array must be accessed in the nest!");
+    return I->second;
+  }
+
+  void markWritten(DIMemory *DIM) { mWritten.insert(DIM); }
+  bool isWritten(DIMemory *DIM) const { return mWritten.count(DIM); }
 
   auto array_begin() { return mAccesses.begin(); }
   auto array_end() { return mAccesses.end(); }
@@ -505,22 +731,176 @@ public:
   const APInt &getOuterCount() const noexcept { return mOuterCount; }
   void setOuterCount(const APInt &OuterCount) { mOuterCount = OuterCount; }
 
+  /// Return traits of variables in the outermost loop of the nest.
+  const TraitInfo &getTraits() const noexcept { return mTraits; }
+  void setTraits(const TraitInfo &Traits) { mTraits = Traits; }
+
+  /// Return basic blocks of the outermost loop of the nest.
+  ArrayRef<BasicBlock *> getBlocks() const noexcept { return mBlocks; }
+  void setBlocks(ArrayRef<BasicBlock *> Blocks) {
+    mBlocks.assign(Blocks.begin(), Blocks.end());
+  }
+
+  /// Return an array which is specified in the 'on' clause or nullptr if
+  /// the nest is not mapped on distributed data.
+  DIMemory *getOnArray() const noexcept { return mOnArray; }
+
+  /// Return alignment of loops with the distributed dimensions of the
+  /// array which is specified in the 'on' clause.
+  ArrayRef<LoopMapping> getMapping() const noexcept { return mMapping; }
+
+  void setMapping(DIMemory *OnArray, ArrayRef<LoopMapping> Mapping) {
+    mOnArray = OnArray;
+    mMapping.assign(Mapping.begin(), Mapping.end());
+  }
+
+  void resetMapping() {
+    mOnArray = nullptr;
+    mMapping.clear();
+  }
+
 private:
   APInt mOuterCount;
   Function *mFunc = nullptr;
   LoopList mLoops;
   LoopAccessMap mAccesses;
+  DenseMap<DIMemory *, MILPColumnT> mRemotes;
+  SmallPtrSet<DIMemory *, 4> mWritten;
+  TraitInfo mTraits;
+  SmallVector<BasicBlock *, 16> mBlocks;
+  DIMemory *mOnArray = nullptr;
+  SmallVector<LoopMapping, 4> mMapping;
 };
 
 using ParallelNestAccess = ParallelNestAccessBase<64>;
 using DimensionAccess = ParallelNestAccess::DimensionAccess;
 
+/// Return number of elements in a dimension which are accessed in a nest.
+MILPValueT getExtent(const DimensionAccess &DimAccess) {
+  auto Bounds = DimAccess.getBounds();
+  if (Bounds.first.sgt(Bounds.second))
+    return 1;
+  return (Bounds.second - Bounds.first).roundToDouble(true) + 1;
+}
+
+/// Block distribution of a local array.
+struct ArrayDistribution {
+  /// Declaration of the array in a source code.
+  clang::DeclStmt *Decl = nullptr;
+  /// Memory which is allocated for the array.
+  AllocaInst *Alloca = nullptr;
+  /// Number of elements in each dimension.
+  SmallVector<uint64_t, 4> Extents;
+  /// Distributed dimensions in ascending order.
+  SmallVector<unsigned, 4> Dims;
+};
+
+/// Return true if a specified memory is privatizable or is a reduction
+/// variable in a nest.
+bool isPrivate(const ParallelNestAccess &Nest, const DIMemory &M) {
+  auto *DIEM = dyn_cast<DIEstimateMemory>(&M);
+  if (!DIEM)
+    return false;
+  auto Name = DIEM->getVariable()->getName().str();
+  auto &Traits = Nest.getTraits();
+  return Traits.get<trait::Private>().count(Name) ||
+         any_of(Traits.get<trait::Reduction>(),
+                [&Name](auto &Vars) { return Vars.count(Name); });
+}
+
+/// Return true if all loads and stores from a specified memory are located in
+/// specified basic blocks and the memory does not escape.
+bool isAccessedOnlyIn(const AllocaInst &AI,
+                      const SmallPtrSetImpl<const BasicBlock *> &Blocks) {
+  SmallVector<const Value *, 8> Worklist{&AI};
+  SmallPtrSet<const Value *, 8> Visited;
+  while (!Worklist.empty()) {
+    auto *V = Worklist.pop_back_val();
+    if (!Visited.insert(V).second)
+      continue;
+    for (auto *U : V->users()) {
+      if (isa<GetElementPtrInst>(U) || isa<BitCastInst>(U)) {
+        Worklist.push_back(U);
+        continue;
+      }
+      if (auto *II = dyn_cast<IntrinsicInst>(U))
+        if (isDbgInfoIntrinsic(II->getIntrinsicID()) ||
+            isMemoryMarkerIntrinsic(II->getIntrinsicID()))
+          continue;
+      auto *I = dyn_cast<Instruction>(U);
+      if (!I || !isa<LoadInst>(I) &&
+                    !(isa<StoreInst>(I) &&
+                      cast<StoreInst>(I)->getPointerOperand() == V))
+        return false;
+      if (!Blocks.count(I->getParent()))
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Insert a pragma before a statement which starts at a specified location.
+///
+/// The pragma is placed at the start of a line if there is no code before
+/// the statement on the same line, otherwise a new line is started.
+void insertPragma(clang::SourceLocation Loc, StringRef Pragma,
+                  clang::Rewriter &Rewriter) {
+  auto &SrcMgr = Rewriter.getSourceMgr();
+  auto DecLoc = SrcMgr.getDecomposedLoc(Loc);
+  auto StartOfLine = SrcMgr.translateLineCol(
+      DecLoc.first, SrcMgr.getLineNumber(DecLoc.first, DecLoc.second), 1);
+  StringRef Prefix(SrcMgr.getCharacterData(StartOfLine),
+                   DecLoc.second - SrcMgr.getFileOffset(StartOfLine));
+  if (Prefix.trim().empty())
+    Rewriter.InsertTextBefore(StartOfLine, Pragma);
+  else
+    Rewriter.InsertTextBefore(Loc, ("\n" + Pragma).str());
+}
+
+/// Add clauses for all reduction variables from a specified list to
+/// the end of a pragma.
+void addReductionIfNeed(
+    const ClangDependenceAnalyzer::ReductionVarListT &VarInfoList,
+    SmallVectorImpl<char> &PragmaStr) {
+  for (unsigned I = trait::Reduction::RK_First,
+                EI = trait::Reduction::RK_NumberOf;
+       I < EI; ++I) {
+    if (VarInfoList[I].empty())
+      continue;
+    StringRef RedKind;
+    switch (static_cast<trait::Reduction::Kind>(I)) {
+    case trait::Reduction::RK_Add: RedKind = "sum"; break;
+    case trait::Reduction::RK_Mult: RedKind = "product"; break;
+    case trait::Reduction::RK_Or: RedKind = "or"; break;
+    case trait::Reduction::RK_And: RedKind = "and"; break;
+    case trait::Reduction::RK_Xor: RedKind = "xor"; break;
+    case trait::Reduction::RK_Max: RedKind = "max"; break;
+    case trait::Reduction::RK_Min: RedKind = "min"; break;
+    default: llvm_unreachable("Unknown reduction kind!"); break;
+    }
+    auto Name = getName(ClauseId::DvmParallelReduction);
+    PragmaStr.push_back(' ');
+    PragmaStr.append(Name.begin(), Name.end());
+    PragmaStr.push_back('(');
+    for (auto VarItr = VarInfoList[I].begin(), VarItrE = VarInfoList[I].end();
+         VarItr != VarItrE; ++VarItr) {
+      if (VarItr != VarInfoList[I].begin())
+        PragmaStr.push_back(',');
+      PragmaStr.append(RedKind.begin(), RedKind.end());
+      PragmaStr.push_back('(');
+      PragmaStr.append(VarItr->begin(), VarItr->end());
+      PragmaStr.push_back(')');
+    }
+    PragmaStr.push_back(')');
+  }
+}
+
 using ClangParallelProvider =
     FunctionPassAAProvider<AnalysisSocketImmutableWrapper, LoopInfoWrapperPass,
                            ParallelLoopPass, MemoryMatcherImmutableWrapper,
                            TransformationEnginePass, DIEstimateMemoryPass,
                            CanonicalLoopPass, DFRegionInfoPass,
-                           ClangPerfectLoopPass>;
+                           ClangPerfectLoopPass, ClangDIMemoryMatcherPass>;
 
 class ClangDVMHParallelization : public ModulePass, bcl::Uncopyable {
 public:
@@ -542,6 +922,8 @@ public:
     mSocketInfo = nullptr;
     mArrayAccesses = nullptr;
     mParallelNests.clear();
+    mDistribution.clear();
+    mSolution.clear();
     *FreeColumn = 1;
     mWeights = trait::Weights{};
   }
@@ -571,6 +953,35 @@ private:
     return APInt::getNullValue(ParallelNestAccess::getBitWidth());
   }
 
+  /// Determine traits of variables in a specified loop at the source level.
+  Optional<ParallelNestAccess::TraitInfo>
+  analyzeDependence(Function &F, ObjectID LoopID, clang::ForStmt &For,
+                    const ClangParallelProvider &Provider) {
+    auto &Socket = mSocketInfo->getActive()->second;
+    auto RM = Socket.getAnalysis<AnalysisClientServerMatcherWrapper,
+                                 ClonedDIMemoryMatcherWrapper>();
+    auto RF =
+        Socket.getAnalysis<DIEstimateMemoryPass, DIDependencyAnalysisPass>(F);
+    assert(RM && RF && "Dependence analysis must be available!");
+    auto &ClientToServer = **RM->value<AnalysisClientServerMatcherWrapper *>();
+    auto ServerLoopID = cast<MDNode>(*ClientToServer.getMappedMD(LoopID));
+    auto &DIAT = RF->value<DIEstimateMemoryPass *>()->getAliasTree();
+    auto &DIDepInfo =
+        RF->value<DIDependencyAnalysisPass *>()->getDependencies();
+    auto DIDepSet = DIDepInfo[ServerLoopID];
+    auto *ServerF = cast<Function>(ClientToServer[&F]);
+    auto *DIMemoryMatcher =
+        (**RM->value<ClonedDIMemoryMatcherWrapper *>())[*ServerF];
+    assert(DIMemoryMatcher && "Cloned memory matcher must not be null!");
+    auto &ASTToClient = Provider.get<ClangDIMemoryMatcherPass>().getMatcher();
+    ClangDependenceAnalyzer RegionAnalysis(
+        &For, *mGlobalOpts, mTfmCtx->getContext().getDiagnostics(), DIAT,
+        DIDepSet, *DIMemoryMatcher, ASTToClient);
+    if (!RegionAnalysis.evaluateDependency())
+      return None;
+    return RegionAnalysis.getDependenceInfo();
+  }
+
   template <typename ItrT>
   void findParallelNests(ItrT I, ItrT EI, const APInt &OuterCount,
       const ClangParallelProvider &Provider) {
@@ -588,7 +999,28 @@ private:
   void findParallelNests(Loop &L, const APInt &OuterCount,
       const ClangParallelProvider &Provider, ParallelNestAccess &Nest);
 
+  /// Check whether a specified array can be distributed: it must be a local
+  /// array with constant extents which has a separate declaration.
+  ///
+  /// \return Description of the array without distributed dimensions.
+  Optional<ArrayDistribution> getDistributionCandidate(DIMemory &M,
+                                                       unsigned NumberOfDims);
+
+  /// Map parallel nests on arrays which are written in them and choose
+  /// distributed dimensions of these arrays.
+  void distributeArrays();
+
+  /// Remove distributions of arrays which are accessed outside mapped
+  /// nests or are privatizable in some of them, reset mapping of nests
+  /// on such arrays.
+  void updateDistribution();
+
   void printParallelNests(raw_ostream &OS) const;
+  void printSolution(const MILPModel &Model, raw_ostream &OS) const;
+
+  /// Insert DVMH directives for parallel nests, values of columns which are
+  /// marked in `Solved` are taken from the solution of MILP model.
+  void insertDirectives(const BitVector &Solved);
 
   tsar::TransformationContext *mTfmCtx = nullptr;
   const tsar::GlobalOptions *mGlobalOpts = nullptr;
@@ -599,7 +1031,12 @@ private:
   tsar::DIArrayAccessInfo *mArrayAccesses = nullptr;
   SmallVector<const tsar::OptimizationRegion *, 4> mRegions;
   std::vector<ParallelNestAccess> mParallelNests;
+  MapVector<DIMemory *, ArrayDistribution> mDistribution;
   trait::Weights mWeights;
+
+  /// Values of MILP columns (shadow widths and remote accesses) which have
+  /// been chosen by the solver.
+  std::vector<MILPValueT> mSolution;
 };
 
 class ClangParallelizationInfo final : public tsar::PassGroupInfo {
@@ -709,9 +1146,51 @@ void ClangDVMHParallelization::findParallelNests(Loop &L,
       findParallelNests(L.begin(), L.end(), OuterCount * TripCount, Provider);
     return;
   }
+  auto *For = (**CanonicalItr).getASTLoop();
+  auto InductionItr =
+      mMemoryMatcher->Matcher.find<IR>((**CanonicalItr).getInduction());
+  if (!For || InductionItr == mMemoryMatcher->Matcher.end()) {
+    LLVM_DEBUG(ignoreLoopLog(
+        L, "unable to find the loop and its induction in a source code"));
+    if (Nest.empty())
+      findParallelNests(L.begin(), L.end(), OuterCount * TripCount, Provider);
+    return;
+  }
+  // Variables which require clauses other than 'private' and 'reduction'
+  // are not supported yet.
+  auto Traits = analyzeDependence(F, LoopID, *For, Provider);
+  if (!Traits || Traits->get<trait::Induction>().empty() ||
+      !Traits->get<trait::FirstPrivate>().empty() ||
+      !Traits->get<trait::LastPrivate>().empty() ||
+      !Traits->get<trait::Dependence>().empty()) {
+    LLVM_DEBUG(ignoreLoopLog(L, "the loop has unsupported traits"));
+    if (Nest.empty())
+      findParallelNests(L.begin(), L.end(), OuterCount * TripCount, Provider);
+    return;
+  }
+  if (Nest.empty()) {
+    Nest.setTraits(*Traits);
+    Nest.setBlocks(L.getBlocks());
+  } else {
+    // Clauses are specified for the whole nest, so they are taken from
+    // the outermost loop.
+    auto &OuterTraits = Nest.getTraits();
+    if (!std::includes(OuterTraits.get<trait::Private>().begin(),
+                       OuterTraits.get<trait::Private>().end(),
+                       Traits->get<trait::Private>().begin(),
+                       Traits->get<trait::Private>().end()) ||
+        OuterTraits.get<trait::Reduction>() !=
+            Traits->get<trait::Reduction>()) {
+      LLVM_DEBUG(ignoreLoopLog(
+          L, "traits of the loop differ from traits of the outermost loop"));
+      return;
+    }
+  }
   Nest.push_back();
   Nest.back().get<Loop>() = LoopID;
   Nest.back().get<DebugLoc>() = L.getStartLoc();
+  Nest.back().get<clang::ForStmt>() = For;
+  Nest.back().get<clang::VarDecl>() = InductionItr->get<AST>();
   Nest.back().get<trait::Induction>() = TripCount;
   SmallPtrSet<DIMemory *, 8> HasUnknownAccess;
   for (auto &Access : mArrayAccesses->scope_accesses(LoopID)) {
@@ -737,11 +1216,13 @@ void ClangDVMHParallelization::findParallelNests(Loop &L,
         continue;
       }
     auto ArrayInfo = Nest.array_insert(Access.getArray());
+    if (!Access.isReadOnly())
+      Nest.markWritten(Access.getArray());
     if (ArrayInfo.second) {
       ArrayInfo.first->get<DimensionAccess>().reserve(Access.size());
       for (auto Dim : seq(0u, (unsigned)Access.size()))
-        ArrayInfo.first->get<DimensionAccess>().emplace_back(Dim,
-                                                             getFreeColumn());
+        ArrayInfo.first->get<DimensionAccess>().emplace_back(
+            Dim, getFreeColumn(), getFreeColumn());
     } else {
       unsigned PrevNumberOfDims =
           ArrayInfo.first->get<DimensionAccess>().size();
@@ -751,7 +1232,7 @@ void ClangDVMHParallelization::findParallelNests(Loop &L,
           ArrayInfo.first->get<DimensionAccess>().reserve(CurrNumberOfDims);
           for (auto Dim : seq(PrevNumberOfDims, CurrNumberOfDims))
             ArrayInfo.first->get<DimensionAccess>().emplace_back(
-                Dim, getFreeColumn());
+                Dim, getFreeColumn(), getFreeColumn());
           std::swap(PrevNumberOfDims, CurrNumberOfDims);
         }
         for (auto I = CurrNumberOfDims; I < PrevNumberOfDims; ++I)
@@ -793,13 +1274,173 @@ void ClangDVMHParallelization::findParallelNests(Loop &L,
         DimAccess.setUnknownAccess(false);
     }
   }
-  Nest.back().get<MILPColumnT>() = getFreeColumn();
   Nest.setOuterCount(OuterCount);
   auto &PI = Provider.get<ClangPerfectLoopPass>().getPerfectLoopInfo();
   if (!L.empty() && PI.count(DFL))
     findParallelNests(**L.begin(), OuterCount, Provider, Nest);
 }
 
+Optional<ArrayDistribution>
+ClangDVMHParallelization::getDistributionCandidate(DIMemory &M,
+                                                   unsigned NumberOfDims) {
+  auto *DIEM = dyn_cast<DIEstimateMemory>(&M);
+  if (!DIEM)
+    return None;
+  auto *DILV = dyn_cast<DILocalVariable>(DIEM->getVariable());
+  if (!DILV || DILV->isParameter())
+    return None;
+  auto *DITy = dyn_cast_or_null<DICompositeType>(stripDIType(DILV->getType()));
+  if (!DITy || DITy->getTag() != dwarf::DW_TAG_array_type)
+    return None;
+  ArrayDistribution Distr;
+  for (auto *El : DITy->getElements()) {
+    auto *Range = dyn_cast_or_null<DISubrange>(El);
+    if (!Range)
+      return None;
+    auto Count = getConstantCount(*Range);
+    if (!Count)
+      return None;
+    Distr.Extents.push_back(*Count);
+  }
+  if (Distr.Extents.size() != NumberOfDims)
+    return None;
+  for (auto VH : *DIEM) {
+    if (!VH || isa<UndefValue>(VH))
+      continue;
+    auto *I = dyn_cast<Instruction>(VH);
+    if (!I)
+      return None;
+    Distr.Alloca = dyn_cast<AllocaInst>(
+        stripPointer(I->getModule()->getDataLayout(), I));
+    break;
+  }
+  if (!Distr.Alloca)
+    return None;
+  auto MatchItr = mMemoryMatcher->Matcher.find<IR>(Distr.Alloca);
+  if (MatchItr == mMemoryMatcher->Matcher.end())
+    return None;
+  // A directive is inserted before the declaration, so the declaration
+  // must not declare other variables.
+  auto Parents = mTfmCtx->getContext().getParentMapContext().getParents(
+      *MatchItr->get<AST>());
+  if (Parents.empty())
+    return None;
+  Distr.Decl = const_cast<clang::DeclStmt *>(
+      Parents.begin()->get<clang::DeclStmt>());
+  if (!Distr.Decl || !Distr.Decl->isSingleDecl() ||
+      Distr.Decl->getBeginLoc().isMacroID())
+    return None;
+  return Distr;
+}
+
+void ClangDVMHParallelization::distributeArrays() {
+  auto &Diags = mTfmCtx->getContext().getDiagnostics();
+  SmallPtrSet<DIMemory *, 8> NotDistributable;
+  for (auto &Nest : mParallelNests) {
+    auto *For = Nest.front().get<clang::ForStmt>();
+    if (For->getBeginLoc().isMacroID()) {
+      toDiag(Diags, For->getBeginLoc(), tsar::diag::warn_parallel_loop);
+      toDiag(Diags, For->getBeginLoc(),
+             tsar::diag::note_apc_insert_macro_prevent);
+      continue;
+    }
+    // The nest is mapped on the only shared array which is written in it.
+    DIMemory *OnArray = nullptr;
+    bool IsOk = true;
+    for (auto &Array : Nest.arrays()) {
+      if (!Nest.isWritten(Array.get<DIMemory>()) ||
+          isPrivate(Nest, *Array.get<DIMemory>()))
+        continue;
+      if (OnArray) {
+        IsOk = false;
+        break;
+      }
+      OnArray = Array.get<DIMemory>();
+    }
+    if (!IsOk || !OnArray || NotDistributable.count(OnArray))
+      continue;
+    auto &Dims = Nest.find_array(OnArray)->get<DimensionAccess>();
+    // Each loop is aligned with a dimension which is written in this loop.
+    SmallVector<LoopMapping, 4> Mapping;
+    for (auto &DimAccess : Dims) {
+      if (DimAccess.hasWriteConflict()) {
+        IsOk = false;
+        break;
+      }
+      auto &Write = DimAccess.getWrite();
+      if (!Write)
+        continue;
+      auto LoopItr = Nest.find(Write->LoopID);
+      unsigned LoopIdx = std::distance(Nest.begin(), LoopItr);
+      if (LoopItr == Nest.end() || any_of(Mapping, [LoopIdx](auto &Map) {
+            return Map.LoopIdx == LoopIdx;
+          })) {
+        IsOk = false;
+        break;
+      }
+      Mapping.push_back({LoopIdx, DimAccess.getDimension(), Write->Multiplier,
+                         Write->Constant});
+    }
+    if (!IsOk || Mapping.empty())
+      continue;
+    auto DistrItr = mDistribution.find(OnArray);
+    if (DistrItr == mDistribution.end()) {
+      auto Distr = getDistributionCandidate(*OnArray, Dims.size());
+      if (!Distr) {
+        NotDistributable.insert(OnArray);
+        continue;
+      }
+      // The first nest determines distributed dimensions.
+      for (auto &Map : Mapping)
+        Distr->Dims.push_back(Map.Dimension);
+      DistrItr = mDistribution.insert(std::make_pair(OnArray, *Distr)).first;
+    } else if (DistrItr->second.Dims.size() != Mapping.size() ||
+               any_of(seq<std::size_t>(0, Mapping.size()),
+                      [&DistrItr, &Mapping](std::size_t I) {
+                        return DistrItr->second.Dims[I] !=
+                               Mapping[I].Dimension;
+                      })) {
+      continue;
+    }
+    Nest.setMapping(OnArray, Mapping);
+  }
+  updateDistribution();
+}
+
+void ClangDVMHParallelization::updateDistribution() {
+  bool IsChanged = true;
+  while (IsChanged) {
+    IsChanged = false;
+    SmallPtrSet<DIMemory *, 8> Removed;
+    DenseMap<const Function *, SmallPtrSet<const BasicBlock *, 32>> Blocks;
+    for (auto &Nest : mParallelNests) {
+      if (!Nest.getOnArray())
+        continue;
+      if (!mDistribution.count(Nest.getOnArray())) {
+        Nest.resetMapping();
+        continue;
+      }
+      Blocks[&Nest.getFunction()].insert(Nest.getBlocks().begin(),
+                                         Nest.getBlocks().end());
+      // Distributed arrays can not be privatized.
+      for (auto &Array : Nest.arrays())
+        if (mDistribution.count(Array.get<DIMemory>()) &&
+            isPrivate(Nest, *Array.get<DIMemory>()))
+          Removed.insert(Array.get<DIMemory>());
+    }
+    // Distributed arrays can be accessed in mapped nests only.
+    for (auto &Distr : mDistribution)
+      if (!isAccessedOnlyIn(*Distr.second.Alloca,
+                            Blocks[Distr.second.Alloca->getFunction()]))
+        Removed.insert(Distr.first);
+    if (!Removed.empty()) {
+      mDistribution.remove_if(
+          [&Removed](auto &Distr) { return Removed.count(Distr.first); });
+      IsChanged = true;
+    }
+  }
+}
+
 bool ClangDVMHParallelization::runOnModule(llvm::Module &M) {
   releaseMemory();
   mTfmCtx = getAnalysis<TransformationEnginePass>().getContext(M);
@@ -847,132 +1488,326 @@ bool ClangDVMHParallelization::runOnModule(llvm::Module &M) {
   LLVM_DEBUG(dbgs() << "[DVMH PARALLEL]: number of collected parallel nests "
                     << mParallelNests.size() << "\n");
   LLVM_DEBUG(printParallelNests(dbgs()));
+  distributeArrays();
+  LLVM_DEBUG(dbgs() << "[DVMH PARALLEL]: number of distributed arrays "
+                    << mDistribution.size() << "\n");
   auto NumberOfColumns = (*FreeColumn) - 1;
   LLVM_DEBUG(dbgs() << "[DVMH PARALLEL]: maximum number of columns in solver "
                     << NumberOfColumns << "\n");
   milp::BinomialSystem<MILPColumnT, int64_t, 1, 1, 1> LinearSystem;
-  lprec *LP = nullptr;
-  if (!(LP = make_lp(0, NumberOfColumns))) {
-    M.getContext().emitError("unable to create linear programming model");
-    return false;
-  }
-  set_add_rowmode(LP, TRUE);
-  auto emitError = [&M, LP](const Twine &Msg) {
-    M.getContext().emitError(Msg);
-    delete_lp(LP);
-  };
+  MILPModel Model(NumberOfColumns);
   for (auto &Nest : mParallelNests) {
+    if (!Nest.getOnArray())
+      continue;
     auto DWLang = getLanguage(Nest.getFunction());
     if (!DWLang) {
-      emitError("unable to determine the source language for '" +
-                Nest.getFunction().getName() + "' function");
+      M.getContext().emitError(
+          "unable to determine the source language for '" +
+          Nest.getFunction().getName() + "' function");
       return false;
     }
-    for (auto &L : Nest) {
-      SmallString<32> ColumnName;
-      raw_svector_ostream OS(ColumnName);
-      OS << "L.";
-      if (L.get<DebugLoc>())
-        tsar::print(OS, L.get<DebugLoc>(), true);
-      else
-        OS << L.get<MILPColumnT>();
-      set_col_name(LP, L.get<MILPColumnT>(),
-                   const_cast<char *>(ColumnName.c_str()));
-      if (!set_int(LP, L.get<MILPColumnT>(), TRUE) ||
-          !set_bounds(LP, L.get<MILPColumnT>(), 0,
-                      L.get<trait::Induction>().getSExtValue())) {
-        emitError("unable to set bounds for " + OS.str());
-        return false;
-      }
-    }
+    SmallString<32> NestName;
+    raw_svector_ostream NestNameOS(NestName);
+    if (Nest.front().get<DebugLoc>())
+      tsar::print(NestNameOS, Nest.front().get<DebugLoc>(), true);
+    else
+      NestNameOS << Nest.getRemoteID(Nest.getOnArray());
+    auto &OnDistr = mDistribution[Nest.getOnArray()];
+    // Transfers are performed each time the nest is executed.
+    auto OuterCount = Nest.getOuterCount().roundToDouble();
+    auto &HW = mWeights[trait::Weights::Hardware];
     for (auto &Array : Nest.arrays()) {
-      SmallString<32> DimensionName;
-      raw_svector_ostream DimensionNameOS(DimensionName);
-      printDILocationSource(*DWLang, *Array.get<DIMemory>(), DimensionNameOS);
-      auto DimensionNameSize = DimensionName.size();
+      // Arrays which are not distributed are not written in the nest and
+      // they are available on each processor.
+      auto DistrItr = mDistribution.find(Array.get<DIMemory>());
+      if (DistrItr == mDistribution.end())
+        continue;
+      auto &Distr = DistrItr->second;
+      SmallString<32> ArrayName;
+      raw_svector_ostream ArrayNameOS(ArrayName);
+      printDILocationSource(*DWLang, *Array.get<DIMemory>(), ArrayNameOS);
+      // Estimate time (in nanoseconds) to transfer an element of the array.
+      MILPValueT ElementBits = 64;
+      if (auto *DIEM = dyn_cast<DIEstimateMemory>(Array.get<DIMemory>()))
+        if (auto *ElTy = arrayElementDIType(DIEM->getVariable()->getType()))
+          if (ElTy->getSizeInBits() > 0)
+            ElementBits = ElTy->getSizeInBits();
+      MILPValueT ElementCost =
+          ElementBits / HW[trait::Hardware::Bandwidth] * 1e9;
+      MILPValueT NumberOfElements = 1;
+      for (auto &DimAccess : Array.get<DimensionAccess>())
+        NumberOfElements *= getExtent(DimAccess);
+      // Remote access transfers all elements of the array and shadow edge
+      // transfers hyperplanes which are orthogonal to a distributed
+      // dimension.
+      auto RemoteID = Nest.getRemoteID(Array.get<DIMemory>());
+      auto &Remote = Model[RemoteID];
+      Remote.Name = ("R." + ArrayName + "." + NestName).str();
+      Remote.IsBinary = true;
+      Remote.Cost = OuterCount * (HW[trait::Hardware::Latency] * 1e9 +
+                                  NumberOfElements * ElementCost);
+      // Elements of the array are located on the same processors as
+      // corresponding elements of the 'on' array if distributed dimensions
+      // of these arrays have the same extents.
+      bool IsRemote =
+          Distr.Dims.size() != OnDistr.Dims.size() ||
+          any_of(seq<std::size_t>(0, Distr.Dims.size()),
+                 [&Distr, &OnDistr](std::size_t I) {
+                   return Distr.Extents[Distr.Dims[I]] !=
+                          OnDistr.Extents[OnDistr.Dims[I]];
+                 });
       for (auto &DimAccess : Array.get<DimensionAccess>()) {
-        DimensionName.resize(DimensionNameSize);
-        DimensionNameOS << "." << DimAccess.getDimension();
-        set_col_name(LP, DimAccess.getDimensionID(),
-          const_cast<char *>(DimensionName.c_str()));
-        if (!set_int(LP, DimAccess.getDimensionID(), TRUE) ||
-            !set_bounds(LP, DimAccess.getDimensionID(),
-                        DimAccess.getBounds().first.getSExtValue(),
-                        DimAccess.getBounds().second.getSExtValue())) {
-          emitError("unable to set bounds for " + DimensionName);
-          return false;
+        MILPValueT ShadowCost = OuterCount * ElementCost * NumberOfElements /
+                                getExtent(DimAccess);
+        auto DimName = (ArrayName + "." + Twine(DimAccess.getDimension()) +
+                        "." + NestName)
+                           .str();
+        auto &Left = Model[DimAccess.getLeftShadowID()];
+        Left.Name = "SL." + DimName;
+        Left.IsInt = true;
+        Left.Cost = ShadowCost;
+        auto &Right = Model[DimAccess.getRightShadowID()];
+        Right.Name = "SR." + DimName;
+        Right.IsInt = true;
+        Right.Cost = ShadowCost;
+        if (IsRemote)
+          continue;
+        // Each processor stores all elements of a dimension which is not
+        // distributed.
+        auto DistrDimItr = find(Distr.Dims, DimAccess.getDimension());
+        if (DistrDimItr == Distr.Dims.end())
+          continue;
+        if (DimAccess.hasConstantAccess() ||
+            DimAccess.hasUnknownAccess(map_range(
+                Nest, [](auto &L) { return L.template get<Loop>(); }))) {
+          IsRemote = true;
+          continue;
         }
-        for (auto &LpAccess: DimAccess)
+        auto &Map = Nest.getMapping()[DistrDimItr - Distr.Dims.begin()];
+        auto MapLoopID = Nest[Map.LoopIdx].get<Loop>();
+        // Access A * I + B' to an element is local if it has the same
+        // multiplier as the 'on' clause A * I + B, the distance B' - B
+        // determines width of a shadow edge.
+        for (auto &LpAccess : DimAccess)
           for (auto &Access : LpAccess.get<RemoteData>()) {
-            auto LpInfoItr = Nest.find(LpAccess.get<Loop>());
-            SmallString<64> CurrentName;
-            raw_svector_ostream CurrentNameOS(CurrentName);
-            CurrentNameOS << DimensionName << "." << Access.first << "."
-                          << get_col_name(LP, LpInfoItr->get<MILPColumnT>());
-            auto initShadow = [&emitError, LP, &DimensionName, &Nest, &LpAccess,
-                               &Access](auto Shadow, const Twine &Prefix) {
-              SmallString<64> Name;
-              Prefix.toVector(Name);
-              set_col_name(LP, Shadow.Column, const_cast<char *>(Name.c_str()));
-              if (!set_int(LP, Shadow.Column, TRUE)) {
-                emitError("unable to set type for " + Name);
-                return false;
-              }
-              Name += ".F";
-              set_col_name(LP, Shadow.ChoiceColumn,
-                           const_cast<char *>(Name.c_str()));
-              if (!set_binary(LP, Shadow.ChoiceColumn, TRUE)) {
-                emitError("unable to set type for" + Name);
-                return false;
-              }
-            };
-            if (!initShadow(Access.second.Left, "SL." + CurrentName))
-              return false;
-            if (!initShadow(Access.second.Right, "SR." + CurrentName))
-              return false;
-            if (!addConstraintex(LP,
-                                 {Access.second.Left.ChoiceColumn,
-                                  Access.second.Right.ChoiceColumn},
-                                 {1, 1}, EQ, 1)) {
-              emitError(
-                  "unable to set constraints for the shadow choice flags");
-              return false;
-            }
-            set_col_name(
-                LP, Access.second.Remote.Column,
-                const_cast<char *>(("R." + CurrentName).str().c_str()));
-            if (!set_binary(LP, Access.second.Remote.Column, TRUE)) {
-              emitError("unable to set type for remote flag");
-              return false;
-            }
-            auto AlwaysFeasibleGuard =
-                DimAccess.getBounds().second -
-                (APIntOps::smin(Access.first * 0,
-                                Access.first *
-                                    LpInfoItr->get<trait::Induction>()) +
-                 DimAccess.getBounds().first);
-            auto Constant = AlwaysFeasibleGuard + DimAccess.getBounds().first;
-            if (!addConstraintex(
-                    LP,
-                    {DimAccess.getDimensionID(), LpInfoItr->get<MILPColumnT>(),
-                     Access.second.Left.Column, Access.second.Left.ChoiceColumn,
-                     Access.second.Remote.Column},
-                    {1, -1, -1, (double)(-AlwaysFeasibleGuard).getSExtValue(),
-                     (double)(-AlwaysFeasibleGuard).getSExtValue()},
-                    LE, Constant.getSExtValue())) {
-              emitError("unable to set 'less' constraint of the left shadow");
-              return false;
+            if (LpAccess.get<Loop>() != MapLoopID ||
+                Access.first != Map.Multiplier) {
+              IsRemote = true;
+              continue;
             }
+            auto LeftWidth =
+                (Map.Constant - Access.second.Shadows.min()).getSExtValue();
+            if (LeftWidth > 0)
+              Model.addConstraint({DimAccess.getLeftShadowID(), RemoteID},
+                                  {1, (MILPValueT)LeftWidth}, GE, LeftWidth);
+            auto RightWidth =
+                (Access.second.Shadows.max() - Map.Constant).getSExtValue();
+            if (RightWidth > 0)
+              Model.addConstraint({DimAccess.getRightShadowID(), RemoteID},
+                                  {1, (MILPValueT)RightWidth}, GE, RightWidth);
           }
       }
+      if (IsRemote)
+        Model.addConstraint({RemoteID}, {1}, GE, 1);
     }
   }
-  set_add_rowmode(LP, FALSE);
-  set_minim(LP);
-  LLVM_DEBUG(write_LP(LP, stderr));
+  // Arrays and loops which do not share constraints are independent, so
+  // solve each connected component of the model separately.
+  auto Components = Model.partition();
+  NumMILPComponents += Components.size();
+  LLVM_DEBUG(dbgs() << "[DVMH PARALLEL]: number of independent components "
+                    << Components.size() << "\n");
+  std::vector<MILPSolution> Solutions(Components.size());
+  {
+    ThreadPool Pool(hardware_concurrency(mGlobalOpts->NumThreads));
+    for (std::size_t I = 0, EI = Components.size(); I < EI; ++I)
+      Pool.async([&Model, &Components, &Solutions, I, this]() {
+        Solutions[I] = solveComponent(Model, Components[I],
+                                      mGlobalOpts->MILPTimeout);
+      });
+    Pool.wait();
+  }
+  mSolution.assign(NumberOfColumns + 1, 0);
+  BitVector Solved(NumberOfColumns + 1);
+  for (std::size_t I = 0, EI = Components.size(); I < EI; ++I) {
+    auto &Solution = Solutions[I];
+    LLVM_DEBUG(dbgs() << "[DVMH PARALLEL]: component " << I << ": columns "
+                      << Components[I].Columns.size() << ", rows "
+                      << Components[I].Constraints.size() << ", status "
+                      << Solution.Status << ", nodes " << Solution.NumNodes
+                      << ", time " << Solution.Time << "s\n");
+    if (Solution.Status == NOMEMORY) {
+      M.getContext().emitError("unable to create linear programming model");
+      return false;
+    }
+    if (Solution.Status == OPTIMAL || Solution.Status == PRESOLVED) {
+      ++NumMILPOptimal;
+    } else if (Solution.Status == SUBOPTIMAL) {
+      ++NumMILPSuboptimal;
+    } else {
+      ++NumMILPFailed;
+      continue;
+    }
+    for (std::size_t Idx = 0, EIdx = Components[I].Columns.size();
+         Idx < EIdx; ++Idx) {
+      mSolution[Components[I].Columns[Idx]] = Solution.Values[Idx];
+      Solved.set(Components[I].Columns[Idx]);
+    }
+  }
+  LLVM_DEBUG(printSolution(Model, dbgs()));
+  insertDirectives(Solved);
   return false;
 }
 
+void ClangDVMHParallelization::insertDirectives(const BitVector &Solved) {
+  // Nests may belong to components without solution, so they are not
+  // parallelized and arrays which are accessed in them are not distributed.
+  bool IsChanged = false;
+  for (auto &Nest : mParallelNests)
+    if (Nest.getOnArray() && any_of(Nest.arrays(), [this, &Nest,
+                                                    &Solved](auto &Array) {
+          return mDistribution.count(Array.template get<DIMemory>()) &&
+                 !Solved.test(Nest.getRemoteID(Array.template get<DIMemory>()));
+        })) {
+      Nest.resetMapping();
+      IsChanged = true;
+    }
+  if (IsChanged)
+    updateDistribution();
+  auto addClause = [](StringRef Name, const std::set<std::string> &List,
+                      SmallVectorImpl<char> &PragmaStr) {
+    if (List.empty())
+      return;
+    PragmaStr.push_back(' ');
+    PragmaStr.append(Name.begin(), Name.end());
+    PragmaStr.push_back('(');
+    auto I = List.begin(), EI = List.end();
+    PragmaStr.append(I->begin(), I->end());
+    for (++I; I != EI; ++I) {
+      PragmaStr.push_back(',');
+      PragmaStr.append(I->begin(), I->end());
+    }
+    PragmaStr.push_back(')');
+  };
+  auto &Rewriter = mTfmCtx->getRewriter();
+  // Widths of shadow edges which are necessary for distributed arrays.
+  DenseMap<DIMemory *, SmallVector<std::pair<long long, long long>, 4>>
+      ShadowWidths;
+  for (auto &Nest : mParallelNests) {
+    if (!Nest.getOnArray())
+      continue;
+    SmallString<128> PragmaStr;
+    getPragmaText(DirectiveId::DvmParallel, PragmaStr);
+    PragmaStr.pop_back();
+    // Add mapping of the nest on the distributed array, for example,
+    // ([i][j] on A[i][2*j+1]).
+    PragmaStr.push_back('(');
+    for (auto &L : Nest) {
+      PragmaStr.push_back('[');
+      PragmaStr += L.get<clang::VarDecl>()->getName();
+      PragmaStr.push_back(']');
+    }
+    PragmaStr += " on ";
+    PragmaStr +=
+        cast<DIEstimateMemory>(Nest.getOnArray())->getVariable()->getName();
+    auto &OnDistr = mDistribution[Nest.getOnArray()];
+    for (unsigned Dim = 0, DimE = OnDistr.Extents.size(); Dim < DimE; ++Dim) {
+      PragmaStr.push_back('[');
+      auto MapItr = find_if(Nest.getMapping(), [Dim](auto &Map) {
+        return Map.Dimension == Dim;
+      });
+      if (MapItr != Nest.getMapping().end()) {
+        auto A = MapItr->Multiplier.getSExtValue();
+        auto B = MapItr->Constant.getSExtValue();
+        if (A == -1)
+          PragmaStr.push_back('-');
+        else if (A != 1)
+          PragmaStr += std::to_string(A) + "*";
+        PragmaStr += Nest[MapItr->LoopIdx].get<clang::VarDecl>()->getName();
+        if (B > 0)
+          PragmaStr.push_back('+');
+        if (B != 0)
+          PragmaStr += std::to_string(B);
+      }
+      PragmaStr.push_back(']');
+    }
+    PragmaStr.push_back(')');
+    // Induction variables of parallel loops are private implicitly.
+    auto PrivateList = Nest.getTraits().get<trait::Private>();
+    for (auto &L : Nest)
+      PrivateList.erase(L.get<clang::VarDecl>()->getName().str());
+    addClause(getName(ClauseId::DvmParallelPrivate), PrivateList, PragmaStr);
+    addReductionIfNeed(Nest.getTraits().get<trait::Reduction>(), PragmaStr);
+    // Use sorted lists to obtain the same directives for different launches.
+    std::set<std::string> ShadowList, RemoteList;
+    for (auto &Array : Nest.arrays()) {
+      if (!mDistribution.count(Array.get<DIMemory>()))
+        continue;
+      auto Name = cast<DIEstimateMemory>(Array.get<DIMemory>())
+                      ->getVariable()
+                      ->getName();
+      // Remote access transfers the whole array, so shadow edges are
+      // not necessary.
+      if (mSolution[Nest.getRemoteID(Array.get<DIMemory>())] > 0.5) {
+        SmallString<32> Remote{Name};
+        for (unsigned I = 0, EI = Array.get<DimensionAccess>().size(); I < EI;
+             ++I)
+          Remote += "[]";
+        RemoteList.insert(std::string(Remote));
+        continue;
+      }
+      auto &Widths = ShadowWidths[Array.get<DIMemory>()];
+      Widths.resize(Array.get<DimensionAccess>().size());
+      bool HasShadow = false;
+      SmallString<32> Shadow{Name};
+      for (auto &DimAccess : Array.get<DimensionAccess>()) {
+        auto LeftWidth = std::llround(mSolution[DimAccess.getLeftShadowID()]);
+        auto RightWidth =
+            std::llround(mSolution[DimAccess.getRightShadowID()]);
+        HasShadow |= LeftWidth > 0 || RightWidth > 0;
+        auto &Width = Widths[DimAccess.getDimension()];
+        Width.first = std::max(Width.first, LeftWidth);
+        Width.second = std::max(Width.second, RightWidth);
+        Shadow += "[" + std::to_string(LeftWidth) + ":" +
+                  std::to_string(RightWidth) + "]";
+      }
+      if (HasShadow)
+        ShadowList.insert(std::string(Shadow));
+    }
+    addClause(getName(ClauseId::DvmParallelShadowRenew), ShadowList,
+              PragmaStr);
+    addClause(getName(ClauseId::DvmParallelRemoteAccess), RemoteList,
+              PragmaStr);
+    PragmaStr += "\n";
+    insertPragma(Nest.front().get<clang::ForStmt>()->getBeginLoc(), PragmaStr,
+                 Rewriter);
+    ++NumDVMHParallel;
+  }
+  for (auto &Distr : mDistribution) {
+    SmallString<128> PragmaStr;
+    getPragmaText(DirectiveId::DvmArray, PragmaStr);
+    PragmaStr.pop_back();
+    PragmaStr.push_back(' ');
+    PragmaStr += getName(ClauseId::DvmArrayDistribute);
+    for (unsigned Dim = 0, DimE = Distr.second.Extents.size(); Dim < DimE;
+         ++Dim)
+      PragmaStr += is_contained(Distr.second.Dims, Dim) ? "[block]" : "[]";
+    auto WidthItr = ShadowWidths.find(Distr.first);
+    if (WidthItr != ShadowWidths.end() &&
+        any_of(WidthItr->second, [](auto &Width) {
+          return Width.first > 0 || Width.second > 0;
+        })) {
+      PragmaStr.push_back(' ');
+      PragmaStr += getName(ClauseId::DvmShadow);
+      for (auto &Width : WidthItr->second)
+        PragmaStr += "[" + std::to_string(Width.first) + ":" +
+                     std::to_string(Width.second) + "]";
+    }
+    PragmaStr += "\n";
+    insertPragma(Distr.second.Decl->getBeginLoc(), PragmaStr, Rewriter);
+  }
+}
+
 void ClangDVMHParallelization::printParallelNests(raw_ostream &OS) const {
   for (auto &Nest : mParallelNests) {
     dbgs() << "Size of nest: " << Nest.size() << "\n";
@@ -983,7 +1818,8 @@ void ClangDVMHParallelization::printParallelNests(raw_ostream &OS) const {
       dbgs() << "\n";
       for (auto &DimAccess : Array.get<DimensionAccess>()) {
         dbgs() << "    Dimension " << DimAccess.getDimension() << "\n";
-        dbgs() << "      Dimension ID " << DimAccess.getDimensionID() << "\n";
+        dbgs() << "      Shadow IDs " << DimAccess.getLeftShadowID() << ", "
+               << DimAccess.getRightShadowID() << "\n";
         dbgs() << "      Unknown accesses: "
                << (DimAccess.hasUnknownAccess() ? "true" : "false") << "\n";
         dbgs() << "      Loop unknown accesses: "
@@ -998,7 +1834,8 @@ void ClangDVMHParallelization::printParallelNests(raw_ostream &OS) const {
                << (DimAccess.hasConstantAccess() ? "true" : "false") << "\n";
         dbgs() << "      Number of multipliers:\n";
         for (auto &L : Nest)
-          dbgs() << "        LoopID " << L.get<MILPColumnT>() << ": "
+          dbgs() << "        Loop " << L.get<clang::VarDecl>()->getName()
+                 << ": "
                  << DimAccess.numberOfMultipliers(L.get<Loop>()) << "\n";
         if (DimAccess.empty())
           continue;
@@ -1006,14 +1843,19 @@ void ClangDVMHParallelization::printParallelNests(raw_ostream &OS) const {
                << ", " << DimAccess.getBounds().second << "]\n";
         if (DimAccess.getWrite()) {
           dbgs() << "      Write access: " << DimAccess.getWrite()->Multiplier
-                 << " => " << DimAccess.getWrite()->Constant << " loop ID"
-                 << Nest.find(DimAccess.getWrite()->LoopID)->get<MILPColumnT>()
+                 << " => " << DimAccess.getWrite()->Constant << " loop "
+                 << Nest.find(DimAccess.getWrite()->LoopID)
+                        ->get<clang::VarDecl>()
+                        ->getName()
                  << "\n";
         }
         dbgs() << "      Accesses:\n";
         for (auto &LpAccess : DimAccess) {
-          dbgs() << "      Loop ID "
-                 << Nest.find(LpAccess.get<Loop>())->get<MILPColumnT>() << "\n";
+          dbgs() << "      Loop "
+                 << Nest.find(LpAccess.get<Loop>())
+                        ->get<clang::VarDecl>()
+                        ->getName()
+                 << "\n";
           for (auto &Access : LpAccess.get<RemoteData>())
             dbgs() << "      " << Access.first << " => ["
                    << Access.second.Shadows.min() << ", "
@@ -1024,6 +1866,13 @@ void ClangDVMHParallelization::printParallelNests(raw_ostream &OS) const {
   }
 }
 
+void ClangDVMHParallelization::printSolution(const MILPModel &Model,
+                                             raw_ostream &OS) const {
+  for (MILPColumnT C = 1, EC = Model.getNumColumns(); C <= EC; ++C)
+    if (!Model[C].Name.empty())
+      OS << "  " << Model[C].Name << " = " << mSolution[C] << "\n";
+}
+
 void ClangDVMHParallelization::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<ClangParallelProvider>();
   AU.addRequired<AnalysisSocketImmutableWrapper>();
@@ -1067,6 +1916,7 @@ INITIALIZE_PASS_DEPENDENCY(ParallelLoopPass)
 INITIALIZE_PASS_DEPENDENCY(ClangParallelProvider)
 INITIALIZE_PASS_DEPENDENCY(CanonicalLoopPass)
 INITIALIZE_PASS_DEPENDENCY(ClangPerfectLoopPass)
+INITIALIZE_PASS_DEPENDENCY(ClangDIMemoryMatcherPass)
 INITIALIZE_PASS_IN_GROUP_END(ClangDVMHParallelization, "clang-dvmh-parallel",
                              "DVMH-based Parallelization (Clang)", false, false,
                              TransformationQueryManager::getPassRegistry())
@@ -30,11 +30,14 @@
 #include <clang/AST/ASTContext.h>
 #include <clang/Basic/FileManager.h>
 #include <clang/Basic/SourceManager.h>
+#include <clang/Format/Format.h>
 #include <clang/Lex/Lexer.h>
 #include <clang/Rewrite/Core/Rewriter.h>
+#include <clang/Tooling/Core/Replacement.h>
 #include <llvm/ADT/SmallString.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
 #include <vector>
 
 using namespace clang;
@@ -44,6 +47,118 @@ using namespace tsar;
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "ast-format"
 
+namespace {
+/// Source file which has to be reformatted.
+///
+/// Each line of an original file is mapped to a region of transformed source.
+/// A region of the K-th line starts at Regions[K], text inserted before the
+/// next line belongs to the region of the K-th line. So, region of a line can
+/// be replaced in the rewrite buffer with a single call to ReplaceText().
+struct FormatInfo {
+  FileID FID;
+  RewriteBuffer *Buffer = nullptr;
+  std::string TfmSrc;
+  std::string Filename;
+  /// Offsets of lines in an original file, the last offset is the file size.
+  std::vector<unsigned> Lines;
+  /// Offsets of line regions in a transformed source, the last offset is
+  /// the size of the transformed source.
+  std::vector<unsigned> Regions;
+  /// Regions which differ from an original source.
+  std::vector<tooling::Range> Ranges;
+  tooling::Replacements Replaces;
+};
+
+/// Compute regions of original lines in a transformed source and collect
+/// modified regions.
+void collectChangedRanges(StringRef OrigSrc, FormatInfo &Info) {
+  if (!OrigSrc.empty())
+    Info.Lines.push_back(0);
+  for (std::size_t I = 0, EI = OrigSrc.size(); I + 1 < EI; ++I)
+    if (OrigSrc[I] == '\n')
+      Info.Lines.push_back(I + 1);
+  Info.Lines.push_back(OrigSrc.size());
+  Info.Regions.reserve(Info.Lines.size());
+  for (auto Offset : Info.Lines)
+    Info.Regions.push_back(Info.Buffer->getMappedOffset(Offset, true));
+  StringRef TfmSrc(Info.TfmSrc);
+  // Text inserted at the beginning of a file does not belong to any line,
+  // so it can be formatted only together with the first line.
+  bool IsPrevChanged = Info.Regions.front() > 0;
+  if (IsPrevChanged)
+    Info.Ranges.emplace_back(0, Info.Regions.front());
+  for (std::size_t K = 0, EK = Info.Lines.size() - 1; K < EK; ++K) {
+    auto RegionSize = Info.Regions[K + 1] - Info.Regions[K];
+    bool IsChanged =
+        TfmSrc.substr(Info.Regions[K], RegionSize) !=
+        OrigSrc.substr(Info.Lines[K], Info.Lines[K + 1] - Info.Lines[K]);
+    if (!IsChanged) {
+      IsPrevChanged = false;
+      continue;
+    }
+    if (IsPrevChanged)
+      Info.Ranges.back() = tooling::Range(
+          Info.Ranges.back().getOffset(),
+          Info.Ranges.back().getLength() + RegionSize);
+    else
+      Info.Ranges.emplace_back(Info.Regions[K], RegionSize);
+    IsPrevChanged = true;
+  }
+}
+
+/// Apply formatting changes to a rewrite buffer.
+///
+/// Changes are grouped by lines of an original file. For each group, text of
+/// lines which contain changes is replaced, so unchanged lines are not
+/// rewritten. Changes in the text inserted at the beginning of a file
+/// are ignored because they do not belong to any line.
+void applyReplacements(const FormatInfo &Info) {
+  auto LastLine = Info.Lines.size() - 1;
+  auto RegionsEnd = Info.Regions.begin() + LastLine;
+  auto getLine = [&Info, RegionsEnd](unsigned Offset) -> int {
+    return std::upper_bound(Info.Regions.begin(), RegionsEnd, Offset) -
+           Info.Regions.begin() - 1;
+  };
+  struct LineChanges {
+    unsigned First;
+    unsigned Last;
+    SmallVector<const tooling::Replacement *, 4> Replaces;
+  };
+  SmallVector<LineChanges, 16> Changes;
+  for (auto &R : Info.Replaces) {
+    auto First = getLine(R.getOffset());
+    if (First < 0)
+      continue;
+    auto Last = R.getLength() == 0
+                    ? First
+                    : getLine(R.getOffset() + R.getLength() - 1);
+    if (!Changes.empty() && (unsigned)First <= Changes.back().Last) {
+      Changes.back().Last = std::max<unsigned>(Changes.back().Last, Last);
+    } else {
+      Changes.emplace_back();
+      Changes.back().First = First;
+      Changes.back().Last = Last;
+    }
+    Changes.back().Replaces.push_back(&R);
+  }
+  // Process changes in reverse order, so mapping of earlier lines to
+  // a transformed source is not affected by the replacements.
+  for (auto &C : reverse(Changes)) {
+    auto Start = Info.Regions[C.First];
+    auto End = Info.Regions[C.Last + 1];
+    std::string NewText;
+    auto Pos = Start;
+    for (auto *R : C.Replaces) {
+      NewText.append(Info.TfmSrc, Pos, R->getOffset() - Pos);
+      NewText += R->getReplacementText();
+      Pos = R->getOffset() + R->getLength();
+    }
+    NewText.append(Info.TfmSrc, Pos, End - Pos);
+    Info.Buffer->ReplaceText(Info.Lines[C.First], End - Start, NewText);
+  }
+}
+}
+
 bool tsar::formatSourceAndPrepareToRelease(
     const GlobalOptions &GlobalOpts, ClangTransformationContext &TfmCtx,
     const FilenameAdjuster &Adjuster) {
@@ -55,6 +170,7 @@ bool tsar::formatSourceAndPrepareToRelease(
   StringSet<> TransformedFiles;
 #endif
   bool IsAllValid{true};
+  std::vector<FormatInfo> ToFormat;
   for (auto &Buffer :
        make_range(TfmRewriter.buffer_begin(), TfmRewriter.buffer_end())) {
     auto StartLoc{SrcMgr.getLocForStartOfFile(Buffer.first)};
@@ -79,17 +195,41 @@ bool tsar::formatSourceAndPrepareToRelease(
       }
     }
     if (!GlobalOpts.NoFormat) {
-      std::string TfmSrc(Buffer.second.begin(), Buffer.second.end());
-      auto EndLoc = SrcMgr.getLocForEndOfFile(Buffer.first);
-      auto ReformatSrc = reformat(TfmSrc, Adjuster(OrigFile->getName()));
-      if (!ReformatSrc) {
-        toDiag(Diags, StartLoc, tsar::diag::warn_reformat);
-        continue;
-      }
-      auto CurrSize = Buffer.second.size();
-      Buffer.second.InsertTextBefore(0, ReformatSrc.get());
-      Buffer.second.RemoveText(0, CurrSize);
+      ToFormat.emplace_back();
+      auto &Info{ToFormat.back()};
+      Info.FID = Buffer.first;
+      Info.Buffer = &Buffer.second;
+      Info.TfmSrc.assign(Buffer.second.begin(), Buffer.second.end());
+      Info.Filename = Adjuster(OrigFile->getName());
+      collectChangedRanges(SrcMgr.getBufferData(Buffer.first), Info);
+      if (Info.Ranges.empty())
+        ToFormat.pop_back();
     }
   }
+  if (ToFormat.empty())
+    return IsAllValid;
+  auto Style{format::getStyle("LLVM", "", "LLVM")};
+  if (!Style) {
+    consumeError(Style.takeError());
+    for (auto &Info : ToFormat)
+      toDiag(Diags, SrcMgr.getLocForStartOfFile(Info.FID),
+             tsar::diag::warn_reformat);
+    return IsAllValid;
+  }
+  // Only changed regions are reformatted. Formatting does not access
+  // the source manager, so files are processed concurrently.
+  {
+    ThreadPool Pool(hardware_concurrency(GlobalOpts.NumThreads));
+    for (auto &Info : ToFormat)
+      Pool.async([&Info, &Style]() {
+        // Includes are not sorted because sortIncludes() removes adjacent
+        // includes of the same file, which may be intentional in sources.
+        Info.Replaces =
+            format::reformat(*Style, Info.TfmSrc, Info.Ranges, Info.Filename);
+      });
+    Pool.wait();
+  }
+  for (auto &Info : ToFormat)
+    applyReplacements(Info);
   return IsAllValid;
 }
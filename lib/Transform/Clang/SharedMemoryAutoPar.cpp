@@ -48,7 +48,6 @@
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Transform/Clang/Passes.h"
 #include "tsar/Transform/IR/InterprocAttr.h"
-#include <bcl/marray.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/Stmt.h>
 #include <clang/Basic/SourceManager.h>
@@ -178,7 +177,9 @@ bool ClangSMParallelization::findParallelLoops(Loop &L,
         if (!Callee)
           continue;
         assert(mAdjacentList.count(Callee) && "Call to an unknown function!");
-        mParallelCallees.try_emplace(Callee, mAdjacentList[Callee].get<Id>());
+        auto CalleeId = mAdjacentList[Callee].get<Id>();
+        if (mParallelCallees.try_emplace(Callee, CalleeId).second)
+          mReachability.addSource(CalleeId);
       }
   }
   if (!PI || PI && !PI->isFinal())
@@ -274,41 +275,6 @@ std::size_t ClangSMParallelization::buildAdjacentList() {
   return LastPostorderNum;
 }
 
-template <typename Adjacent, typename HasUnknownCalls, typename AdjacentListT>
-static void addToReachability(const AdjacentListT &AdjacentList,
-                              const DenseSet<std::size_t> ExternalCalls,
-                              const typename AdjacentListT::value_type &SCC,
-                              SmallVectorImpl<std::size_t> &Path,
-                              DenseSet<std::size_t> &Finished,
-                              DenseSet<std::size_t> &Visited,
-                              bcl::marray<bool, 2> &Reachability) {
-  for (auto To : SCC.second.template get<Adjacent>()) {
-    if (!Visited.insert(To).second)
-      continue;
-    for (auto From : Path)
-      Reachability[From][To] = true;
-    if (Finished.insert(To).second) {
-      Path.push_back(To);
-      addToReachability<Adjacent, HasUnknownCalls>(
-          AdjacentList, ExternalCalls, *(AdjacentList.begin() + To), Path,
-          Finished, Visited, Reachability);
-      Path.pop_back();
-    } else {
-      addToReachability<Adjacent, HasUnknownCalls>(
-          AdjacentList, ExternalCalls, *(AdjacentList.begin() + To), Path,
-          Finished, Visited, Reachability);
-    }
-  }
-  // It's not necessary to add call to external functions if there are
-  // unknown calls from the current SCC. There are two possibility for unknown
-  // calls. The first one is call to user-defined functions. However, these
-  // calls prevent parallelization of a loop (DirectUserCallee attribute).
-  // So, it's not important whether a function, which we consider to parallelize,
-  // is reachable from this unknown callee. The second case is call to a library
-  // function. We assume that there is no user-defined functions which are
-  // reachable from library functions. So, this case can be also ignored.
-}
-
 bool ClangSMParallelization::runOnModule(Module &M) {
   releaseMemory();
   auto &TfmInfoPass{ getAnalysis<TransformationEnginePass>() };
@@ -338,30 +304,25 @@ bool ClangSMParallelization::runOnModule(Module &M) {
                tsar::diag::warn_region_not_found) << Name;
   }
   auto NumberOfSCCs = buildAdjacentList();
-  bcl::marray<bool, 2> Reachability({NumberOfSCCs, NumberOfSCCs});
-  for (std::size_t I = 0, EI = NumberOfSCCs; I < EI; ++I)
-    for (std::size_t J = 0, EJ = NumberOfSCCs; J < EJ; ++J)
-      Reachability[I][J] = false;
-  DenseSet<std::size_t> Finished;
-  std::size_t PrevSCCId = NumberOfSCCs;
-  // Build reachability matrix for SCCs.
-  for (auto &SCC : mAdjacentList) {
-    if (SCC.second.get<Id>() == PrevSCCId)
-      continue;
-    PrevSCCId = SCC.second.get<Id>();
-    if (!Finished.insert(SCC.second.get<Id>()).second)
-      continue;
-    SmallVector<std::size_t, 8> Path;
-    Path.push_back(SCC.second.get<Id>());
-    DenseSet<std::size_t> Visited;
-    addToReachability<Adjacent, HasUnknownCalls>(mAdjacentList, mExternalCalls,
-                                                 SCC, Path, Finished, Visited,
-                                                 Reachability);
-  }
+  // Build reachability matrix for SCCs. Note, that SCCs are numbered in
+  // postorder, so successors of each SCC have smaller IDs.
+  mReachability = SCCReachability(NumberOfSCCs);
+  for (auto &SCC : mAdjacentList)
+    for (auto To : SCC.second.get<Adjacent>())
+      mReachability.addEdge(SCC.second.get<Id>(), To);
+  // It's not necessary to add call to external functions if there are
+  // unknown calls from the current SCC. There are two possibility for unknown
+  // calls. The first one is call to user-defined functions. However, these
+  // calls prevent parallelization of a loop (DirectUserCallee attribute).
+  // So, it's not important whether a function, which we consider to parallelize,
+  // is reachable from this unknown callee. The second case is call to a library
+  // function. We assume that there is no user-defined functions which are
+  // reachable from library functions. So, this case can be also ignored.
+  mReachability.compute();
   LLVM_DEBUG(dbgs() << "[SHARED PARALLEL]: reachability matrix:\n";
              for (std::size_t I = 0, EI = NumberOfSCCs; I < EI; ++I) {
                for (std::size_t J = 0, EJ = NumberOfSCCs; J < EJ; ++J)
-                 dbgs() << Reachability[I][J] << " ";
+                 dbgs() << mReachability.isReachable(I, J) << " ";
                dbgs() << "\n";
              });
   for (auto &Current : llvm::reverse(mAdjacentList)) {
@@ -378,10 +339,7 @@ bool ClangSMParallelization::runOnModule(Module &M) {
       continue;
     // Check that current function is not reachable from any parallel region.
     if (mParallelCallees.count(F) ||
-        llvm::any_of(mParallelCallees,
-                     [&Node, &Reachability](const auto &Parallel) {
-                       return Reachability[Parallel.second][Node.get<Id>()];
-                     })) {
+        mReachability.isReachableFromSources(Node.get<Id>())) {
       LLVM_DEBUG(dbgs() << "[SHARED PARALLEL]: ignore function reachable from "
                            "parallel region "
                         << F->getName() << "\n");
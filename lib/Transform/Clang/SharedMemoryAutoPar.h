@@ -27,6 +27,7 @@
 #define TSAR_CLANG_SHARED_PARALLEL_H
 
 #include "tsar/ADT/DenseMapTraits.h"
+#include "tsar/ADT/SCCReachability.h"
 #include "tsar/Analysis/AnalysisSocket.h"
 #include "tsar/Analysis/Clang/MemoryMatcher.h"
 #include "tsar/Analysis/Memory/DIArrayAccess.h"
@@ -112,6 +113,7 @@ public:
     mMemoryMatcher = nullptr;
     mGlobalsAA = nullptr;
     mSocketInfo = nullptr;
+    mReachability.clear();
   }
 
 protected:
@@ -169,6 +171,8 @@ private:
   DenseSet<std::size_t> mExternalCalls;
   // Set of functions and their IDs which are called from parallel loops.
   DenseMap<Function *, std::size_t> mParallelCallees;
+  // Reachability of SCCs in a call graph, parallel callees are sources.
+  tsar::SCCReachability mReachability;
 };
 
 /// This specifies additional passes which must be run on client.
@@ -24,6 +24,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "tsar/Analysis/Attributes.h"
+#include "tsar/Analysis/Memory/ArraySection.h"
 #include "tsar/Analysis/Memory/DIDependencyAnalysis.h"
 #include "tsar/Analysis/Memory/DIEstimateMemory.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
@@ -115,6 +116,7 @@ INITIALIZE_PASS_DEPENDENCY(GlobalsAAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(DIMemoryEnvironmentWrapper)
 INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
 INITIALIZE_PASS_DEPENDENCY(GlobalLiveMemoryWrapper)
+INITIALIZE_PASS_DEPENDENCY(GlobalArraySectionWrapper)
 INITIALIZE_PASS_DEPENDENCY(DIMemoryTraitPoolWrapper)
 INITIALIZE_PASS_DEPENDENCY(DependenceInlinerProvider)
 INITIALIZE_PASS_END(DependenceInlinerAttributer, "dependence-inline-attrs",
@@ -143,6 +145,7 @@ void DependenceInlinerAttributer::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<DIMemoryTraitPoolWrapper>();
   AU.addRequired<GlobalDefinedMemoryWrapper>();
   AU.addRequired<GlobalLiveMemoryWrapper>();
+  AU.addRequired<GlobalArraySectionWrapper>();
   AU.setPreservesAll();
 }
 
@@ -225,6 +228,11 @@ InlineCost DependenceInlinerPass::getInlineCost(CallBase &CB) {
       [&GlobalLiveMemory](GlobalLiveMemoryWrapper &Wrapper) {
         Wrapper.set(GlobalLiveMemory);
       });
+    auto &ArraySections = getAnalysis<GlobalArraySectionWrapper>().get();
+    DependenceInlinerProvider::initialize<GlobalArraySectionWrapper>(
+      [&ArraySections](GlobalArraySectionWrapper &Wrapper) {
+        Wrapper.set(ArraySections);
+      });
     auto InlineMDKind =
         M.getContext().getMDKindID(getAsString(AttrKind::Inline));
     auto InlineMD = MDNode::get(M.getContext(), {});
@@ -38,15 +38,20 @@
 #include "tsar/Transform/IR/Utils.h"
 #include "tsar/Unparse/SourceUnparserUtils.h"
 #include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/AssumptionCache.h>
 #include <llvm/Analysis/CallGraph.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Analysis/MemoryLocation.h>
 #include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/Dominators.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/Support/Debug.h>
@@ -85,6 +90,8 @@ STATISTIC(NumLoadArray, "Number of registered loads from arrays");
 STATISTIC(NumStore, "Number of registered stores to the memory");
 STATISTIC(NumStoreScalar, "Number of registered stores to scalars");
 STATISTIC(NumStoreArray, "Number of registered stores to arrays");
+STATISTIC(NumLoadRange, "Number of loads registered once per loop");
+STATISTIC(NumStoreRange, "Number of stores registered once per loop");
 
 INITIALIZE_PROVIDER_BEGIN(InstrumentationPassProvider, "instr-llvm-provider",
   "Instrumentation Provider")
@@ -141,8 +148,8 @@ void InstrumentationPass::getAnalysisUsage(AnalysisUsage &AU) const {
 }
 
 ModulePass * llvm::createInstrumentationPass(
-    StringRef InstrEntry, ArrayRef<std::string> StartFrom) {
-  return new InstrumentationPass(InstrEntry, StartFrom);
+    StringRef InstrEntry, ArrayRef<std::string> StartFrom, bool LoopRanges) {
+  return new InstrumentationPass(InstrEntry, StartFrom, LoopRanges);
 }
 
 Function * tsar::createEmptyInitDI(Module &M, Type &IdTy) {
@@ -589,8 +596,27 @@ void Instrumentation::visit(Function &F) {
   if (F.empty())
     return;
   visitFunction(F);
+  if (!mInstrPass->isLoopRangesEnabled()) {
+    visit(F.begin(), F.end());
+    mDT = nullptr;
+    return;
+  }
+  // Instrumentation of loops splits exit edges, so analysis results which are
+  // used to register ranges should be recomputed.
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  AssumptionCache AC(F);
+  TargetLibraryInfoImpl TLII(Triple(F.getParent()->getTargetTriple()));
+  TargetLibraryInfo TLI(TLII, &F);
+  ScalarEvolution SE(F, TLI, AC, DT, LI);
+  mRangeDT = &DT;
+  mLI = &LI;
+  mSE = &SE;
   visit(F.begin(), F.end());
   mDT = nullptr;
+  mRangeDT = nullptr;
+  mLI = nullptr;
+  mSE = nullptr;
 }
 
 void Instrumentation::regFunction(Value &F, Type *ReturnTy, unsigned Rank,
@@ -776,9 +802,10 @@ void Instrumentation::visitCallBase(llvm::CallBase &Call) {
 
 std::tuple<Value *, Value *, Value *, Value *>
 Instrumentation::regMemoryAccessArgs(Value *Ptr, const DebugLoc &DbgLoc,
-    Instruction &InsertBefore) {
+    Instruction &InsertBefore, Value *BasePtr) {
   auto &Ctx = InsertBefore.getContext();
-  auto BasePtr = Ptr->stripInBoundsOffsets();
+  if (!BasePtr)
+    BasePtr = Ptr->stripInBoundsOffsets();
   DIStringRegister::IdTy OpIdx = 0;
   if (auto AI = dyn_cast<AllocaInst>(BasePtr)) {
     OpIdx = mDIStrings[AI];
@@ -832,6 +859,123 @@ void Instrumentation::visitInstruction(Instruction &I) {
   }
 }
 
+/// Return type of a value which is loaded or stored by a specified instruction.
+static Type *getAccessType(const Instruction &I) {
+  if (auto *SI = dyn_cast<StoreInst>(&I))
+    return SI->getValueOperand()->getType();
+  return cast<LoadInst>(I).getType();
+}
+
+bool Instrumentation::mayCarryDependence(Loop &L, Instruction &I,
+    const SCEV &PtrSCEV, const Value &Object, bool IsWrite) {
+  if (!isIdentifiedObject(&Object))
+    return true;
+  auto &DL = I.getModule()->getDataLayout();
+  auto Size = DL.getTypeStoreSize(getAccessType(I));
+  for (auto *BB : L.blocks())
+    for (auto &Inst : *BB) {
+      if (&Inst == &I || Inst.getMetadata("sapfor.da") ||
+          isa<DbgInfoIntrinsic>(Inst) || !Inst.mayReadOrWriteMemory())
+        continue;
+      if (!isa<LoadInst>(Inst) && !isa<StoreInst>(Inst))
+        return true;
+      if (!IsWrite && !Inst.mayWriteToMemory())
+        continue;
+      auto *Ptr = getLoadStorePointerOperand(&Inst);
+      auto *InstObject = GetUnderlyingObject(Ptr, DL, 0);
+      if (InstObject != &Object) {
+        if (isIdentifiedObject(InstObject))
+          continue;
+        return true;
+      }
+      if (mSE->getSCEV(Ptr) != &PtrSCEV ||
+          DL.getTypeStoreSize(getAccessType(Inst)) != Size)
+        return true;
+    }
+  return false;
+}
+
+bool Instrumentation::regLoopRange(Instruction &I, Value &Ptr, bool IsWrite) {
+  if (!mInstrPass->isLoopRangesEnabled() || !mLI || !mSE || !mRangeDT)
+    return false;
+  auto *L = mLI->getLoopFor(I.getParent());
+  if (!L)
+    return false;
+  auto *Preheader = L->getLoopPreheader();
+  if (!Preheader)
+    return false;
+  // Each iteration must execute the access once. So, the loop should have
+  // a single exit from the header or from the latch and the access should
+  // dominate the latch.
+  auto *Latch = L->getLoopLatch();
+  auto *Exiting = L->getExitingBlock();
+  if (!Latch || !Exiting || (Exiting != Latch && Exiting != L->getHeader()) ||
+      !mRangeDT->dominates(I.getParent(), Latch))
+    return false;
+  auto *PtrSCEV = dyn_cast<SCEVAddRecExpr>(mSE->getSCEV(&Ptr));
+  if (!PtrSCEV || PtrSCEV->getLoop() != L || !PtrSCEV->isAffine())
+    return false;
+  auto *StepSCEV = dyn_cast<SCEVConstant>(PtrSCEV->getStepRecurrence(*mSE));
+  auto *M = I.getModule();
+  auto &DL = M->getDataLayout();
+  auto ElementSize = DL.getTypeStoreSize(getAccessType(I));
+  // Elements of a range must not overlap. The stride is passed as an unsigned
+  // value, so ranges with a negative step are not supported.
+  if (!StepSCEV || StepSCEV->getAPInt().isNegative() ||
+      StepSCEV->getAPInt().ult(ElementSize.getFixedSize()))
+    return false;
+  auto *TripSCEV = mSE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(TripSCEV))
+    return false;
+  auto *BasePtr = Ptr.stripInBoundsOffsets();
+  if (mayCarryDependence(*L, I, *PtrSCEV, *GetUnderlyingObject(&Ptr, DL, 0),
+                         IsWrite))
+    return false;
+  auto Fun = getDeclaration(M,
+    IsWrite ? IntrinsicId::write_range : IntrinsicId::read_range);
+  auto *SizeTy = cast<IntegerType>(Fun.getFunctionType()->getParamType(2));
+  if (TripSCEV->getType()->getIntegerBitWidth() > SizeTy->getBitWidth() ||
+      StepSCEV->getAPInt().getActiveBits() > SizeTy->getBitWidth())
+    return false;
+  // If the loop exits from the header, the rest of the body is executed
+  // one time less than the header.
+  auto *CountSCEV = mSE->getZeroExtendExpr(TripSCEV, SizeTy);
+  if (Exiting == Latch || I.getParent() == Exiting)
+    CountSCEV = mSE->getAddExpr(CountSCEV, mSE->getOne(SizeTy));
+  auto &InsertBefore = *Preheader->getTerminator();
+  if (auto *BaseInst = dyn_cast<Instruction>(BasePtr))
+    if (!mRangeDT->dominates(BaseInst, &InsertBefore))
+      return false;
+  if (!isSafeToExpandAt(PtrSCEV->getStart(), &InsertBefore, *mSE))
+    return false;
+  auto *Count = computeSCEV(CountSCEV, *SizeTy, false, *mSE, *mRangeDT,
+    InsertBefore);
+  if (!Count)
+    return false;
+  LLVM_DEBUG(dbgs() << "[INSTR]: register range for "; I.print(dbgs());
+    dbgs() << "\n");
+  SCEVExpander Exp(*mSE, DL, "");
+  auto *Start = Exp.expandCodeFor(PtrSCEV->getStart(), Ptr.getType(),
+    &InsertBefore);
+  if (auto *StartInst = dyn_cast<Instruction>(Start))
+    setMDForDeadInstructions(StartInst);
+  llvm::Value *DILoc, *Addr, *DIVar, *ArrayBase;
+  std::tie(DILoc, Addr, DIVar, ArrayBase) =
+    regMemoryAccessArgs(Start, I.getDebugLoc(), InsertBefore, BasePtr);
+  if (!ArrayBase)
+    ArrayBase = ConstantPointerNull::get(Type::getInt8PtrTy(M->getContext()));
+  auto *Stride = ConstantInt::get(SizeTy, StepSCEV->getAPInt().getZExtValue());
+  auto *Size = ConstantInt::get(SizeTy, ElementSize.getFixedSize());
+  auto Call = CallInst::Create(Fun.getFunctionType(), Fun.getCallee(),
+    {DILoc, Addr, Count, Stride, Size, DIVar, ArrayBase}, "", &InsertBefore);
+  Call->setMetadata("sapfor.da", MDNode::get(M->getContext(), {}));
+  if (IsWrite)
+    ++NumStoreRange;
+  else
+    ++NumLoadRange;
+  return true;
+}
+
 void Instrumentation::regReadMemory(Instruction &I, Value &Ptr) {
   if (I.getMetadata("sapfor.da"))
     return;
@@ -884,10 +1028,16 @@ void Instrumentation::regWriteMemory(Instruction &I, Value &Ptr) {
 }
 
 void Instrumentation::visitLoadInst(LoadInst &I) {
+  if (I.getMetadata("sapfor.da") ||
+      regLoopRange(I, *I.getPointerOperand(), false))
+    return;
   regReadMemory(I, *I.getPointerOperand());
 }
 
 void Instrumentation::visitStoreInst(StoreInst &I) {
+  if (I.getMetadata("sapfor.da") ||
+      regLoopRange(I, *I.getPointerOperand(), true))
+    return;
   regWriteMemory(I, *I.getPointerOperand());
 }
 
@@ -92,6 +92,24 @@ void sapforWriteArrEnd(void *DILoc, void *Addr, void *DIVar, void *ArrBase) {
   printf("DIVar = %s\nDILoc = %s\n\n", DIVar, DILoc);
 }
 
+void sapforReadRange(void *DILoc, void *Addr, uint64_t Count, uint64_t Stride,
+    uint64_t ElementSize, void *DIVar, void *ArrBase) {
+  printf("called sapforReadRange\n");
+  printf("DIVar = %s\nDILoc = %s\n", DIVar, DILoc);
+  printf("Count = %llu\nStride = %llu\nElementSize = %llu\n\n",
+    (unsigned long long)Count, (unsigned long long)Stride,
+    (unsigned long long)ElementSize);
+}
+
+void sapforWriteRange(void *DILoc, void *Addr, uint64_t Count, uint64_t Stride,
+    uint64_t ElementSize, void *DIVar, void *ArrBase) {
+  printf("called sapforWriteRange\n");
+  printf("DIVar = %s\nDILoc = %s\n", DIVar, DILoc);
+  printf("Count = %llu\nStride = %llu\nElementSize = %llu\n\n",
+    (unsigned long long)Count, (unsigned long long)Stride,
+    (unsigned long long)ElementSize);
+}
+
 //===--------------------- Registration of a function ---------------------===//
 void sapforFuncBegin(void *DIFunc) {
   printf("called sapforFuncBegin\n");
@@ -0,0 +1,153 @@
+//===- AliasTree.cpp --------- Alias Tree Benchmark -------------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark evaluates construction of an alias tree for a synthetic
+// function which accesses a lot of structures and arrays.
+//
+//===----------------------------------------------------------------------===//
+
+#include <tsar/Core/tsar-config.h>
+#include <tsar/Analysis/Memory/EstimateMemory.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/BasicAliasAnalysis.h>
+#include <llvm/Analysis/MemoryLocation.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TypeBasedAliasAnalysis.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+using TimeT = std::chrono::duration<double>;
+
+/// Number of elements in an array which is a member of each structure.
+constexpr unsigned ArraySize = 8;
+
+/// Creates a function which accesses `NumObjects` local structures
+/// `struct { int X; int Y[ArraySize]; }` and memory pointed to by an argument.
+///
+/// Each structure produces about `ArraySize + 3` estimate memory locations
+/// (structure, its members and elements of the array), so use 1000 or more
+/// objects to evaluate construction of a tree with 10k+ locations.
+Function * createFunction(Module &M, std::size_t NumObjects) {
+  auto &Ctx = M.getContext();
+  auto *Int32Ty = Type::getInt32Ty(Ctx);
+  auto *ArrayTy = ArrayType::get(Int32Ty, ArraySize);
+  auto *StructTy = StructType::create(Ctx, { Int32Ty, ArrayTy }, "struct.S");
+  auto *FuncTy = FunctionType::get(Type::getVoidTy(Ctx),
+    { PointerType::getUnqual(Int32Ty) }, false);
+  auto *F = Function::Create(FuncTy, Function::ExternalLinkage, "bench", &M);
+  auto *Arg = F->arg_begin();
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", F));
+  auto *Zero = Builder.getInt32(0);
+  for (std::size_t I = 0; I < NumObjects; ++I) {
+    auto *S = Builder.CreateAlloca(StructTy);
+    auto *X = Builder.CreateInBoundsGEP(StructTy, S, { Zero, Zero });
+    Builder.CreateStore(Builder.CreateLoad(Int32Ty, Arg), X);
+    for (unsigned J = 0; J < ArraySize; ++J) {
+      auto *Y = Builder.CreateInBoundsGEP(StructTy, S,
+        { Zero, Builder.getInt32(1), Builder.getInt32(J) });
+      Builder.CreateStore(Builder.CreateLoad(Int32Ty, X), Y);
+    }
+  }
+  Builder.CreateRetVoid();
+  return F;
+}
+
+TimeT buildTime(Function &F, std::size_t &NumNodes) {
+  auto &DL = F.getParent()->getDataLayout();
+  TargetLibraryInfoImpl TLII(Triple(F.getParent()->getTargetTriple()));
+  TargetLibraryInfo TLI(TLII);
+  AssumptionCache AC(F);
+  DominatorTree DT(F);
+  BasicAAResult BAR(DL, F, TLI, AC, &DT);
+  TypeBasedAAResult TBAAR;
+  AAResults AA(TLI);
+  AA.addAAResult(BAR);
+  AA.addAAResult(TBAAR);
+  auto Start = std::chrono::high_resolution_clock::now();
+  AliasTree AT(AA, DL, DT);
+  for (auto &I : instructions(F))
+    if (isa<LoadInst>(I) || isa<StoreInst>(I))
+      AT.add(MemoryLocation::get(&I));
+  AT.releaseAliasCache();
+  auto End = std::chrono::high_resolution_clock::now();
+  NumNodes = AT.size();
+  return End - Start;
+}
+
+void run(std::size_t NumObjects, unsigned MaxIter) {
+  LLVMContext Ctx;
+  Module M("alias-tree-perf", Ctx);
+  auto *F = createFunction(M, NumObjects);
+  TimeT Time(0);
+  std::size_t NumNodes = 0;
+  for (unsigned I = 0; I < MaxIter; ++I)
+    Time += buildTime(*F, NumNodes);
+  outs() << "Results for " << __FILE__ << " benchmark\n";
+  outs() << "  date " << __DATE__ << "\n";
+  outs() << "  LLVM version " << LLVM_VERSION_STRING << "\n";
+  outs() << "  TSAR version " << TSAR_VERSION_STRING << "\n";
+  outs() << "  number of objects " << NumObjects << "\n";
+  outs() << "  number of alias nodes " << NumNodes << "\n";
+  outs() << "  number of iterations " << MaxIter << "\n";
+  outs() << "\n";
+  outs() << "  alias tree construction time (.s) "
+    << (Time / MaxIter).count() << "\n";
+  if (AreStatisticsEnabled()) {
+    outs() << "\n";
+    PrintStatistics(outs());
+  }
+}
+
+int main(int Argc, const char **Argv) {
+  std::string Help = "parameter: <number of objects> [number of iterations]\n";
+  if (Argc < 2) {
+    errs() << "error: too few arguments\n" << Help;
+    return 1;
+  } else if (Argc > 3) {
+    errs() << "error: too many arguments\n" << Help;
+    return 2;
+  }
+  std::size_t NumObjects = std::atoll(Argv[1]);
+  unsigned MaxIter = (Argc > 2) ? std::atoi(Argv[2]) : 5;
+  if (NumObjects == 0) {
+    errs() << "error: invalid number of objects\n" << Help;
+    return 3;
+  }
+  if (MaxIter == 0) {
+    errs() << "error: invalid number of iterations\n" << Help;
+    return 4;
+  }
+  EnableStatistics(false);
+  run(NumObjects, MaxIter);
+  return 0;
+}
@@ -0,0 +1,379 @@
+//===- Pipeline.cpp ------- Analysis Pipeline Benchmark ---------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2018 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark generates synthetic C sources and evaluates the main stages
+// of the analysis pipeline: construction of an alias tree, defined and live
+// memory analysis, privatization, metadata-level dependence analysis,
+// shared memory parallelization and a round trip to the analysis server.
+//
+// The tool creates a single tsar::Tool in each process, so each run of
+// the analyzer is performed in a child process (this executable is run with
+// the -run-stage option). A child process measures execution time of passes
+// and sends measurements to the parent in JSON format. Results are printed
+// to the standard output in JSON format:
+// {
+//   "benchmark": "tsar-perf", ..., "scale": ..., "iterations": ...,
+//   "inputs": [{ "name": "loop-nest", "stages": { "alias-tree": 0.1, ... }}]
+// }
+// Average wall time of each stage (in seconds) is printed, time is null if
+// a stage fails.
+//
+//===----------------------------------------------------------------------===//
+
+#include <tsar/Core/tsar-config.h>
+#include <tsar/Core/Tool.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+using TimeT = std::chrono::duration<double>;
+
+namespace {
+/// Description of a synthetic input.
+struct Input {
+  StringRef Name;
+  std::function<void(raw_ostream &, std::size_t)> Generate;
+};
+
+/// Description of a stage of processing.
+struct Stage {
+  /// Name of a stage in results.
+  StringRef Name;
+  /// Name of a run which evaluates this stage (see Runs).
+  StringRef Run;
+  /// Argument of passes which belong to this stage, if it is empty the whole
+  /// execution time is used.
+  StringRef PassArg;
+};
+
+/// Description of a single run of the analyzer.
+struct Run {
+  StringRef Name;
+  std::vector<StringRef> Args;
+};
+
+/// Loop nests of depth 6, `Scale` functions are generated.
+void generateLoopNest(raw_ostream &OS, std::size_t Scale) {
+  constexpr unsigned Depth = 6;
+  constexpr unsigned Size = 4;
+  OS << "double A";
+  for (unsigned D = 0; D < Depth; ++D)
+    OS << "[" << Size << "]";
+  OS << ";\n";
+  for (std::size_t F = 0; F < Scale; ++F) {
+    OS << "void nest" << F << "(double X) {\n";
+    for (unsigned D = 0; D < Depth; ++D)
+      OS.indent(2 * D + 2) << "for (int I" << D << " = 0; I" << D << " < "
+                           << Size << "; ++I" << D << ")\n";
+    OS.indent(2 * Depth + 2) << "A";
+    for (unsigned D = 0; D < Depth; ++D)
+      OS << "[I" << D << "]";
+    OS << " = A";
+    for (unsigned D = 0; D < Depth; ++D)
+      OS << "[I" << D << "]";
+    OS << " * X + " << F << ";\n";
+    OS << "}\n";
+  }
+  OS << "int main() {\n";
+  for (std::size_t F = 0; F < Scale; ++F)
+    OS << "  nest" << F << "(" << F << ");\n";
+  OS << "  return 0;\n}\n";
+}
+
+/// Structure with `Scale` members which are accessed in a loop.
+void generateWideStruct(raw_ostream &OS, std::size_t Scale) {
+  OS << "struct S {\n";
+  for (std::size_t I = 0; I < Scale; ++I)
+    OS << "  double F" << I << ";\n";
+  OS << "};\n";
+  OS << "struct S A[100];\n";
+  OS << "void wide() {\n";
+  OS << "  for (int I = 1; I < 100; ++I) {\n";
+  for (std::size_t I = 0; I < Scale; ++I)
+    OS << "    A[I].F" << I << " = A[I - 1].F" << (I + 1) % Scale << " + " << I
+       << ";\n";
+  OS << "  }\n}\n";
+  OS << "int main() {\n  wide();\n  return 0;\n}\n";
+}
+
+/// Function with `Scale` pointer parameters which may alias.
+void generateAliasingPointers(raw_ostream &OS, std::size_t Scale) {
+  OS << "void alias(";
+  for (std::size_t I = 0; I < Scale; ++I)
+    OS << (I == 0 ? "" : ", ") << "double *P" << I;
+  OS << ") {\n";
+  OS << "  for (int I = 0; I < 100; ++I) {\n";
+  for (std::size_t I = 0; I < Scale; ++I)
+    OS << "    P" << I << "[I] = P" << (I + 1) % Scale << "[I] + " << I
+       << ";\n";
+  OS << "  }\n}\n";
+  OS << "double A[100], B[100];\n";
+  OS << "int main() {\n  alias(";
+  for (std::size_t I = 0; I < Scale; ++I)
+    OS << (I == 0 ? "" : ", ") << (I % 2 ? "A" : "B");
+  OS << ");\n  return 0;\n}\n";
+}
+
+/// Call graph of `Scale` functions, each function contains a loop.
+void generateCallGraph(raw_ostream &OS, std::size_t Scale) {
+  OS << "double A[100];\n";
+  for (std::size_t F = 0; F < Scale; ++F) {
+    OS << "void f" << F << "(double X) {\n";
+    OS << "  for (int I = 0; I < 100; ++I)\n";
+    OS << "    A[I] = A[I] + X;\n";
+    if (F > 0)
+      OS << "  f" << F - 1 << "(X + 1);\n";
+    if (F > 1)
+      OS << "  f" << F / 2 << "(X + 2);\n";
+    OS << "}\n";
+  }
+  OS << "int main() {\n  f" << Scale - 1 << "(0);\n  return 0;\n}\n";
+}
+
+/// Loop which contains a switch with `Scale` cases.
+void generateSwitchCFG(raw_ostream &OS, std::size_t Scale) {
+  OS << "double A[" << Scale << "];\n";
+  OS << "int K[1000];\n";
+  OS << "void cfg() {\n";
+  OS << "  for (int I = 0; I < 1000; ++I) {\n";
+  OS << "    switch (K[I]) {\n";
+  for (std::size_t C = 0; C < Scale; ++C)
+    OS << "    case " << C << ": A[" << C << "] = A[" << (C + 1) % Scale
+       << "] + I; break;\n";
+  OS << "    default: break;\n";
+  OS << "    }\n  }\n}\n";
+  OS << "int main() {\n  cfg();\n  return 0;\n}\n";
+}
+
+const Input Inputs[] = {
+  { "loop-nest", generateLoopNest },
+  { "wide-struct", generateWideStruct },
+  { "aliasing-pointers", generateAliasingPointers },
+  { "call-graph", generateCallGraph },
+  { "switch-cfg", generateSwitchCFG }
+};
+
+const Run Runs[] = {
+  { "analysis", {} },
+  { "openmp", { "-clang-openmp-parallel", "-no-format",
+                "-output-suffix=perf" } },
+  { "server", { "-use-analysis-server" } }
+};
+
+const Stage Stages[] = {
+  { "alias-tree", "analysis", "estimate-mem" },
+  { "defined-memory", "analysis", "def-mem" },
+  { "live-memory", "analysis", "live-mem" },
+  { "private-recognition", "analysis", "private" },
+  { "di-dependency-analysis", "analysis", "da-di" },
+  { "analysis-total", "analysis", "" },
+  { "clang-sm-parallelization", "openmp", "clang-openmp-parallel" },
+  { "server-wait", "server", "analysis-wait" },
+  { "server-round-trip", "server", "" }
+};
+
+/// Run analyzer in the current process and store execution time of passes
+/// to a specified file. This is a body of a child process.
+int runStage(StringRef RunName, StringRef Source, StringRef ResultFile) {
+  auto RunItr = llvm::find_if(Runs, [RunName](const Run &R) {
+    return R.Name == RunName;
+  });
+  if (RunItr == std::end(Runs)) {
+    errs() << "error: unknown run " << RunName << "\n";
+    return 1;
+  }
+  std::vector<const char *> Argv{ "tsar", Source.data() };
+  for (auto Arg : RunItr->Args)
+    Argv.push_back(Arg.data());
+  TimePassesIsEnabled = true;
+  Tool Analyzer(Argv.size(), Argv.data());
+  auto Start = std::chrono::high_resolution_clock::now();
+  auto Res = Analyzer.run();
+  auto End = std::chrono::high_resolution_clock::now();
+  // Each line of the list of timers looks like `"time.<group>.<name>.wall": 1`.
+  // Multiple instances of the same pass have the same name, so their times
+  // are summed.
+  std::string TimersJSON;
+  raw_string_ostream TimersOS(TimersJSON);
+  TimerGroup::printAllJSONValues(TimersOS, "");
+  StringMap<double> PassTimes;
+  SmallVector<StringRef, 64> Lines;
+  StringRef(TimersOS.str()).split(Lines, '\n', -1, false);
+  for (auto Line : Lines) {
+    StringRef Key, Value;
+    std::tie(Key, Value) = Line.trim().rtrim(',').split(": ");
+    double Time;
+    if (!Key.consume_front("\"time.pass.") || !Key.consume_back(".wall\"") ||
+        Value.trim().getAsDouble(Time))
+      continue;
+    PassTimes[Key] += Time;
+  }
+  json::Object Passes;
+  for (auto &P : PassTimes)
+    Passes[P.getKey()] = P.getValue();
+  std::error_code EC;
+  raw_fd_ostream OS(ResultFile, EC);
+  if (EC) {
+    errs() << "error: unable to open file " << ResultFile << ": "
+           << EC.message() << "\n";
+    return 1;
+  }
+  OS << json::Value(json::Object{{"total", TimeT(End - Start).count()},
+                                 {"passes", std::move(Passes)}});
+  return Res;
+}
+
+/// Return wall time of passes with a specified argument or the whole
+/// execution time if the argument is empty.
+double getPassTime(const json::Object &Timers, StringRef PassArg) {
+  if (PassArg.empty())
+    return Timers.getNumber("total").getValueOr(0);
+  if (auto *Passes = Timers.getObject("passes"))
+    return Passes->getNumber(PassArg).getValueOr(0);
+  return 0;
+}
+
+int run(StringRef Self, std::size_t Scale, unsigned MaxIter) {
+  SmallString<128> Dir;
+  if (auto EC = sys::fs::createUniqueDirectory("tsar-perf", Dir)) {
+    errs() << "error: unable to create temporary directory: " << EC.message()
+           << "\n";
+    return 1;
+  }
+  json::Array InputResults;
+  for (auto &In : Inputs) {
+    SmallString<128> Source(Dir);
+    sys::path::append(Source, In.Name + ".c");
+    {
+      std::error_code EC;
+      raw_fd_ostream OS(Source, EC);
+      if (EC) {
+        errs() << "error: unable to open file " << Source << ": "
+               << EC.message() << "\n";
+        return 1;
+      }
+      In.Generate(OS, Scale);
+    }
+    json::Object StageResults;
+    for (auto &R : Runs) {
+      SmallString<128> ResultFile(Dir);
+      sys::path::append(ResultFile, In.Name + "." + R.Name + ".json");
+      SmallString<128> LogFile(Dir);
+      sys::path::append(LogFile, In.Name + "." + R.Name + ".log");
+      Optional<StringRef> Redirects[] = {None, StringRef(LogFile),
+                                         StringRef(LogFile)};
+      std::vector<double> Times(std::size(Stages), 0);
+      bool Failed = false;
+      for (unsigned I = 0; I < MaxIter && !Failed; ++I) {
+        std::string ErrMsg;
+        StringRef Args[] = {Self, "-run-stage", R.Name, Source, ResultFile};
+        if (sys::ExecuteAndWait(Self, Args, None, Redirects, 0, 0, &ErrMsg)) {
+          errs() << "warning: " << R.Name << " failed for " << In.Name
+                 << " (see " << LogFile << ")" << (ErrMsg.empty() ? "" : ": ")
+                 << ErrMsg << "\n";
+          Failed = true;
+          continue;
+        }
+        auto Buffer = MemoryBuffer::getFile(ResultFile);
+        if (!Buffer) {
+          Failed = true;
+          continue;
+        }
+        auto Timers = json::parse((*Buffer)->getBuffer());
+        if (!Timers || !Timers->getAsObject()) {
+          consumeError(Timers.takeError());
+          Failed = true;
+          continue;
+        }
+        for (std::size_t S = 0; S < std::size(Stages); ++S)
+          if (Stages[S].Run == R.Name)
+            Times[S] += getPassTime(*Timers->getAsObject(), Stages[S].PassArg);
+      }
+      for (std::size_t S = 0; S < std::size(Stages); ++S)
+        if (Stages[S].Run == R.Name)
+          StageResults[Stages[S].Name] =
+              Failed ? json::Value(nullptr) : json::Value(Times[S] / MaxIter);
+    }
+    InputResults.push_back(json::Object{{"name", In.Name},
+                                        {"stages", std::move(StageResults)}});
+  }
+  sys::fs::remove_directories(Dir);
+  json::Object Results{{"benchmark", "tsar-perf"},
+                       {"date", __DATE__},
+                       {"llvm_version", LLVM_VERSION_STRING},
+                       {"tsar_version", TSAR_VERSION_STRING},
+                       {"scale", static_cast<int64_t>(Scale)},
+                       {"iterations", static_cast<int64_t>(MaxIter)},
+                       {"time_unit", "s"},
+                       {"inputs", std::move(InputResults)}};
+  outs() << formatv("{0:2}", json::Value(std::move(Results))) << "\n";
+  return 0;
+}
+}
+
+/// This is used to find path to the current executable.
+static int StaticSymbol;
+
+int main(int Argc, const char **Argv) {
+  llvm_shutdown_obj ShutdownObj;
+  if (Argc == 5 && StringRef(Argv[1]) == "-run-stage")
+    return runStage(Argv[2], Argv[3], Argv[4]);
+  std::string Help = "parameter: <scale> [number of iterations]\n";
+  if (Argc < 2) {
+    errs() << "error: too few arguments\n" << Help;
+    return 1;
+  } else if (Argc > 3) {
+    errs() << "error: too many arguments\n" << Help;
+    return 2;
+  }
+  std::size_t Scale = std::atoll(Argv[1]);
+  unsigned MaxIter = (Argc > 2) ? std::atoi(Argv[2]) : 5;
+  if (Scale == 0) {
+    errs() << "error: invalid scale\n" << Help;
+    return 3;
+  }
+  if (MaxIter == 0) {
+    errs() << "error: invalid number of iterations\n" << Help;
+    return 4;
+  }
+  auto Self = sys::fs::getMainExecutable(Argv[0], &StaticSymbol);
+  return run(Self, Scale, MaxIter);
+}
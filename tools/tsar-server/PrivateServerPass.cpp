@@ -29,6 +29,7 @@
 #include "tsar/Analysis/AnalysisServer.h"
 #include "tsar/Analysis/Attributes.h"
 #include "tsar/Analysis/DFRegionInfo.h"
+#include "tsar/Analysis/IRChangeTracker.h"
 #include "tsar/Analysis/Clang/CanonicalLoop.h"
 #include "tsar/Analysis/Clang/ControlFlowTraits.h"
 #include "tsar/Analysis/Clang/LoopMatcher.h"
@@ -64,7 +65,10 @@
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Basic/Builtins.h>
 #include <clang/Basic/FileManager.h>
+#include <llvm/ADT/DepthFirstIterator.h>
 #include <llvm/ADT/Optional.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/Analysis/BasicAliasAnalysis.h>
 #include <llvm/InitializePasses.h>
 #include <llvm/IR/InstIterator.h>
@@ -78,6 +82,10 @@ using ::llvm::Module;
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "server-private"
 
+STATISTIC(NumProviderHit, "Number of requests answered with cached analysis");
+STATISTIC(NumProviderMiss, "Number of requests which execute function passes");
+STATISTIC(NumResponseHit, "Number of requests answered with cached responses");
+
 namespace tsar {
 namespace msg {
 /// This message provides list of all analyzed files (including implicitly
@@ -175,9 +183,17 @@ JSON_OBJECT_PAIR_7(Loop,
   Loop & operator=(Loop &&) = default;
 JSON_OBJECT_END(Loop)
 
+/// \brief This message provides a tree of loops in a function.
+///
+/// Loops are sorted according to their start locations. If `Offset` or
+/// `Limit` is specified in a request, only the specified page of loops is
+/// sent in a response and `Total` contains number of all loops.
 JSON_OBJECT_BEGIN(LoopTree)
-JSON_OBJECT_ROOT_PAIR_2(LoopTree,
+JSON_OBJECT_ROOT_PAIR_5(LoopTree,
   FunctionID, unsigned,
+  Offset, Optional<unsigned>,
+  Limit, Optional<unsigned>,
+  Total, Optional<unsigned>,
   Loops, std::vector<Loop>)
 
   LoopTree() : JSON_INIT_ROOT {}
@@ -349,10 +365,22 @@ JSON_OBJECT_PAIR_3(AliasEdge,
   AliasEdge & operator=(AliasEdge &&) = default;
 JSON_OBJECT_END(AliasEdge)
 
+/// \brief This message provides an alias tree for a loop.
+///
+/// To avoid huge responses for large trees a client may request a subtree
+/// (`RootID` is an ID of the root of the subtree) and a page of nodes
+/// (`Offset` and `Limit`). In this case `Total` in a response contains number
+/// of all nodes in the requested (sub)tree. Edges are sent for the nodes
+/// in the page only. Nodes are identified and sent in preorder, so IDs and
+/// pages are the same for different requests.
 JSON_OBJECT_BEGIN(AliasTree)
-JSON_OBJECT_ROOT_PAIR_4(AliasTree,
+JSON_OBJECT_ROOT_PAIR_8(AliasTree,
   FuncID, unsigned,
   LoopID, unsigned,
+  RootID, Optional<std::uintptr_t>,
+  Offset, Optional<unsigned>,
+  Limit, Optional<unsigned>,
+  Total, Optional<unsigned>,
   Nodes, std::vector<AliasNode>,
   Edges, std::vector<AliasEdge>)
 
@@ -892,6 +920,17 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 
 private:
+  /// Matched loop (IR loop is null for loops which have not been matched).
+  using LoopMatch =
+      bcl::tagged_pair<bcl::tagged<clang::Stmt *, AST>, bcl::tagged<Loop *, IR>>;
+
+  /// Map from a raw encoding of a loop start location to a loop.
+  ///
+  /// IR-level loops are not stored because they are computed on the fly
+  /// and they are released when the provider runs for another function.
+  using LoopIndex = DenseMap<unsigned, clang::Stmt *>;
+
+  std::string answer(llvm::Module &M, const std::string &Request);
   std::string answerStatistic(llvm::Module &M);
   std::string answerFileList();
   std::string answerFunctionList(llvm::Module &M);
@@ -905,6 +944,20 @@ private:
   void collectBuiltinFunctions(clang::DeclContext &DeclCtx,
     msg::FunctionList &FuncList);
 
+  /// Return a function with a specified ID (raw encoding of a start location
+  /// of a canonical declaration) or nullptr.
+  ///
+  /// Index of functions is built on the first request.
+  Function * findFunction(llvm::Module &M, unsigned FuncID);
+
+  /// Return a loop with a specified ID (raw encoding of a start location) in
+  /// a specified function or None.
+  ///
+  /// Index of loops is built on the first request for a function. IR-level
+  /// loop is taken from the current results of a provider, so it is valid
+  /// until the provider runs for another function.
+  Optional<LoopMatch> findLoop(Function &F, unsigned LoopID);
+
   bcl::IntrusiveConnection *mConnection;
   bcl::RedirectIO *mStdErr;
 
@@ -918,6 +971,20 @@ private:
   /// GUI knowns this function and it can highlight some information if
   /// necessary.
   DenseSet<clang::FunctionDecl *> mVisibleToUser;
+
+  /// Client usually sends several requests for the same function, so
+  /// do not re-execute function passes for each request.
+  FunctionPassProviderCache<ServerPrivateProvider> mProviders{
+      *this, IRChangeInfo::fingerprint};
+
+  /// Transformation context which has been used to build indices and
+  /// responses below.
+  TransformationContext *mIndexedTfmCtx = nullptr;
+  DenseMap<unsigned, Function *> mFunctionIndex;
+  DenseMap<const Function *, LoopIndex> mLoopIndex;
+
+  /// Responses to already processed requests.
+  StringMap<std::string> mResponses;
 };
 
 /// Increments count of analyzed traits in a specified map TM.
@@ -1061,7 +1128,7 @@ std::string PrivateServerPass::answerStatistic(llvm::Module &M) {
     // Analysis are not available for functions without body.
     if (F.isDeclaration())
       continue;
-    auto &Provider = getAnalysis<ServerPrivateProvider>(F);
+    auto &Provider = mProviders.get(F);
     auto &LMP = Provider.get<LoopMatcherPass>();
     Loops.first += LMP.getMatcher().size();
     Loops.second += LMP.getUnmatchedAST().size();
@@ -1080,21 +1147,16 @@ std::string PrivateServerPass::answerStatistic(llvm::Module &M) {
 
 std::string PrivateServerPass::answerLoopTree(llvm::Module &M,
     const msg::LoopTree &Request) {
-  for (Function &F : M) {
+  if (auto *FPtr = findFunction(M, Request[msg::LoopTree::FunctionID])) {
+    auto &F = *FPtr;
     auto Decl = mTfmCtx->getDeclForMangledName(F.getName());
-    if (!Decl)
-      continue;
     auto CanonicalFD = Decl->getCanonicalDecl()->getAsFunction();
-    if (!mVisibleToUser.count(CanonicalFD) ||
-        CanonicalFD->getBeginLoc().getRawEncoding() !=
-          Request[msg::LoopTree::FunctionID])
-      continue;
-    if (F.isDeclaration())
+    if (!mVisibleToUser.count(CanonicalFD) || F.isDeclaration())
       return json::Parser<msg::LoopTree>::unparseAsObject(Request);
     msg::LoopTree LoopTree;
     LoopTree[msg::LoopTree::FunctionID] = Request[msg::LoopTree::FunctionID];
     auto &SrcMgr = mTfmCtx->getContext().getSourceManager();
-    auto &Provider = getAnalysis<ServerPrivateProvider>(F);
+    auto &Provider = mProviders.get(F);
     auto &Matcher = Provider.get<LoopMatcherPass>().getMatcher();
     auto &Unmatcher = Provider.get<LoopMatcherPass>().getUnmatchedAST();
     auto &RegionInfo = Provider.get<DFRegionInfoPass>().getRegionInfo();
@@ -1187,6 +1249,18 @@ std::string PrivateServerPass::answerLoopTree(llvm::Module &M,
       Loop[msg::Loop::Level] = Levels.size() + 1;
       Levels.push_back(Loop[msg::Loop::EndLocation]);
     }
+    if (Request[msg::LoopTree::Offset] || Request[msg::LoopTree::Limit]) {
+      auto &Loops = LoopTree[msg::LoopTree::Loops];
+      LoopTree[msg::LoopTree::Offset] = Request[msg::LoopTree::Offset];
+      LoopTree[msg::LoopTree::Limit] = Request[msg::LoopTree::Limit];
+      LoopTree[msg::LoopTree::Total] = Loops.size();
+      auto Offset = std::min<std::size_t>(
+          Request[msg::LoopTree::Offset].getValueOr(0), Loops.size());
+      Loops.erase(Loops.begin(), Loops.begin() + Offset);
+      if (Request[msg::LoopTree::Limit] &&
+          *Request[msg::LoopTree::Limit] < Loops.size())
+        Loops.resize(*Request[msg::LoopTree::Limit]);
+    }
     return json::Parser<msg::LoopTree>::unparseAsObject(LoopTree);
   }
   return json::Parser<msg::LoopTree>::unparseAsObject(Request);
@@ -1281,7 +1355,7 @@ std::string PrivateServerPass::answerFunctionList(llvm::Module &M) {
       Func[msg::Function::Traits][msg::FunctionTraits::InOut]
         = msg::Analysis::No;
     if (!F.isDeclaration()) {
-      auto &Provider = getAnalysis<ServerPrivateProvider>(F);
+      auto &Provider = mProviders.get(F);
       auto &LMP = Provider.get<LoopMatcherPass>();
       auto &AA = Provider.get<AAResultsWrapperPass>().getAAResults();
       auto &PI = Provider.get<ParallelLoopPass>().getParallelLoopInfo();
@@ -1309,45 +1383,21 @@ std::string PrivateServerPass::answerFunctionList(llvm::Module &M) {
 
 std::string PrivateServerPass::answerCalleeFuncList(llvm::Module &M,
     const msg::CalleeFuncList &Request) {
-  for (Function &F : M) {
-    auto Decl = mTfmCtx->getDeclForMangledName(F.getName());
-    if (!Decl)
-      continue;
-    auto CanonicalFD = Decl->getCanonicalDecl()->getAsFunction();
-    if (CanonicalFD->getBeginLoc().getRawEncoding() !=
-        Request[msg::CalleeFuncList::FuncID])
-      continue;
+  if (auto *FPtr = findFunction(M, Request[msg::CalleeFuncList::FuncID])) {
+    auto &F = *FPtr;
     if (F.isDeclaration())
       return json::Parser<msg::CalleeFuncList>::unparseAsObject(Request);
     msg::CalleeFuncList StmtList = Request;
     auto &SrcMgr = mTfmCtx->getContext().getSourceManager();
-    auto &Provider = getAnalysis<ServerPrivateProvider>(F);
-    auto &Matcher = Provider.get<LoopMatcherPass>().getMatcher();
-    auto &Unmatcher = Provider.get<LoopMatcherPass>().getUnmatchedAST();
+    auto &Provider = mProviders.get(F);
     auto &FuncInfo = Provider.get<ClangCFTraitsPass>().getFuncInfo();
     auto &CFLoopInfo = Provider.get<ClangCFTraitsPass>().getLoopInfo();
     const ClangCFTraitsPass::RegionCFInfo *Info = nullptr;
     if (StmtList[msg::CalleeFuncList::LoopID]) {
-      bcl::tagged_pair<
-        bcl::tagged<clang::Stmt *, AST>,
-        bcl::tagged<Loop *, IR>> Loop(nullptr, nullptr);
-      for (auto Match : Matcher)
-        if (Match.get<AST>()->getBeginLoc().getRawEncoding() ==
-            StmtList[msg::CalleeFuncList::LoopID]) {
-          Loop = Match;
-          break;
-        }
-      if (!Loop.get<AST>()) {
-        for (auto Unmatch : Unmatcher)
-          if (Unmatch->getBeginLoc().getRawEncoding() ==
-              StmtList[msg::CalleeFuncList::LoopID]) {
-            Loop.get<AST>() = Unmatch;
-            break;
-          }
-      }
-      if (!Loop.get<AST>())
+      auto Loop = findLoop(F, StmtList[msg::CalleeFuncList::LoopID]);
+      if (!Loop)
         return json::Parser<msg::CalleeFuncList>::unparseAsObject(Request);
-      auto I = CFLoopInfo.find(Loop.get<AST>());
+      auto I = CFLoopInfo.find(Loop->get<AST>());
       if (I != CFLoopInfo.end())
         Info = &I->second;
     } else {
@@ -1402,32 +1452,18 @@ std::string PrivateServerPass::answerCalleeFuncList(llvm::Module &M,
 
 std::string PrivateServerPass::answerAliasTree(llvm::Module &M,
   const msg::AliasTree &Request) {
-  for (Function &F : M) {
-    auto Decl = mTfmCtx->getDeclForMangledName(F.getName());
-    if (!Decl)
-      continue;
-    auto CanonicalFD = Decl->getCanonicalDecl()->getAsFunction();
-    if (CanonicalFD->getBeginLoc().getRawEncoding() !=
-          Request[msg::AliasTree::FuncID])
-      continue;
+  if (auto *FPtr = findFunction(M, Request[msg::AliasTree::FuncID])) {
+    auto &F = *FPtr;
     if (F.isDeclaration())
       return json::Parser<msg::AliasTree>::unparseAsObject(Request);
     auto &SrcMgr = mTfmCtx->getContext().getSourceManager();
-    auto &Provider = getAnalysis<ServerPrivateProvider>(F);
-    auto &LoopMatcher = Provider.get<LoopMatcherPass>().getMatcher();
+    auto &Provider = mProviders.get(F);
     auto &MemoryMatcher = Provider.get<ClangDIMemoryMatcherPass>().getMatcher();
     if (Request[msg::AliasTree::LoopID]) {
-      bcl::tagged_pair<
-        bcl::tagged<clang::Stmt *, AST>,
-        bcl::tagged<Loop *, IR>> Loop(nullptr, nullptr);
-      for (auto Match : LoopMatcher)
-        if (Match.get<AST>()->getBeginLoc().getRawEncoding() ==
-            Request[msg::AliasTree::LoopID]) {
-          Loop = Match;
-          break;
-        }
-      if (!Loop.get<AST>() || !Loop.get<IR>()->getLoopID())
+      auto LoopPtr = findLoop(F, Request[msg::AliasTree::LoopID]);
+      if (!LoopPtr || !LoopPtr->get<IR>() || !LoopPtr->get<IR>()->getLoopID())
         return json::Parser<msg::AliasTree>::unparseAsObject(Request);
+      auto &Loop = *LoopPtr;
       auto RF = mSocket->getAnalysis<
         DIEstimateMemoryPass, DIDependencyAnalysisPass>(F);
       assert(RF && "Dependence analysis must be available!");
@@ -1454,10 +1490,44 @@ std::string PrivateServerPass::answerAliasTree(llvm::Module &M,
       msg::AliasTree Response;
       Response[msg::AliasTree::FuncID] = Request[msg::AliasTree::FuncID];
       Response[msg::AliasTree::LoopID] = Request[msg::AliasTree::LoopID];
-      for (auto &TS : DIDepSet) {
+      Response[msg::AliasTree::RootID] = Request[msg::AliasTree::RootID];
+      Response[msg::AliasTree::Offset] = Request[msg::AliasTree::Offset];
+      Response[msg::AliasTree::Limit] = Request[msg::AliasTree::Limit];
+      bool IsPartial = Request[msg::AliasTree::RootID] ||
+                       Request[msg::AliasTree::Offset] ||
+                       Request[msg::AliasTree::Limit];
+      // The tree is rebuilt for each request, so use preorder numbers of
+      // nodes as identifiers which remain the same between requests.
+      DenseMap<const DIAliasNode *, std::uintptr_t> NodeIDs;
+      for (auto *N : depth_first(&DIAT))
+        NodeIDs.try_emplace(N, NodeIDs.size() + 1);
+      auto isInSubtree = [&Request, &NodeIDs](const DIAliasNode *N) {
+        if (!Request[msg::AliasTree::RootID])
+          return true;
+        for (; N; N = N->getParent())
+          if (NodeIDs.lookup(N) == *Request[msg::AliasTree::RootID])
+            return true;
+        return false;
+      };
+      // Pages are cut from the list of nodes in preorder, so the order
+      // does not depend on the order of traits in the dependence set.
+      std::vector<DIAliasTrait *> Nodes;
+      for (auto &TS : DIDepSet)
+        if (isInSubtree(TS.getNode()))
+          Nodes.push_back(&TS);
+      llvm::sort(Nodes, [&NodeIDs](DIAliasTrait *LHS, DIAliasTrait *RHS) {
+        return NodeIDs.lookup(LHS->getNode()) < NodeIDs.lookup(RHS->getNode());
+      });
+      unsigned Offset = Request[msg::AliasTree::Offset].getValueOr(0);
+      unsigned Total = Nodes.size();
+      for (unsigned Idx = Offset; Idx < Total; ++Idx) {
+        if (Request[msg::AliasTree::Limit] &&
+            Idx - Offset >= *Request[msg::AliasTree::Limit])
+          break;
+        auto &TS = *Nodes[Idx];
         Response[msg::AliasTree::Nodes].emplace_back();
         auto &N = Response[msg::AliasTree::Nodes].back();
-        N[msg::AliasNode::ID] = reinterpret_cast<std::uintptr_t>(TS.getNode());
+        N[msg::AliasNode::ID] = NodeIDs.lookup(TS.getNode());
         N[msg::AliasNode::Kind] = TS.getNode()->getKind();
         N[msg::AliasNode::Traits] = TS;
         for (auto &T : TS) {
@@ -1552,15 +1622,73 @@ std::string PrivateServerPass::answerAliasTree(llvm::Module &M,
           if (DIDepSet.find_as(&C) == DIDepSet.end())
             continue;
           Response[msg::AliasTree::Edges].emplace_back(N[msg::AliasNode::ID],
-            reinterpret_cast<std::uintptr_t>(&C), N[msg::AliasNode::Kind]);
+            NodeIDs.lookup(&C), N[msg::AliasNode::Kind]);
         }
       }
+      if (IsPartial)
+        Response[msg::AliasTree::Total] = Total;
       return json::Parser<msg::AliasTree>::unparseAsObject(Response);
     }
   }
   return json::Parser<msg::AliasTree>::unparseAsObject(Request);
 }
 
+Function * PrivateServerPass::findFunction(llvm::Module &M, unsigned FuncID) {
+  if (mFunctionIndex.empty())
+    for (Function &F : M) {
+      auto Decl = mTfmCtx->getDeclForMangledName(F.getName());
+      if (!Decl)
+        continue;
+      auto CanonicalFD = Decl->getCanonicalDecl()->getAsFunction();
+      mFunctionIndex.try_emplace(CanonicalFD->getBeginLoc().getRawEncoding(),
+                                 &F);
+    }
+  auto I = mFunctionIndex.find(FuncID);
+  return I != mFunctionIndex.end() ? I->second : nullptr;
+}
+
+auto PrivateServerPass::findLoop(Function &F, unsigned LoopID)
+    -> Optional<LoopMatch> {
+  auto &LMP = mProviders.get(F).get<LoopMatcherPass>();
+  auto Info = mLoopIndex.try_emplace(&F);
+  if (Info.second) {
+    for (auto Match : LMP.getMatcher())
+      Info.first->second.try_emplace(
+          Match.get<AST>()->getBeginLoc().getRawEncoding(), Match.get<AST>());
+    for (auto Unmatch : LMP.getUnmatchedAST())
+      Info.first->second.try_emplace(Unmatch->getBeginLoc().getRawEncoding(),
+                                     Unmatch);
+  }
+  auto I = Info.first->second.find(LoopID);
+  if (I == Info.first->second.end())
+    return None;
+  auto MatchItr = LMP.getMatcher().find<AST>(I->second);
+  return LoopMatch(I->second, MatchItr != LMP.getMatcher().end()
+                                  ? MatchItr->get<IR>()
+                                  : nullptr);
+}
+
+std::string PrivateServerPass::answer(llvm::Module &M,
+    const std::string &Request) {
+  json::Parser<msg::Statistic, msg::FileList, msg::LoopTree,
+    msg::FunctionList, msg::CalleeFuncList, msg::AliasTree> P(Request);
+  auto Obj = P.parse();
+  assert(Obj && "Invalid request!");
+  if (Obj->is<msg::Statistic>())
+    return answerStatistic(M);
+  if (Obj->is<msg::FileList>())
+    return answerFileList();
+  if (Obj->is<msg::LoopTree>())
+    return answerLoopTree(M, Obj->as<msg::LoopTree>());
+  if (Obj->is<msg::FunctionList>())
+    return answerFunctionList(M);
+  if (Obj->is<msg::CalleeFuncList>())
+    return answerCalleeFuncList(M, Obj->as<msg::CalleeFuncList>());
+  if (Obj->is<msg::AliasTree>())
+    return answerAliasTree(M, Obj->as<msg::AliasTree>());
+  llvm_unreachable("Unknown request to server!");
+}
+
 bool PrivateServerPass::runOnModule(llvm::Module &M) {
   if (!mConnection) {
     M.getContext().emitError("intrusive connection is not established");
@@ -1579,6 +1707,11 @@ bool PrivateServerPass::runOnModule(llvm::Module &M) {
         ": transformation context is not available");
     return false;
   }
+  mProviders.invalidate();
+  // The cache lives across runs of this pass, so count requests of this
+  // run only.
+  auto NumHits = mProviders.getNumHits();
+  auto NumMisses = mProviders.getNumMisses();
   ServerPrivateProvider::initialize<TransformationEnginePass>(
     [this](TransformationEnginePass &TEP) {
       TEP.set(*mTfmInfo);
@@ -1610,6 +1743,12 @@ bool PrivateServerPass::runOnModule(llvm::Module &M) {
       [&DIMEnvWrapper](DIMemoryEnvironmentWrapper &Wrapper) {
     Wrapper.set(*DIMEnvWrapper);
   });
+  if (mIndexedTfmCtx != mTfmCtx) {
+    mIndexedTfmCtx = mTfmCtx;
+    mFunctionIndex.clear();
+    mLoopIndex.clear();
+    mResponses.clear();
+  }
   while (mConnection->answer(
       [this, &M](const std::string &Request) -> std::string {
     msg::Diagnostic Diag(msg::Status::Error);
@@ -1617,24 +1756,23 @@ bool PrivateServerPass::runOnModule(llvm::Module &M) {
       Diag[msg::Diagnostic::Terminal] += mStdErr->diff();
       return json::Parser<msg::Diagnostic>::unparseAsObject(Diag);
     }
-    json::Parser<msg::Statistic, msg::FileList, msg::LoopTree,
-      msg::FunctionList, msg::CalleeFuncList, msg::AliasTree> P(Request);
-    auto Obj = P.parse();
-    assert(Obj && "Invalid request!");
-    if (Obj->is<msg::Statistic>())
-      return answerStatistic(M);
-    if (Obj->is<msg::FileList>())
-      return answerFileList();
-    if (Obj->is<msg::LoopTree>())
-      return answerLoopTree(M, Obj->as<msg::LoopTree>());
-    if (Obj->is<msg::FunctionList>())
-      return answerFunctionList(M);
-    if (Obj->is<msg::CalleeFuncList>())
-      return answerCalleeFuncList(M, Obj->as<msg::CalleeFuncList>());
-    if (Obj->is<msg::AliasTree>())
-      return answerAliasTree(M, Obj->as<msg::AliasTree>());
-    llvm_unreachable("Unknown request to server!");
+    auto CachedItr = mResponses.find(Request);
+    if (CachedItr != mResponses.end()) {
+      ++NumResponseHit;
+      return CachedItr->second;
+    }
+    // Some responses depend on the list of functions which are visible to
+    // user, so previous responses are outdated if this list has been extended.
+    auto NumVisible = mVisibleToUser.size();
+    auto Response = answer(M, Request);
+    if (NumVisible != mVisibleToUser.size())
+      mResponses.clear();
+    if (!mStdErr->isDiff())
+      mResponses.try_emplace(Request, Response);
+    return Response;
   }));
+  NumProviderHit += mProviders.getNumHits() - NumHits;
+  NumProviderMiss += mProviders.getNumMisses() - NumMisses;
   return false;
 }
 